@@ -19,12 +19,9 @@
 void handleInput(SDL_Keycode code, Rasterizer *rasterizer);
 
 int main(int argc, char** argv) {
-	// Load mesh and its textures
+	// Load mesh and its textures in the background, every frame draws what's loaded so far
 	Mesh mesh;
-	mesh.loadObjFromFile("head.obj");
-	mesh.loadDiffuseTexture("head_diffuse.png");
-	mesh.loadNormalMap("head_nm.png");
-	mesh.loadSpecularMap("head_specular.png");
+	mesh.loadProgressive("head.obj", "head_diffuse.png", "head_nm.png", "head_specular.png");
 
 	// Create the camera
 	Camera camera;
@@ -46,6 +43,11 @@ int main(int argc, char** argv) {
 	std::unique_ptr<Shader> shader = std::unique_ptr<PhongShader>(new PhongShader());
 	rasterizer.loadShader(shader);
 
+	// frames in flight, the geometry of a frame overlaps the drawing of the ones before
+	if (const char *depth = getenv("SOFTWARE_RENDERER_PIPELINE_DEPTH")) {
+		rasterizer.setPipelineDepth(atoi(depth));
+	}
+
 	// init offset for camera movement
 	float cameraOffset = 0.1f;
 
@@ -144,5 +146,12 @@ void handleInput(SDL_Keycode code, Rasterizer *rasterizer) {
 			rasterizer->loadShader(shader);
 		}
 		break;
+		case SDLK_F7:
+		{
+			// cycle through the shading precisions
+			const int precision = (static_cast<int>(rasterizer->getShadingPrecision()) + 1) % 3;
+			rasterizer->setShadingPrecision(static_cast<ShadingPrecision>(precision));
+		}
+		break;
 	}
 }
\ No newline at end of file
@@ -0,0 +1,113 @@
+#include "AssetPack.h"
+
+#include <algorithm>
+
+namespace {
+	// bytes of the texels of the first levelCount levels
+	size_t texelBytes(const Texture &texture, size_t levelCount) {
+		const MipLevel &last = texture.levels[levelCount - 1];
+		const int rows = texture.compressed() || texture.layout == TextureLayout::TILED ? (last.height + 3) / 4 : last.height;
+		return last.offset + static_cast<size_t>(rows) * last.pitch;
+	}
+
+	// Whether every level of a mapped texture lies within its bytes of texels, with rows
+	// long enough for the texels of the level, so a corrupt pack can't make the sampler
+	// read past them
+	bool levelsFit(const Texture &texture, size_t bytes) {
+		const bool blocks = texture.compressed() || texture.layout == TextureLayout::TILED;
+		for (const MipLevel &level : texture.levels) {
+			if (level.width <= 0 || level.height <= 0 || level.pitch <= 0 || level.offset < 0) {
+				return false;
+			}
+			const size_t columns = blocks ? (level.width + 3) / 4 : level.width;
+			const size_t rows = blocks ? (level.height + 3) / 4 : level.height;
+			const size_t rowBytes = texture.compressed() ? columns * texture.blockSize() : blocks ? columns * (16 << texture.texelShift) : columns << texture.texelShift;
+			if (static_cast<size_t>(level.pitch) < rowBytes || static_cast<size_t>(level.offset) > bytes || (rows - 1) * level.pitch + rowBytes > bytes - level.offset) {
+				return false;
+			}
+		}
+		return true;
+	}
+}
+
+namespace AssetPack {
+
+	void align(std::ofstream &out, uint64_t alignment) {
+		static const char padding[ALIGNMENT] = {};
+		const uint64_t position = static_cast<uint64_t>(out.tellp());
+		for (uint64_t count = (alignment - position % alignment) % alignment; count > 0;) {
+			const uint64_t size = std::min(count, ALIGNMENT);
+			out.write(padding, size);
+			count -= size;
+		}
+	}
+
+	PackedTexture write(std::ofstream &out, const Texture &texture, bool mipmaps) {
+		PackedTexture packed = {};
+		if (texture.empty()) {
+			return packed;
+		}
+
+		packed.format = static_cast<int32_t>(texture.format);
+		packed.layout = static_cast<int32_t>(texture.layout);
+		packed.texelShift = texture.texelShift;
+		packed.topDown = texture.topDown;
+
+		// the base level comes first in every layout and format
+		const size_t levelCount = mipmaps ? texture.levels.size() : 1;
+		packed.levels = write(out, ArrayView<MipLevel>(texture.levels.data(), levelCount));
+		packed.texels = write(out, ArrayView<byte>(texture.data(), texelBytes(texture, levelCount)));
+		return packed;
+	}
+
+	bool indicesFit(ArrayView<Vector3f> vertices, ArrayView<Vector3f> textureCoordinates, ArrayView<Vector3f> normals, ArrayView<FaceVector> faces, ArrayView<Vector3f> tangents, ArrayView<float> bitangentSigns, ArrayView<Vector3i> faceTangents) {
+		if (bitangentSigns.size() != tangents.size() || faceTangents.size() != (tangents.empty() ? 0 : faces.size())) {
+			return false;
+		}
+		const auto fits = [](int index, size_t count) { return index >= 0 && static_cast<size_t>(index) < count; };
+		for (const FaceVector &face : faces) {
+			for (const Vector3i &corner : face) {
+				if (!fits(corner.x, vertices.size()) || (!textureCoordinates.empty() && !fits(corner.y, textureCoordinates.size())) || (!normals.empty() && !fits(corner.z, normals.size()))) {
+					return false;
+				}
+			}
+		}
+		for (const Vector3i &corners : faceTangents) {
+			if (!fits(corners.x, tangents.size()) || !fits(corners.y, tangents.size()) || !fits(corners.z, tangents.size())) {
+				return false;
+			}
+		}
+		return true;
+	}
+
+	bool map(const std::shared_ptr<const MappedFile> &file, const PackedTexture &packed, Texture &texture) {
+		texture = Texture();
+		const ArrayView<MipLevel> levels = view<MipLevel>(*file, packed.levels);
+		const ArrayView<byte> texels = view<byte>(*file, packed.texels);
+		if (levels.size() != packed.levels.count || texels.size() != packed.texels.count) {
+			return false;
+		}
+		if (levels.empty()) {
+			return true;
+		}
+		if (packed.format < static_cast<int32_t>(TextureFormat::RGBA8) || packed.format > static_cast<int32_t>(TextureFormat::BC5) ||
+			packed.layout < static_cast<int32_t>(TextureLayout::LINEAR) || packed.layout > static_cast<int32_t>(TextureLayout::TILED) ||
+			packed.texelShift < 2 || packed.texelShift > 3) {
+			return false;
+		}
+
+		texture.levels.assign(levels.begin(), levels.end());
+		texture.format = static_cast<TextureFormat>(packed.format);
+		texture.layout = static_cast<TextureLayout>(packed.layout);
+		texture.texelShift = packed.texelShift;
+		texture.topDown = packed.topDown != 0;
+		if (!levelsFit(texture, texels.size())) {
+			texture = Texture();
+			return false;
+		}
+		texture.id = Texture::createId();
+		texture.mappedTexels = texels.data();
+		texture.mapping = file;
+		return true;
+	}
+}
\ No newline at end of file
@@ -0,0 +1,99 @@
+#pragma once
+
+#include <cstdint>
+#include <fstream>
+#include <memory>
+#include "MappedFile.h"
+#include "ObjFile.h"
+#include "Texture.h"
+#include "../types/ArrayView.h"
+#include "../types/Vector3.h"
+
+// Binary file with the geometry, tangents and textures of a Mesh stored the way they
+// are used, so Mesh::loadAssetPack maps it and reads everything in place. Arrays start
+// at multiples of ALIGNMENT bytes. Values are stored with the byte order and struct
+// layout of the machine that wrote the pack, VERSION changes with that layout.
+namespace AssetPack {
+
+	const char MAGIC[4] = { 'S', 'R', 'P', 'K' };
+	const uint32_t VERSION = 1;
+	const uint64_t ALIGNMENT = 64;
+
+	// bytes from the start of the file and number of elements
+	struct Array {
+		uint64_t offset;
+		uint64_t count;
+	};
+
+	struct PackedTexture {
+		int32_t format;
+		int32_t layout;
+		int32_t texelShift;
+		int32_t topDown;
+		// MipLevel elements, none when there is no texture
+		Array levels;
+		Array texels;
+	};
+
+	enum PackedArray : int {
+		VERTICES = 0,
+		TEXTURE_COORDINATES,
+		NORMALS,
+		FACES,
+		TANGENTS,
+		BITANGENT_SIGNS,
+		FACE_TANGENTS,
+		ARRAY_COUNT
+	};
+
+	enum PackedTextureSlot : int {
+		DIFFUSE = 0,
+		NORMAL_MAP,
+		SPECULAR_MAP,
+		MATERIAL,
+		TEXTURE_COUNT
+	};
+
+	struct Header {
+		char magic[4];
+		uint32_t version;
+		float boundsMin[3];
+		float boundsMax[3];
+		Array arrays[PackedArray::ARRAY_COUNT];
+		PackedTexture textures[PackedTextureSlot::TEXTURE_COUNT];
+	};
+
+	// pads out to the next multiple of alignment
+	void align(std::ofstream &out, uint64_t alignment = ALIGNMENT);
+
+	// appends the elements at the next aligned offset
+	template <typename T>
+	Array write(std::ofstream &out, ArrayView<T> elements) {
+		align(out);
+		const Array array = { static_cast<uint64_t>(out.tellp()), elements.size() };
+		out.write(reinterpret_cast<const char*>(elements.data()), elements.size() * sizeof(T));
+		return array;
+	}
+
+	// appends the texels and levels of an uncompressed or compressed texture, only
+	// the base level without mipmaps when mipmaps is false
+	PackedTexture write(std::ofstream &out, const Texture &texture, bool mipmaps);
+
+	// view of an array of a mapped pack, empty when it's past the end of the file
+	template <typename T>
+	ArrayView<T> view(const MappedFile &file, const Array &array) {
+		if (array.offset > file.size() || array.count > (file.size() - array.offset) / sizeof(T)) {
+			return ArrayView<T>();
+		}
+		return ArrayView<T>(reinterpret_cast<const T*>(file.data() + array.offset), static_cast<size_t>(array.count));
+	}
+
+	// Whether every face corner and face tangent indexes an element of its array, so a
+	// corrupt pack can't make the shaders read past them. Empty uv and normal arrays take
+	// any index as they are never read, tangents need one sign and one face entry each.
+	bool indicesFit(ArrayView<Vector3f> vertices, ArrayView<Vector3f> textureCoordinates, ArrayView<Vector3f> normals, ArrayView<FaceVector> faces, ArrayView<Vector3f> tangents, ArrayView<float> bitangentSigns, ArrayView<Vector3i> faceTangents);
+
+	// points texture at the texels in the mapping and keeps the mapping alive, false
+	// when the texture isn't whole or a level reaches past its texels
+	bool map(const std::shared_ptr<const MappedFile> &file, const PackedTexture &packed, Texture &texture);
+}
\ No newline at end of file
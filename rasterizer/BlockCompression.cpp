@@ -0,0 +1,245 @@
+#include "BlockCompression.h"
+
+#include <cmath>
+#include <cassert>
+#include <algorithm>
+
+namespace {
+	int pack565(const float colour[3]) {
+		const int r = std::min(std::max(static_cast<int>(colour[0] * 31.0f / 255.0f + 0.5f), 0), 31);
+		const int g = std::min(std::max(static_cast<int>(colour[1] * 63.0f / 255.0f + 0.5f), 0), 63);
+		const int b = std::min(std::max(static_cast<int>(colour[2] * 31.0f / 255.0f + 0.5f), 0), 31);
+		return (r << 11) | (g << 5) | b;
+	}
+
+	void unpack565(int colour, int rgb[3]) {
+		const int r = (colour >> 11) & 31, g = (colour >> 5) & 63, b = colour & 31;
+		rgb[0] = (r << 3) | (r >> 2);
+		rgb[1] = (g << 2) | (g >> 4);
+		rgb[2] = (b << 3) | (b >> 2);
+	}
+
+	// the four colours of a block, or three and transparent black when the first endpoint is not the largest
+	void colourPalette(int colour0, int colour1, bool alwaysFourColours, int palette[4][4]) {
+		unpack565(colour0, palette[0]);
+		unpack565(colour1, palette[1]);
+		palette[0][3] = palette[1][3] = 255;
+		for (int c = 0; c < 3; c++) {
+			if (alwaysFourColours || colour0 > colour1) {
+				palette[2][c] = (2 * palette[0][c] + palette[1][c]) / 3;
+				palette[3][c] = (palette[0][c] + 2 * palette[1][c]) / 3;
+			} else {
+				palette[2][c] = (palette[0][c] + palette[1][c]) / 2;
+				palette[3][c] = 0;
+			}
+		}
+		palette[2][3] = 255;
+		palette[3][3] = alwaysFourColours || colour0 > colour1 ? 255 : 0;
+	}
+
+	// Endpoints on the principal axis of the colours of the block, found by power
+	// iteration on their covariance. Always in four colour mode.
+	void encodeColourBlock(const byte texels[64], byte *block) {
+		float mean[3] = { 0.0f, 0.0f, 0.0f };
+		for (int i = 0; i < 16; i++) {
+			for (int c = 0; c < 3; c++) {
+				mean[c] += texels[i * 4 + c] / 16.0f;
+			}
+		}
+		float covariance[3][3] = {};
+		for (int i = 0; i < 16; i++) {
+			for (int r = 0; r < 3; r++) {
+				for (int c = 0; c < 3; c++) {
+					covariance[r][c] += (texels[i * 4 + r] - mean[r]) * (texels[i * 4 + c] - mean[c]);
+				}
+			}
+		}
+		float axis[3] = { 1.0f, 1.0f, 1.0f };
+		for (int iteration = 0; iteration < 8; iteration++) {
+			float next[3];
+			for (int r = 0; r < 3; r++) {
+				next[r] = covariance[r][0] * axis[0] + covariance[r][1] * axis[1] + covariance[r][2] * axis[2];
+			}
+			const float length = std::max(std::max(std::fabs(next[0]), std::fabs(next[1])), std::fabs(next[2]));
+			if (length == 0.0f) {
+				break;
+			}
+			for (int c = 0; c < 3; c++) {
+				axis[c] = next[c] / length;
+			}
+		}
+
+		float minimum = 0.0f, maximum = 0.0f;
+		for (int i = 0; i < 16; i++) {
+			const float projection = (texels[i * 4] - mean[0]) * axis[0] + (texels[i * 4 + 1] - mean[1]) * axis[1] + (texels[i * 4 + 2] - mean[2]) * axis[2];
+			minimum = std::min(minimum, projection);
+			maximum = std::max(maximum, projection);
+		}
+		const float axisLength = axis[0] * axis[0] + axis[1] * axis[1] + axis[2] * axis[2];
+		float endpoint0[3], endpoint1[3];
+		for (int c = 0; c < 3; c++) {
+			endpoint0[c] = mean[c] + axis[c] * maximum / axisLength;
+			endpoint1[c] = mean[c] + axis[c] * minimum / axisLength;
+		}
+
+		int colour0 = pack565(endpoint0), colour1 = pack565(endpoint1);
+		if (colour0 < colour1) {
+			std::swap(colour0, colour1);
+		}
+		int palette[4][4];
+		colourPalette(colour0, colour1, true, palette);
+
+		unsigned int indices = 0;
+		for (int i = 0; i < 16; i++) {
+			int best = 0, bestDistance = 1 << 30;
+			for (int p = 0; p < 4 && colour0 != colour1; p++) {
+				int distance = 0;
+				for (int c = 0; c < 3; c++) {
+					const int difference = texels[i * 4 + c] - palette[p][c];
+					distance += difference * difference;
+				}
+				if (distance < bestDistance) {
+					bestDistance = distance;
+					best = p;
+				}
+			}
+			indices |= best << (i * 2);
+		}
+
+		block[0] = colour0 & 0xFF;
+		block[1] = colour0 >> 8;
+		block[2] = colour1 & 0xFF;
+		block[3] = colour1 >> 8;
+		for (int i = 0; i < 4; i++) {
+			block[4 + i] = (indices >> (i * 8)) & 0xFF;
+		}
+	}
+
+	void decodeColourBlock(const byte *block, bool alwaysFourColours, byte texels[64]) {
+		const int colour0 = block[0] | (block[1] << 8);
+		const int colour1 = block[2] | (block[3] << 8);
+		int palette[4][4];
+		colourPalette(colour0, colour1, alwaysFourColours, palette);
+
+		const unsigned int indices = block[4] | (block[5] << 8) | (block[6] << 16) | (static_cast<unsigned int>(block[7]) << 24);
+		for (int i = 0; i < 16; i++) {
+			const int *colour = palette[(indices >> (i * 2)) & 3];
+			for (int c = 0; c < 4; c++) {
+				texels[i * 4 + c] = static_cast<byte>(colour[c]);
+			}
+		}
+	}
+
+	// the eight values of a single channel block with the first endpoint the largest
+	void channelPalette(int value0, int value1, int palette[8]) {
+		palette[0] = value0;
+		palette[1] = value1;
+		if (value0 > value1) {
+			for (int i = 2; i < 8; i++) {
+				palette[i] = ((8 - i) * value0 + (i - 1) * value1) / 7;
+			}
+		} else {
+			for (int i = 2; i < 6; i++) {
+				palette[i] = ((6 - i) * value0 + (i - 1) * value1) / 5;
+			}
+			palette[6] = 0;
+			palette[7] = 255;
+		}
+	}
+
+	// channel c of the texels between its extremes, always in eight value mode
+	void encodeChannelBlock(const byte texels[64], int channel, byte *block) {
+		int value0 = 0, value1 = 255;
+		for (int i = 0; i < 16; i++) {
+			value0 = std::max(value0, static_cast<int>(texels[i * 4 + channel]));
+			value1 = std::min(value1, static_cast<int>(texels[i * 4 + channel]));
+		}
+		int palette[8];
+		channelPalette(value0, value1, palette);
+
+		unsigned long long indices = 0;
+		for (int i = 0; i < 16 && value0 != value1; i++) {
+			int best = 0, bestDistance = 256;
+			for (int p = 0; p < 8; p++) {
+				const int distance = std::abs(texels[i * 4 + channel] - palette[p]);
+				if (distance < bestDistance) {
+					bestDistance = distance;
+					best = p;
+				}
+			}
+			indices |= static_cast<unsigned long long>(best) << (i * 3);
+		}
+
+		block[0] = static_cast<byte>(value0);
+		block[1] = static_cast<byte>(value1);
+		for (int i = 0; i < 6; i++) {
+			block[2 + i] = (indices >> (i * 8)) & 0xFF;
+		}
+	}
+
+	void decodeChannelBlock(const byte *block, int channel, byte texels[64]) {
+		int palette[8];
+		channelPalette(block[0], block[1], palette);
+
+		unsigned long long indices = 0;
+		for (int i = 0; i < 6; i++) {
+			indices |= static_cast<unsigned long long>(block[2 + i]) << (i * 8);
+		}
+		for (int i = 0; i < 16; i++) {
+			texels[i * 4 + channel] = static_cast<byte>(palette[(indices >> (i * 3)) & 7]);
+		}
+	}
+}
+
+void BlockCompression::encodeBlock(TextureFormat format, const byte texels[64], byte *block) {
+	switch (format) {
+		case TextureFormat::BC1:
+			encodeColourBlock(texels, block);
+			break;
+		case TextureFormat::BC3:
+			encodeChannelBlock(texels, 3, block);
+			encodeColourBlock(texels, block + 8);
+			break;
+		case TextureFormat::BC4:
+			encodeChannelBlock(texels, 0, block);
+			break;
+		case TextureFormat::BC5:
+			encodeChannelBlock(texels, 0, block);
+			encodeChannelBlock(texels, 1, block + 8);
+			break;
+		default:
+			assert(false);
+	}
+}
+
+void BlockCompression::decodeBlock(TextureFormat format, const byte *block, byte texels[64]) {
+	switch (format) {
+		case TextureFormat::BC1:
+			decodeColourBlock(block, false, texels);
+			break;
+		case TextureFormat::BC3:
+			decodeColourBlock(block + 8, true, texels);
+			decodeChannelBlock(block, 3, texels);
+			break;
+		case TextureFormat::BC4:
+			decodeChannelBlock(block, 0, texels);
+			for (int i = 0; i < 16; i++) {
+				texels[i * 4 + 1] = texels[i * 4 + 2] = texels[i * 4];
+				texels[i * 4 + 3] = 255;
+			}
+			break;
+		case TextureFormat::BC5:
+			decodeChannelBlock(block, 0, texels);
+			decodeChannelBlock(block + 8, 1, texels);
+			for (int i = 0; i < 16; i++) {
+				const float x = (texels[i * 4] / 255.f) * 2.0f - 1.f;
+				const float y = (texels[i * 4 + 1] / 255.f) * 2.0f - 1.f;
+				const float z = std::sqrt(std::max(0.0f, 1.0f - x * x - y * y));
+				texels[i * 4 + 2] = static_cast<byte>((z * 0.5f + 0.5f) * 255.0f + 0.5f);
+				texels[i * 4 + 3] = 255;
+			}
+			break;
+		default:
+			assert(false);
+	}
+}
\ No newline at end of file
@@ -0,0 +1,16 @@
+#pragma once
+
+#include "Texture.h"
+
+// Encoders and decoders of the BC formats. A block covers 4x4 texels, handed over
+// as 64 bytes of RGBA8 in row order.
+namespace BlockCompression {
+
+	// Encodes a block into blockSize() bytes of the format. BC4 reads the red channel,
+	// BC5 the red and green channels of a normal map.
+	void encodeBlock(TextureFormat format, const byte texels[64], byte *block);
+
+	// Decodes a block to RGBA8. BC4 replicates its channel into red, green and blue,
+	// BC5 rebuilds blue from the unit length of the normal.
+	void decodeBlock(TextureFormat format, const byte *block, byte texels[64]);
+}
\ No newline at end of file
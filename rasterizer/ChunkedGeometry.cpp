@@ -0,0 +1,258 @@
+#include "ChunkedGeometry.h"
+
+#include <algorithm>
+#include <cassert>
+#include <cstring>
+#include <fstream>
+#include <utility>
+
+const char ChunkedGeometry::MAGIC[4] = { 'S', 'R', 'C', 'K' };
+
+namespace {
+	// spreads the low 10 bits of value out to every third bit
+	uint32_t spreadBits(uint32_t value) {
+		value &= 0x3FF;
+		value = (value | (value << 16)) & 0x030000FF;
+		value = (value | (value << 8)) & 0x0300F00F;
+		value = (value | (value << 4)) & 0x030C30C3;
+		value = (value | (value << 2)) & 0x09249249;
+		return value;
+	}
+
+	// position along the Morton curve of the point quantized to 10 bits per axis of the box
+	uint32_t mortonCode(const Vector3f &point, const Vector3f &min, const Vector3f &scale) {
+		const float coordinates[3] = { (point.x - min.x) * scale.x, (point.y - min.y) * scale.y, (point.z - min.z) * scale.z };
+		uint32_t code = 0;
+		for (int i = 0; i < 3; i++) {
+			const uint32_t quantized = static_cast<uint32_t>(std::min(std::max(coordinates[i], 0.0f), 1023.0f));
+			code |= spreadBits(quantized) << i;
+		}
+		return code;
+	}
+
+	void bounds(ArrayView<Vector3f> points, Vector3f &min, Vector3f &max) {
+		min = max = points.empty() ? Vector3f(0.0f, 0.0f, 0.0f) : points[0];
+		for (const Vector3f &point : points) {
+			min = Vector3f(std::min(min.x, point.x), std::min(min.y, point.y), std::min(min.z, point.z));
+			max = Vector3f(std::max(max.x, point.x), std::max(max.y, point.y), std::max(max.z, point.z));
+		}
+	}
+
+	// Gathers the elements of a mesh array used by a chunk, numbered in order of first use
+	template <typename T>
+	class ChunkArray {
+	public:
+		explicit ChunkArray(ArrayView<T> source) : source(source), local(source.size(), -1) {}
+
+		// local index of the element, indices are kept when the mesh has no such array
+		int add(int index) {
+			if (source.empty()) {
+				return index;
+			}
+			if (local[index] < 0) {
+				local[index] = static_cast<int>(elements.size());
+				elements.push_back(source[index]);
+				used.push_back(index);
+			}
+			return local[index];
+		}
+
+		void clear() {
+			for (int index : used) {
+				local[index] = -1;
+			}
+			elements.clear();
+			used.clear();
+		}
+
+		ArrayView<T> source;
+		std::vector<T> elements;
+		// index in the mesh of every element
+		std::vector<int> used;
+
+	private:
+		std::vector<int> local;
+	};
+}
+
+ChunkedGeometry::ChunkedGeometry(const std::string &path, size_t budget) : file(path), boundsMin(0.0f, 0.0f, 0.0f), boundsMax(0.0f, 0.0f, 0.0f), budget(budget), residentBytes(0) {
+	Header header;
+	if (!file.isOpen() || file.size() < sizeof(header)) {
+		return;
+	}
+	std::memcpy(&header, file.data(), sizeof(header));
+	if (std::memcmp(header.magic, MAGIC, sizeof(header.magic)) != 0 || header.version != VERSION) {
+		return;
+	}
+	const ArrayView<Chunk> table = AssetPack::view<Chunk>(file, header.chunks);
+	if (table.size() != header.chunks.count) {
+		return;
+	}
+
+	// every array has to lie inside its chunk and every chunk inside the file
+	const size_t elementSizes[AssetPack::ARRAY_COUNT] = { sizeof(Vector3f), sizeof(Vector3f), sizeof(Vector3f), sizeof(FaceVector), sizeof(Vector3f), sizeof(float), sizeof(Vector3i) };
+	for (const Chunk &chunk : table) {
+		if (chunk.offset > file.size() || chunk.size > file.size() - chunk.offset) {
+			return;
+		}
+		for (int i = 0; i < AssetPack::ARRAY_COUNT; i++) {
+			const AssetPack::Array &array = chunk.arrays[i];
+			if (array.offset < chunk.offset || array.offset > chunk.offset + chunk.size || array.count > (chunk.offset + chunk.size - array.offset) / elementSizes[i]) {
+				return;
+			}
+		}
+	}
+
+	chunks = table;
+	boundsMin = Vector3f(header.boundsMin[0], header.boundsMin[1], header.boundsMin[2]);
+	boundsMax = Vector3f(header.boundsMax[0], header.boundsMax[1], header.boundsMax[2]);
+	resident.assign(chunks.size(), false);
+	checked.assign(chunks.size(), false);
+	indicesFit.assign(chunks.size(), false);
+	positions.resize(chunks.size());
+}
+
+bool ChunkedGeometry::createChunkFile(const std::string &path, const Arrays &mesh, int facesPerChunk) {
+	assert(facesPerChunk > 0);
+	std::ofstream out(path, std::ofstream::out | std::ofstream::binary);
+	if (!out.is_open()) {
+		return false;
+	}
+
+	// faces in the order of the Morton codes of their centroids
+	Vector3f min, max;
+	bounds(mesh.vertices, min, max);
+	const Vector3f extent = max - min;
+	const Vector3f scale(extent.x > 0.0f ? 1023.0f / extent.x : 0.0f, extent.y > 0.0f ? 1023.0f / extent.y : 0.0f, extent.z > 0.0f ? 1023.0f / extent.z : 0.0f);
+	std::vector<std::pair<uint32_t, int>> order(mesh.faces.size());
+	for (size_t i = 0; i < mesh.faces.size(); i++) {
+		const FaceVector &face = mesh.faces[i];
+		const Vector3f centroid = (mesh.vertices[face[0].x] + mesh.vertices[face[1].x] + mesh.vertices[face[2].x]) * (1.0f / 3.0f);
+		order[i] = std::make_pair(mortonCode(centroid, min, scale), static_cast<int>(i));
+	}
+	std::sort(order.begin(), order.end());
+
+	// the header and the chunk table are written again once the offsets are known
+	Header header = {};
+	std::memcpy(header.magic, MAGIC, sizeof(header.magic));
+	header.version = VERSION;
+	const float meshBounds[6] = { min.x, min.y, min.z, max.x, max.y, max.z };
+	std::copy(meshBounds, meshBounds + 3, header.boundsMin);
+	std::copy(meshBounds + 3, meshBounds + 6, header.boundsMax);
+	out.write(reinterpret_cast<const char*>(&header), sizeof(header));
+
+	ChunkArray<Vector3f> vertices(mesh.vertices), textureCoordinates(mesh.textureCoordinates), normals(mesh.normals), tangents(mesh.tangents);
+	std::vector<FaceVector> faces;
+	std::vector<Vector3i> faceTangents;
+	std::vector<float> bitangentSigns;
+	std::vector<Chunk> table;
+	for (size_t first = 0; first < order.size(); first += facesPerChunk) {
+		const size_t last = std::min(order.size(), first + facesPerChunk);
+		for (ChunkArray<Vector3f> *array : { &vertices, &textureCoordinates, &normals, &tangents }) {
+			array->clear();
+		}
+		faces.clear();
+		faceTangents.clear();
+		bitangentSigns.clear();
+
+		for (size_t i = first; i < last; i++) {
+			const int index = order[i].second;
+			FaceVector face = mesh.faces[index];
+			for (int j = 0; j < 3; j++) {
+				face[j] = Vector3i(vertices.add(face[j].x), textureCoordinates.add(face[j].y), normals.add(face[j].z));
+			}
+			faces.push_back(face);
+			if (!mesh.faceTangents.empty()) {
+				const Vector3i &corners = mesh.faceTangents[index];
+				faceTangents.push_back(Vector3i(tangents.add(corners.x), tangents.add(corners.y), tangents.add(corners.z)));
+			}
+		}
+		for (int index : tangents.used) {
+			bitangentSigns.push_back(mesh.bitangentSigns[index]);
+		}
+
+		Chunk chunk = {};
+		bounds(vertices.elements, min, max);
+		const float chunkBounds[6] = { min.x, min.y, min.z, max.x, max.y, max.z };
+		std::copy(chunkBounds, chunkBounds + 3, chunk.boundsMin);
+		std::copy(chunkBounds + 3, chunkBounds + 6, chunk.boundsMax);
+
+		AssetPack::align(out, CHUNK_ALIGNMENT);
+		chunk.offset = static_cast<uint64_t>(out.tellp());
+		chunk.arrays[AssetPack::VERTICES] = AssetPack::write<Vector3f>(out, vertices.elements);
+		chunk.arrays[AssetPack::TEXTURE_COORDINATES] = AssetPack::write<Vector3f>(out, textureCoordinates.elements);
+		chunk.arrays[AssetPack::NORMALS] = AssetPack::write<Vector3f>(out, normals.elements);
+		chunk.arrays[AssetPack::FACES] = AssetPack::write<FaceVector>(out, faces);
+		chunk.arrays[AssetPack::TANGENTS] = AssetPack::write<Vector3f>(out, tangents.elements);
+		chunk.arrays[AssetPack::BITANGENT_SIGNS] = AssetPack::write<float>(out, bitangentSigns);
+		chunk.arrays[AssetPack::FACE_TANGENTS] = AssetPack::write<Vector3i>(out, faceTangents);
+		// the padding up to the next chunk belongs to this one, so releasing it drops every page
+		AssetPack::align(out, CHUNK_ALIGNMENT);
+		chunk.size = static_cast<uint64_t>(out.tellp()) - chunk.offset;
+		table.push_back(chunk);
+	}
+
+	header.chunks = AssetPack::write<Chunk>(out, table);
+	out.seekp(0);
+	out.write(reinterpret_cast<const char*>(&header), sizeof(header));
+	return out.good();
+}
+
+void ChunkedGeometry::getChunkBounds(size_t index, Vector3f &min, Vector3f &max) const {
+	const Chunk &chunk = chunks[index];
+	min = Vector3f(chunk.boundsMin[0], chunk.boundsMin[1], chunk.boundsMin[2]);
+	max = Vector3f(chunk.boundsMax[0], chunk.boundsMax[1], chunk.boundsMax[2]);
+}
+
+ChunkedGeometry::Arrays ChunkedGeometry::acquire(size_t index) {
+	const Chunk &chunk = chunks[index];
+	if (resident[index]) {
+		leastRecentlyUsed.splice(leastRecentlyUsed.begin(), leastRecentlyUsed, positions[index]);
+	} else {
+		resident[index] = true;
+		residentBytes += static_cast<size_t>(chunk.size);
+		positions[index] = leastRecentlyUsed.insert(leastRecentlyUsed.begin(), index);
+	}
+	while (residentBytes > budget && leastRecentlyUsed.back() != index) {
+		release(leastRecentlyUsed.back());
+	}
+
+	Arrays arrays;
+	arrays.vertices = AssetPack::view<Vector3f>(file, chunk.arrays[AssetPack::VERTICES]);
+	arrays.textureCoordinates = AssetPack::view<Vector3f>(file, chunk.arrays[AssetPack::TEXTURE_COORDINATES]);
+	arrays.normals = AssetPack::view<Vector3f>(file, chunk.arrays[AssetPack::NORMALS]);
+	arrays.faces = AssetPack::view<FaceVector>(file, chunk.arrays[AssetPack::FACES]);
+	arrays.tangents = AssetPack::view<Vector3f>(file, chunk.arrays[AssetPack::TANGENTS]);
+	arrays.bitangentSigns = AssetPack::view<float>(file, chunk.arrays[AssetPack::BITANGENT_SIGNS]);
+	arrays.faceTangents = AssetPack::view<Vector3i>(file, chunk.arrays[AssetPack::FACE_TANGENTS]);
+
+	// the indices are checked the first time a chunk is used rather than when the file is
+	// opened, which would read every chunk, and a corrupt chunk draws nothing
+	if (!checked[index]) {
+		checked[index] = true;
+		indicesFit[index] = AssetPack::indicesFit(arrays.vertices, arrays.textureCoordinates, arrays.normals, arrays.faces, arrays.tangents, arrays.bitangentSigns, arrays.faceTangents);
+	}
+	if (!indicesFit[index]) {
+		return Arrays();
+	}
+	return arrays;
+}
+
+void ChunkedGeometry::prefetch(size_t index) {
+	const Chunk &chunk = chunks[index];
+	if (resident[index] || residentBytes + chunk.size > budget) {
+		return;
+	}
+	resident[index] = true;
+	residentBytes += static_cast<size_t>(chunk.size);
+	positions[index] = leastRecentlyUsed.insert(leastRecentlyUsed.begin(), index);
+	file.prefetch(static_cast<size_t>(chunk.offset), static_cast<size_t>(chunk.size));
+}
+
+void ChunkedGeometry::release(size_t index) {
+	const Chunk &chunk = chunks[index];
+	file.release(static_cast<size_t>(chunk.offset), static_cast<size_t>(chunk.size));
+	leastRecentlyUsed.erase(positions[index]);
+	resident[index] = false;
+	residentBytes -= static_cast<size_t>(chunk.size);
+}
\ No newline at end of file
@@ -0,0 +1,92 @@
+#pragma once
+
+#include <cstdint>
+#include <list>
+#include <string>
+#include <vector>
+
+#include "AssetPack.h"
+#include "MappedFile.h"
+#include "ObjFile.h"
+#include "../types/ArrayView.h"
+#include "../types/Vector3.h"
+
+// Geometry of a mesh larger than memory, kept in a memory mapped chunk file. The faces
+// are sorted along a Morton curve of their centroids and cut into chunks of nearby faces
+// that index their own vertices, so every chunk can be culled and drawn on its own.
+// Chunks start on page boundaries and are paged in when acquired. At most budget bytes
+// of chunks stay resident, the least recently used ones are released back to the OS.
+class ChunkedGeometry {
+public:
+	// arrays of a mesh or a chunk, laid out like the views of Mesh
+	struct Arrays {
+		ArrayView<Vector3f> vertices;
+		ArrayView<Vector3f> textureCoordinates;
+		ArrayView<Vector3f> normals;
+		ArrayView<FaceVector> faces;
+		ArrayView<Vector3f> tangents;
+		ArrayView<float> bitangentSigns;
+		ArrayView<Vector3i> faceTangents;
+	};
+
+	ChunkedGeometry(const std::string &path, size_t budget);
+
+	// sorts the faces of the mesh and writes them as chunks of at most facesPerChunk faces
+	static bool createChunkFile(const std::string &path, const Arrays &mesh, int facesPerChunk);
+
+	bool isOpen() const { return !chunks.empty(); }
+	size_t getChunkCount() const { return chunks.size(); }
+	// corners of the axis aligned box around the vertices of the mesh or of a chunk
+	const Vector3f& getBoundsMin() const { return boundsMin; }
+	const Vector3f& getBoundsMax() const { return boundsMax; }
+	void getChunkBounds(size_t index, Vector3f &min, Vector3f &max) const;
+	size_t getResidentBytes() const { return residentBytes; }
+	void setBudget(size_t bytes) { budget = bytes; }
+
+	// Marks the chunk as the most recently used and returns its arrays, which stay valid
+	// until the next acquire. The least recently used chunks over the budget are released.
+	// A chunk with indices past its arrays comes back empty.
+	Arrays acquire(size_t index);
+	// asks the OS to read the chunk ahead when it isn't resident and fits in the budget
+	void prefetch(size_t index);
+
+private:
+	static const char MAGIC[4];
+	static const uint32_t VERSION = 1;
+	// chunks start on multiples of the largest common page size
+	static const uint64_t CHUNK_ALIGNMENT = 1 << 14;
+
+	struct Header {
+		char magic[4];
+		uint32_t version;
+		float boundsMin[3];
+		float boundsMax[3];
+		// Chunk elements
+		AssetPack::Array chunks;
+	};
+
+	struct Chunk {
+		float boundsMin[3];
+		float boundsMax[3];
+		// bytes of the file holding the arrays
+		uint64_t offset;
+		uint64_t size;
+		AssetPack::Array arrays[AssetPack::ARRAY_COUNT];
+	};
+
+	MappedFile file;
+	ArrayView<Chunk> chunks;
+	Vector3f boundsMin;
+	Vector3f boundsMax;
+
+	size_t budget;
+	size_t residentBytes;
+	std::vector<bool> resident;
+	// whether the indices of a chunk were checked against its arrays and fit them
+	std::vector<bool> checked;
+	std::vector<bool> indicesFit;
+	std::list<size_t> leastRecentlyUsed;
+	std::vector<std::list<size_t>::iterator> positions;
+
+	void release(size_t index);
+};
\ No newline at end of file
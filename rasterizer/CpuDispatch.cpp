@@ -0,0 +1,139 @@
+#include "CpuDispatch.h"
+
+#include <atomic>
+#include <cstdlib>
+#include <cstring>
+
+#include "../types/Floatx8.h"
+
+#if defined(FLOATX8_X86) && defined(_MSC_VER)
+#include <intrin.h>
+#elif defined(FLOATX8_X86)
+#include <cpuid.h>
+#endif
+
+namespace {
+
+#ifdef FLOATX8_X86
+	struct CpuidRegisters {
+		unsigned int eax, ebx, ecx, edx;
+	};
+
+	CpuidRegisters cpuid(unsigned int leaf, unsigned int subleaf) {
+		CpuidRegisters registers = {};
+#ifdef _MSC_VER
+		int values[4];
+		__cpuidex(values, leaf, subleaf);
+		registers.eax = values[0];
+		registers.ebx = values[1];
+		registers.ecx = values[2];
+		registers.edx = values[3];
+#else
+		__cpuid_count(leaf, subleaf, registers.eax, registers.ebx, registers.ecx, registers.edx);
+#endif
+		return registers;
+	}
+
+	// register state the operating system saves on context switches
+	unsigned long long xgetbv() {
+#ifdef _MSC_VER
+		return _xgetbv(0);
+#else
+		unsigned int low, high;
+		__asm__ volatile("xgetbv" : "=a"(low), "=d"(high) : "c"(0));
+		return (static_cast<unsigned long long>(high) << 32) | low;
+#endif
+	}
+
+	bool has(unsigned int value, int bit) {
+		return (value >> bit) & 1;
+	}
+#endif
+
+	CpuIsa detectIsa() {
+#ifdef FLOATX8_X86
+		const unsigned int maxLeaf = cpuid(0, 0).eax;
+		const CpuidRegisters features = cpuid(1, 0);
+		if (!has(features.edx, 26)) {
+			return CpuIsa::SCALAR;
+		}
+		if (!has(features.ecx, 19) || !has(features.ecx, 20) || !has(features.ecx, 23)) {
+			return CpuIsa::SSE2;
+		}
+
+		// the ymm and zmm registers also need the operating system to save them
+		if (maxLeaf < 7 || !has(features.ecx, 27) || !has(features.ecx, 28)) {
+			return CpuIsa::SSE42;
+		}
+		const unsigned long long saved = xgetbv();
+		const CpuidRegisters extended = cpuid(7, 0);
+		if ((saved & 0x6) != 0x6 || !has(extended.ebx, 5)) {
+			return CpuIsa::SSE42;
+		}
+		if ((saved & 0xE6) != 0xE6 || !has(extended.ebx, 16) || !has(extended.ebx, 17) || !has(extended.ebx, 30) || !has(extended.ebx, 31)) {
+			return CpuIsa::AVX2;
+		}
+		return CpuIsa::AVX512;
+#else
+		return CpuIsa::SCALAR;
+#endif
+	}
+
+	const KernelTable& kernelsOf(CpuIsa isa) {
+		switch (isa) {
+			case CpuIsa::AVX512: return simd_avx512::kernelTable();
+			case CpuIsa::AVX2: return simd_avx2::kernelTable();
+			case CpuIsa::SSE42: return simd_sse42::kernelTable();
+			case CpuIsa::SSE2: return simd_sse2::kernelTable();
+			default: return simd_scalar::kernelTable();
+		}
+	}
+
+	// the supported kernels, lowered by SOFTWARE_RENDERER_ISA
+	const KernelTable* initialKernels() {
+		CpuIsa isa = CpuDispatch::getSupportedIsa();
+		if (const char *forced = std::getenv("SOFTWARE_RENDERER_ISA")) {
+			for (int i = static_cast<int>(CpuIsa::SCALAR); i <= static_cast<int>(CpuIsa::AVX512); i++) {
+				if (std::strcmp(forced, CpuDispatch::getIsaName(static_cast<CpuIsa>(i))) == 0 && i < static_cast<int>(isa)) {
+					isa = static_cast<CpuIsa>(i);
+				}
+			}
+		}
+		return &kernelsOf(isa);
+	}
+
+	std::atomic<const KernelTable*>& activeKernels() {
+		static std::atomic<const KernelTable*> active(initialKernels());
+		return active;
+	}
+}
+
+CpuIsa CpuDispatch::getSupportedIsa() {
+	static const CpuIsa supported = detectIsa();
+	return supported;
+}
+
+CpuIsa CpuDispatch::getActiveIsa() {
+	return kernels().isa;
+}
+
+void CpuDispatch::forceIsa(CpuIsa isa) {
+	if (static_cast<int>(isa) > static_cast<int>(getSupportedIsa())) {
+		isa = getSupportedIsa();
+	}
+	activeKernels().store(&kernelsOf(isa));
+}
+
+const char* CpuDispatch::getIsaName(CpuIsa isa) {
+	switch (isa) {
+		case CpuIsa::AVX512: return "avx512";
+		case CpuIsa::AVX2: return "avx2";
+		case CpuIsa::SSE42: return "sse4.2";
+		case CpuIsa::SSE2: return "sse2";
+		default: return "scalar";
+	}
+}
+
+const KernelTable& CpuDispatch::kernels() {
+	return *activeKernels().load(std::memory_order_acquire);
+}
\ No newline at end of file
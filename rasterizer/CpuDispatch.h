@@ -0,0 +1,74 @@
+#pragma once
+
+#include <cstddef>
+
+#include "../types/Types.h"
+#include "../types/Matrix.h"
+#include "../types/VertexFormat.h"
+#include "../types/FragmentBatch.h"
+
+// Instruction sets with their own build of the kernels, from the oldest to the newest
+enum class CpuIsa : int {
+	SCALAR = 0,
+	SSE2,
+	SSE42,
+	AVX2,
+	AVX512
+};
+
+// Hot loops of the pipeline, written once against Floatx8 in KernelsImpl.h and built
+// once per instruction set by the Kernels*.cpp files. Interfaces only take plain
+// arrays, Floatx8 is laid out differently for every instruction set.
+struct KernelTable {
+	CpuIsa isa;
+
+	// see VertexKernels
+	void (*transformPoints)(const Matrix4f &matrix, const Vector3f *points, size_t count, float *outX, float *outY, float *outZ);
+	void (*transformQuantizedPoints)(const Matrix4f &matrix, const QuantizedPosition *points, size_t count, float *outX, float *outY, float *outZ);
+	void (*transformOctahedralPoints)(const Matrix4f &matrix, const OctahedralNormal *points, size_t count, float *outX, float *outY, float *outZ);
+	void (*transformDirections)(const Matrix4f &matrix, const Vector3f *directions, size_t count, float *outX, float *outY, float *outZ);
+	void (*lightIntensities)(const Vector3f *normals, size_t count, const Vector3f &lightDirection, float *out);
+	void (*octahedralLightIntensities)(const OctahedralNormal *normals, size_t count, const Vector3f &lightDirection, float *out);
+
+	// Writes the barycentric coordinates of the batch at (batch.x, batch.y) in the
+	// triangle with screen positions v0, v1, v2 and returns the mask of the lanes
+	// inside both the triangle and box
+	int (*coverage)(FragmentBatch &batch, const Vector3f &v0, const Vector3f &v1, const Vector3f &v2, const BoundingBox &box);
+	// Interpolates the depth of the lanes in mask and keeps those in front of zBuffer,
+	// writing their depth. The whole batch has to be inside the buffer.
+	int (*depthTest)(const FragmentBatch &batch, int mask, const Vector3f &v0, const Vector3f &v1, const Vector3f &v2, float *zBuffer, int width);
+	// clears count colours to black and count depths to depth
+	void (*clear)(RGBA *colours, float *depths, size_t count, float depth);
+
+	// reads four bytes at texels + offsets for the lanes in mask and splits them in channels
+	void (*gatherTexels)(const byte *texels, const int offsets[FragmentBatch::SIZE], int mask, float channels[4][FragmentBatch::SIZE]);
+	// gatherTexels with the four bytes kept as a colour
+	void (*gatherColours)(const byte *texels, const int offsets[FragmentBatch::SIZE], int mask, RGBA colours[FragmentBatch::SIZE]);
+	// channels in [0, 255] rounded to bytes
+	void (*packColours)(const float channels[4][FragmentBatch::SIZE], RGBA colours[FragmentBatch::SIZE]);
+	// RGBA::applyLightIntensity on every lane through Colourx8, the intensities are
+	// already in fixed point (see RGBA::fixedIntensity)
+	void (*lightColours)(const int intensities[FragmentBatch::SIZE], RGBA colours[FragmentBatch::SIZE]);
+};
+
+// tables of every instruction set, each defined by its Kernels*.cpp
+namespace simd_scalar { const KernelTable& kernelTable(); }
+namespace simd_sse2 { const KernelTable& kernelTable(); }
+namespace simd_sse42 { const KernelTable& kernelTable(); }
+namespace simd_avx2 { const KernelTable& kernelTable(); }
+namespace simd_avx512 { const KernelTable& kernelTable(); }
+
+// Picks the kernels of the newest instruction set the processor and the operating
+// system support, once at startup. The environment variable SOFTWARE_RENDERER_ISA
+// (scalar, sse2, sse4.2, avx2 or avx512) or forceIsa lower it, to compare the tiers
+// on one machine.
+namespace CpuDispatch {
+	CpuIsa getSupportedIsa();
+	CpuIsa getActiveIsa();
+	// Switches to the kernels of isa, or of the newest supported one when it is not
+	// supported. Not meant to be called while a frame is drawn.
+	void forceIsa(CpuIsa isa);
+	const char* getIsaName(CpuIsa isa);
+
+	const KernelTable& kernels();
+}
\ No newline at end of file
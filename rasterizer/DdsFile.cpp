@@ -0,0 +1,110 @@
+#include "DdsFile.h"
+
+#include <fstream>
+#include <iterator>
+#include <cstring>
+#include <algorithm>
+#include <limits>
+
+namespace {
+	const int HEADER_SIZE = 4 + 124;
+	const int DX10_HEADER_SIZE = 20;
+
+	// offsets into the file of the fields of the header
+	const int HEIGHT = 12;
+	const int WIDTH = 16;
+	const int MIP_MAP_COUNT = 28;
+	const int FOUR_CC = 84;
+
+	unsigned int read32(const std::vector<byte> &file, size_t offset) {
+		unsigned int value;
+		std::memcpy(&value, file.data() + offset, 4);
+		return value;
+	}
+
+	unsigned int fourCC(const char *code) {
+		return code[0] | (code[1] << 8) | (code[2] << 16) | (code[3] << 24);
+	}
+
+	bool formatFromFourCC(unsigned int code, TextureFormat &format) {
+		if (code == fourCC("DXT1")) {
+			format = TextureFormat::BC1;
+		} else if (code == fourCC("DXT5")) {
+			format = TextureFormat::BC3;
+		} else if (code == fourCC("ATI1") || code == fourCC("BC4U")) {
+			format = TextureFormat::BC4;
+		} else if (code == fourCC("ATI2") || code == fourCC("BC5U")) {
+			format = TextureFormat::BC5;
+		} else {
+			return false;
+		}
+		return true;
+	}
+
+	bool formatFromDxgi(unsigned int dxgiFormat, TextureFormat &format) {
+		switch (dxgiFormat) {
+			// BC1_TYPELESS, BC1_UNORM, BC1_UNORM_SRGB
+			case 70: case 71: case 72: format = TextureFormat::BC1; return true;
+			// BC3_TYPELESS, BC3_UNORM, BC3_UNORM_SRGB
+			case 76: case 77: case 78: format = TextureFormat::BC3; return true;
+			// BC4_TYPELESS, BC4_UNORM
+			case 79: case 80: format = TextureFormat::BC4; return true;
+			// BC5_TYPELESS, BC5_UNORM
+			case 82: case 83: format = TextureFormat::BC5; return true;
+			default: return false;
+		}
+	}
+}
+
+bool DdsFile::load(const std::string &path, Texture &texture) {
+	std::ifstream stream(path, std::ifstream::in | std::ifstream::binary);
+	if (!stream.is_open()) {
+		return false;
+	}
+	const std::vector<byte> file((std::istreambuf_iterator<char>(stream)), std::istreambuf_iterator<char>());
+	if (file.size() < HEADER_SIZE || read32(file, 0) != fourCC("DDS ")) {
+		return false;
+	}
+
+	Texture result;
+	size_t offset = HEADER_SIZE;
+	const unsigned int code = read32(file, FOUR_CC);
+	if (code == fourCC("DX10")) {
+		if (file.size() < HEADER_SIZE + DX10_HEADER_SIZE || !formatFromDxgi(read32(file, HEADER_SIZE), result.format)) {
+			return false;
+		}
+		offset += DX10_HEADER_SIZE;
+	} else if (!formatFromFourCC(code, result.format)) {
+		return false;
+	}
+
+	const int width = static_cast<int>(read32(file, WIDTH));
+	const int height = static_cast<int>(read32(file, HEIGHT));
+	const int mipMapCount = std::max(1, static_cast<int>(read32(file, MIP_MAP_COUNT)));
+	if (width <= 0 || height <= 0) {
+		return false;
+	}
+	// sizes are counted in size_t and every level has to be in the file, so the int
+	// pitches and offsets of the levels can't overflow
+	size_t size = 0;
+	for (int i = 0; i < mipMapCount; i++) {
+		const int levelWidth = std::max(1, width >> i), levelHeight = std::max(1, height >> i);
+		const size_t pitch = (static_cast<size_t>(levelWidth) + 3) / 4 * result.blockSize();
+		const size_t levelSize = (static_cast<size_t>(levelHeight) + 3) / 4 * pitch;
+		if (levelSize > file.size() - offset - size || size + levelSize > static_cast<size_t>(std::numeric_limits<int>::max())) {
+			return false;
+		}
+		MipLevel level = { levelWidth, levelHeight, static_cast<int>(pitch), static_cast<int>(size), levelWidth * 256.0f, levelHeight * 256.0f };
+		size += levelSize;
+		result.levels.push_back(level);
+		if (levelWidth == 1 && levelHeight == 1) {
+			break;
+		}
+	}
+
+	result.texels.assign(file.begin() + offset, file.begin() + offset + size);
+	result.topDown = true;
+	result.id = Texture::createId();
+	std::swap(texture, result);
+	return true;
+}
\ No newline at end of file
@@ -0,0 +1,12 @@
+#pragma once
+
+#include <string>
+#include "Texture.h"
+
+// Reader of DDS files holding BC1, BC3, BC4 or BC5 blocks with their mip levels,
+// in the legacy FourCC form or with the DX10 header
+namespace DdsFile {
+
+	// false when the file can't be read or holds another format
+	bool load(const std::string &path, Texture &texture);
+}
\ No newline at end of file
@@ -0,0 +1,66 @@
+#include "FramePipeline.h"
+
+#include <cassert>
+
+namespace {
+	// the queues have room for every frame in flight, they are never full
+	void pushFrame(BoundedQueue<int> &queue, int slot) {
+		const bool pushed = queue.push(slot);
+		assert(pushed);
+		(void)pushed;
+	}
+}
+
+FramePipeline::FramePipeline(JobSystem &jobs, int depth, Stage geometry, Stage raster) : jobs(jobs), depth(depth), drawn(depth), submitted(0), finished(0), group(jobs) {
+	assert(depth > 0);
+	stages.emplace_back(new StageQueue(geometry, depth));
+	stages.emplace_back(new StageQueue(raster, depth));
+}
+
+FramePipeline::~FramePipeline() {
+	group.wait();
+}
+
+void FramePipeline::submit() {
+	assert(getFramesInFlight() < depth);
+	pushFrame(stages[0]->input, getNextSlot());
+	submitted++;
+	start(0);
+}
+
+int FramePipeline::waitForFrame() {
+	assert(getFramesInFlight() > 0);
+	int slot = 0;
+	jobs.waitUntil([this, &slot]() { return drawn.pop(slot); });
+	finished++;
+	return slot;
+}
+
+void FramePipeline::start(int stage) {
+	// Orders the frame queued before the check of running, like drain orders clearing
+	// running before its last look at the queue, so one of the two sees the other
+	std::atomic_thread_fence(std::memory_order_seq_cst);
+	if (stages[stage]->running.exchange(true, std::memory_order_acq_rel)) {
+		return;
+	}
+	group.run([this, stage]() { drain(stage); });
+}
+
+void FramePipeline::drain(int stage) {
+	StageQueue &current = *stages[stage];
+	do {
+		int slot;
+		while (current.input.pop(slot)) {
+			current.run(slot);
+			if (stage + 1 < STAGE_COUNT) {
+				pushFrame(stages[stage + 1]->input, slot);
+				start(stage + 1);
+			} else {
+				pushFrame(drawn, slot);
+			}
+		}
+		current.running.store(false, std::memory_order_release);
+		std::atomic_thread_fence(std::memory_order_seq_cst);
+		// a frame queued after the last pop may have found the stage still running
+	} while (!current.input.empty() && !current.running.exchange(true, std::memory_order_acq_rel));
+}
\ No newline at end of file
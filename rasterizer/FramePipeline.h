@@ -0,0 +1,108 @@
+#pragma once
+
+#include <atomic>
+#include <cstddef>
+#include <functional>
+#include <memory>
+#include <vector>
+
+#include "JobSystem.h"
+
+// Lock-free queue of a fixed capacity for a single producer and a single consumer. The
+// producer and the consumer may change threads as long as their turns are ordered, like
+// the jobs of a pipeline stage.
+template <typename T>
+class BoundedQueue {
+public:
+	explicit BoundedQueue(size_t capacity) : items(capacity + 1), head(0), tail(0) {}
+
+	// false when the queue is full
+	bool push(const T &item) {
+		const size_t last = tail.load(std::memory_order_relaxed);
+		const size_t next = (last + 1) % items.size();
+		if (next == head.load(std::memory_order_acquire)) {
+			return false;
+		}
+		items[last] = item;
+		tail.store(next, std::memory_order_release);
+		return true;
+	}
+
+	// false when the queue is empty
+	bool pop(T &item) {
+		const size_t first = head.load(std::memory_order_relaxed);
+		if (first == tail.load(std::memory_order_acquire)) {
+			return false;
+		}
+		item = items[first];
+		head.store((first + 1) % items.size(), std::memory_order_release);
+		return true;
+	}
+
+	bool empty() const { return head.load(std::memory_order_acquire) == tail.load(std::memory_order_acquire); }
+
+private:
+	// one more than the capacity, a full queue leaves one free to tell it from an empty one
+	std::vector<T> items;
+	std::atomic<size_t> head;
+	std::atomic<size_t> tail;
+};
+
+// Runs frames through a geometry and a raster stage connected by bounded queues, so the
+// geometry of a frame overlaps the raster of the frames before it. Every stage runs on
+// the job system as one job at a time, which takes the frames of its queue in order, and
+// the thread that submits the frames takes them back once they are drawn, to present them.
+//
+// Frames are named by the slot of the buffers they are drawn in, frame n in slot
+// n % getSlotCount(): one per frame in flight and one for the frame presented last,
+// which stays untouched until the next one is taken back.
+class FramePipeline {
+public:
+	typedef std::function<void(int slot)> Stage;
+
+	// at most depth frames in flight, the latency from submitting a frame to taking it
+	// back is depth - 1 frames
+	FramePipeline(JobSystem &jobs, int depth, Stage geometry, Stage raster);
+	// waits for the frames in flight, which aren't taken back
+	~FramePipeline();
+
+	int getDepth() const { return depth; }
+	int getSlotCount() const { return depth + 1; }
+	int getFramesInFlight() const { return static_cast<int>(submitted - finished); }
+	// slot of the next frame, free to be filled until it's submitted
+	int getNextSlot() const { return static_cast<int>(submitted % getSlotCount()); }
+
+	// starts the frame in the next slot, there have to be fewer than depth in flight
+	void submit();
+	// waits for the oldest frame in flight, running jobs meanwhile, and returns its slot
+	int waitForFrame();
+
+private:
+	static const int STAGE_COUNT = 2;
+
+	struct StageQueue {
+		StageQueue(Stage run, int capacity) : run(run), input(capacity), running(false) {}
+
+		Stage run;
+		BoundedQueue<int> input;
+		// whether a job of the stage is queued or running
+		std::atomic<bool> running;
+	};
+
+	JobSystem &jobs;
+	const int depth;
+	std::vector<std::unique_ptr<StageQueue>> stages;
+	// frames drawn and not taken back yet
+	BoundedQueue<int> drawn;
+	// counters of the thread that submits the frames
+	size_t submitted;
+	size_t finished;
+	// jobs of the stages, waited on by the destructor
+	TaskGroup group;
+
+	void start(int stage);
+	void drain(int stage);
+
+	FramePipeline(const FramePipeline&) = delete;
+	FramePipeline& operator=(const FramePipeline&) = delete;
+};
\ No newline at end of file
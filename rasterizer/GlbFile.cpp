@@ -0,0 +1,364 @@
+#include "GlbFile.h"
+#include "Json.h"
+
+#include <cmath>
+#include <cstdint>
+#include <cstring>
+
+namespace {
+	const uint32_t MAGIC = 0x46546C67;
+	const uint32_t JSON_CHUNK = 0x4E4F534A;
+	const uint32_t BINARY_CHUNK = 0x004E4942;
+
+	const int FLOAT = 5126;
+	const int UNSIGNED_INT = 5125;
+	const int UNSIGNED_SHORT = 5123;
+	const int UNSIGNED_BYTE = 5121;
+	const int TRIANGLES = 4;
+
+	// node hierarchies deeper than this are taken as cycles
+	const int MAX_DEPTH = 64;
+
+	// column major 4x4 matrix, as glTF stores them
+	struct Transform {
+		float m[16];
+
+		static Transform identity() {
+			Transform t = { { 1, 0, 0, 0, 0, 1, 0, 0, 0, 0, 1, 0, 0, 0, 0, 1 } };
+			return t;
+		}
+
+		bool isIdentity() const {
+			const Transform i = identity();
+			return std::memcmp(m, i.m, sizeof(m)) == 0;
+		}
+
+		Transform operator*(const Transform &other) const {
+			Transform result;
+			for (int column = 0; column < 4; column++) {
+				for (int row = 0; row < 4; row++) {
+					float sum = 0.0f;
+					for (int k = 0; k < 4; k++) {
+						sum += m[k * 4 + row] * other.m[column * 4 + k];
+					}
+					result.m[column * 4 + row] = sum;
+				}
+			}
+			return result;
+		}
+
+		Vector3f point(const Vector3f &p) const {
+			return Vector3f(m[0] * p.x + m[4] * p.y + m[8] * p.z + m[12], m[1] * p.x + m[5] * p.y + m[9] * p.z + m[13], m[2] * p.x + m[6] * p.y + m[10] * p.z + m[14]);
+		}
+
+		// normals go through the cofactors of the upper 3x3, the inverse transpose up to scale
+		Vector3f normal(const Vector3f &n) const {
+			const float a = m[0], b = m[4], c = m[8], d = m[1], e = m[5], f = m[9], g = m[2], h = m[6], i = m[10];
+			const Vector3f result(
+				(e * i - f * h) * n.x + (f * g - d * i) * n.y + (d * h - e * g) * n.z,
+				(c * h - b * i) * n.x + (a * i - c * g) * n.y + (b * g - a * h) * n.z,
+				(b * f - c * e) * n.x + (c * d - a * f) * n.y + (a * e - b * d) * n.z);
+			const float length = std::sqrt(result.x * result.x + result.y * result.y + result.z * result.z);
+			return length > 0.0f ? result * (1.0f / length) : result;
+		}
+	};
+
+	// local transform of a node, a matrix or translation, rotation and scale
+	Transform nodeTransform(const JsonValue &node) {
+		Transform t = Transform::identity();
+		const JsonValue &matrix = node["matrix"];
+		if (matrix.size() == 16) {
+			for (int i = 0; i < 16; i++) {
+				t.m[i] = static_cast<float>(matrix[i].asNumber());
+			}
+			return t;
+		}
+
+		const JsonValue &translation = node["translation"];
+		const JsonValue &rotation = node["rotation"];
+		const JsonValue &scale = node["scale"];
+		const float x = static_cast<float>(rotation[0].asNumber(0.0)), y = static_cast<float>(rotation[1].asNumber(0.0));
+		const float z = static_cast<float>(rotation[2].asNumber(0.0)), w = static_cast<float>(rotation[3].asNumber(1.0));
+		const float sx = static_cast<float>(scale[0].asNumber(1.0)), sy = static_cast<float>(scale[1].asNumber(1.0)), sz = static_cast<float>(scale[2].asNumber(1.0));
+		const float rotationMatrix[9] = {
+			1 - 2 * (y * y + z * z), 2 * (x * y + z * w), 2 * (x * z - y * w),
+			2 * (x * y - z * w), 1 - 2 * (x * x + z * z), 2 * (y * z + x * w),
+			2 * (x * z + y * w), 2 * (y * z - x * w), 1 - 2 * (x * x + y * y)
+		};
+		const float scales[3] = { sx, sy, sz };
+		for (int column = 0; column < 3; column++) {
+			for (int row = 0; row < 3; row++) {
+				t.m[column * 4 + row] = rotationMatrix[column * 3 + row] * scales[column];
+			}
+		}
+		for (int i = 0; i < 3; i++) {
+			t.m[12 + i] = static_cast<float>(translation[i].asNumber(0.0));
+		}
+		return t;
+	}
+
+	struct Primitive {
+		const JsonValue *primitive;
+		Transform transform;
+	};
+
+	void collectPrimitives(const JsonValue &json, int nodeIndex, const Transform &parent, int depth, std::vector<Primitive> &primitives) {
+		const JsonValue &node = json["nodes"][nodeIndex];
+		if (node.isNull() || depth > MAX_DEPTH) {
+			return;
+		}
+		const Transform transform = parent * nodeTransform(node);
+		const JsonValue &meshPrimitives = json["meshes"][node["mesh"].asInt(-1)]["primitives"];
+		for (size_t i = 0; i < meshPrimitives.size(); i++) {
+			if (meshPrimitives[i]["mode"].asInt(TRIANGLES) == TRIANGLES) {
+				Primitive primitive = { &meshPrimitives[i], transform };
+				primitives.push_back(primitive);
+			}
+		}
+		const JsonValue &children = node["children"];
+		for (size_t i = 0; i < children.size(); i++) {
+			collectPrimitives(json, children[i].asInt(-1), transform, depth + 1, primitives);
+		}
+	}
+
+	// elements of an accessor in the binary chunk
+	struct Accessor {
+		const byte *data;
+		size_t count;
+		size_t stride;
+		int componentType;
+		int components;
+		bool normalized;
+
+		int componentSize() const {
+			return componentType == UNSIGNED_BYTE ? 1 : componentType == UNSIGNED_SHORT ? 2 : 4;
+		}
+
+		float component(size_t index, int component) const {
+			const byte *element = data + index * stride + component * componentSize();
+			if (componentType == FLOAT) {
+				float value;
+				std::memcpy(&value, element, 4);
+				return value;
+			}
+			const unsigned int value = integer(element);
+			if (!normalized) {
+				return static_cast<float>(value);
+			}
+			return componentType == UNSIGNED_BYTE ? value / 255.0f : value / 65535.0f;
+		}
+
+		unsigned int integer(const byte *element) const {
+			if (componentType == UNSIGNED_BYTE) {
+				return element[0];
+			}
+			if (componentType == UNSIGNED_SHORT) {
+				uint16_t value;
+				std::memcpy(&value, element, 2);
+				return value;
+			}
+			uint32_t value;
+			std::memcpy(&value, element, 4);
+			return value;
+		}
+	};
+
+	int componentCount(const std::string &type) {
+		return type == "SCALAR" ? 1 : type == "VEC2" ? 2 : type == "VEC3" ? 3 : type == "VEC4" ? 4 : 0;
+	}
+
+	// false when the accessor is missing or reaches past its buffer view
+	bool readAccessor(const JsonValue &json, const JsonValue &index, ArrayView<byte> binary, Accessor &accessor) {
+		const JsonValue &description = json["accessors"][index.asInt(-1)];
+		const JsonValue &bufferView = json["bufferViews"][description["bufferView"].asInt(-1)];
+		if (description.isNull() || bufferView.isNull() || bufferView["buffer"].asInt(-1) != 0) {
+			return false;
+		}
+
+		accessor.componentType = description["componentType"].asInt();
+		accessor.components = componentCount(description["type"].asString());
+		accessor.count = static_cast<size_t>(description["count"].asNumber());
+		accessor.normalized = description["normalized"].asBool();
+		if (accessor.components == 0 || (accessor.componentType != FLOAT && accessor.componentType != UNSIGNED_INT && accessor.componentType != UNSIGNED_SHORT && accessor.componentType != UNSIGNED_BYTE)) {
+			return false;
+		}
+
+		const size_t elementSize = accessor.components * accessor.componentSize();
+		const size_t viewOffset = static_cast<size_t>(bufferView["byteOffset"].asNumber());
+		const size_t viewLength = static_cast<size_t>(bufferView["byteLength"].asNumber());
+		const size_t offset = static_cast<size_t>(description["byteOffset"].asNumber());
+		accessor.stride = static_cast<size_t>(bufferView["byteStride"].asNumber(static_cast<double>(elementSize)));
+		if (viewOffset > binary.size() || viewLength > binary.size() - viewOffset || accessor.stride < elementSize) {
+			return false;
+		}
+		if (accessor.count > 0 && (offset > viewLength || (accessor.count - 1) > (viewLength - offset - elementSize) / accessor.stride || viewLength - offset < elementSize)) {
+			return false;
+		}
+		accessor.data = binary.data() + viewOffset + offset;
+		return true;
+	}
+
+	// the accessor as an array of Vector3f, empty when it isn't laid out like one
+	ArrayView<Vector3f> inPlace(const Accessor &accessor) {
+		if (accessor.componentType != FLOAT || accessor.components != 3 || accessor.stride != sizeof(Vector3f) || reinterpret_cast<uintptr_t>(accessor.data) % 4 != 0) {
+			return ArrayView<Vector3f>();
+		}
+		return ArrayView<Vector3f>(reinterpret_cast<const Vector3f*>(accessor.data), accessor.count);
+	}
+
+	GlbFile::Image readImage(const JsonValue &json, const JsonValue &textureInfo, ArrayView<byte> binary, const std::string &directory) {
+		GlbFile::Image image;
+		const JsonValue &description = json["images"][json["textures"][textureInfo["index"].asInt(-1)]["source"].asInt(-1)];
+		const JsonValue &bufferView = json["bufferViews"][description["bufferView"].asInt(-1)];
+		const std::string &uri = description["uri"].asString();
+		if (!bufferView.isNull() && bufferView["buffer"].asInt(-1) == 0) {
+			const size_t offset = static_cast<size_t>(bufferView["byteOffset"].asNumber());
+			const size_t length = static_cast<size_t>(bufferView["byteLength"].asNumber());
+			if (offset <= binary.size() && length <= binary.size() - offset) {
+				image.data = ArrayView<byte>(binary.data() + offset, length);
+			}
+		} else if (!uri.empty() && uri.compare(0, 5, "data:") != 0) {
+			image.path = directory + uri;
+		}
+		return image;
+	}
+
+	// area weighted normals of the faces around every vertex from first on
+	void computeNormals(GlbFile::Model &model, size_t firstVertex, size_t firstFace) {
+		for (size_t i = firstFace; i < model.faces.size(); i++) {
+			const FaceVector &face = model.faces[i];
+			const Vector3f &a = model.vertices[face[0].x];
+			const Vector3f normal = (model.vertices[face[1].x] - a).cross(model.vertices[face[2].x] - a);
+			for (int j = 0; j < 3; j++) {
+				model.normals[face[j].x] = model.normals[face[j].x] + normal;
+			}
+		}
+		for (size_t i = firstVertex; i < model.normals.size(); i++) {
+			Vector3f &normal = model.normals[i];
+			const float length = std::sqrt(normal.x * normal.x + normal.y * normal.y + normal.z * normal.z);
+			normal = length > 0.0f ? normal * (1.0f / length) : Vector3f(0.0f, 0.0f, 1.0f);
+		}
+	}
+}
+
+namespace GlbFile {
+
+	bool load(const std::string &path, Model &model) {
+		model = Model();
+		std::shared_ptr<const MappedFile> file = std::make_shared<MappedFile>(path);
+		if (!file->isOpen() || file->size() < 20) {
+			return false;
+		}
+
+		// 12 byte header, then chunks of a length, a type and the data
+		uint32_t header[5];
+		std::memcpy(header, file->data(), sizeof(header));
+		if (header[0] != MAGIC || header[1] != 2 || header[3] > file->size() - 20 || header[4] != JSON_CHUNK) {
+			return false;
+		}
+		const char *text = reinterpret_cast<const char*>(file->data() + 20);
+		JsonValue json;
+		if (!JsonValue::parse(text, header[3], json)) {
+			return false;
+		}
+
+		ArrayView<byte> binary;
+		const size_t binaryHeader = 20 + ((header[3] + 3) & ~3u);
+		if (file->size() >= binaryHeader + 8) {
+			uint32_t chunk[2];
+			std::memcpy(chunk, file->data() + binaryHeader, sizeof(chunk));
+			if (chunk[1] == BINARY_CHUNK && chunk[0] <= file->size() - binaryHeader - 8) {
+				binary = ArrayView<byte>(file->data() + binaryHeader + 8, chunk[0]);
+			}
+		}
+
+		// the nodes of the scene, or every mesh when there is no scene
+		std::vector<Primitive> primitives;
+		const JsonValue &scene = json["scenes"][json["scene"].asInt(0)];
+		if (!scene.isNull()) {
+			const JsonValue &nodes = scene["nodes"];
+			for (size_t i = 0; i < nodes.size(); i++) {
+				collectPrimitives(json, nodes[i].asInt(-1), Transform::identity(), 0, primitives);
+			}
+		} else {
+			for (size_t mesh = 0; mesh < json["meshes"].size(); mesh++) {
+				const JsonValue &meshPrimitives = json["meshes"][mesh]["primitives"];
+				for (size_t i = 0; i < meshPrimitives.size(); i++) {
+					if (meshPrimitives[i]["mode"].asInt(TRIANGLES) == TRIANGLES) {
+						Primitive primitive = { &meshPrimitives[i], Transform::identity() };
+						primitives.push_back(primitive);
+					}
+				}
+			}
+		}
+
+		for (const Primitive &primitive : primitives) {
+			const JsonValue &attributes = (*primitive.primitive)["attributes"];
+			Accessor positions, normals, textureCoordinates, indices;
+			if (!readAccessor(json, attributes["POSITION"], binary, positions) || positions.components != 3) {
+				return false;
+			}
+			const bool hasNormals = readAccessor(json, attributes["NORMAL"], binary, normals) && normals.components == 3 && normals.count == positions.count;
+			const bool hasTextureCoordinates = readAccessor(json, attributes["TEXCOORD_0"], binary, textureCoordinates) && textureCoordinates.components == 2 && textureCoordinates.count == positions.count;
+			const bool indexed = !(*primitive.primitive)["indices"].isNull();
+			if (indexed && (!readAccessor(json, (*primitive.primitive)["indices"], binary, indices) || indices.components != 1 || indices.componentType == FLOAT)) {
+				return false;
+			}
+
+			// a lone primitive without transform is used where it is, unless the
+			// normals have to be computed from the positions
+			if (primitives.size() == 1 && primitive.transform.isIdentity() && hasNormals) {
+				model.mappedVertices = inPlace(positions);
+				model.mappedNormals = inPlace(normals);
+			}
+
+			const size_t firstVertex = model.vertices.size();
+			const size_t firstFace = model.faces.size();
+			if (model.mappedVertices.empty()) {
+				for (size_t i = 0; i < positions.count; i++) {
+					const Vector3f position(positions.component(i, 0), positions.component(i, 1), positions.component(i, 2));
+					model.vertices.push_back(primitive.transform.point(position));
+				}
+			}
+			if (model.mappedNormals.empty()) {
+				for (size_t i = 0; i < positions.count; i++) {
+					const Vector3f normal = hasNormals ? Vector3f(normals.component(i, 0), normals.component(i, 1), normals.component(i, 2)) : Vector3f(0.0f, 0.0f, 0.0f);
+					model.normals.push_back(hasNormals ? primitive.transform.normal(normal) : normal);
+				}
+			}
+			for (size_t i = 0; i < positions.count; i++) {
+				const float u = hasTextureCoordinates ? textureCoordinates.component(i, 0) : 0.0f;
+				const float v = hasTextureCoordinates ? textureCoordinates.component(i, 1) : 0.0f;
+				model.textureCoordinates.emplace_back(u, 1.0f - v, 0.0f);
+			}
+
+			const size_t cornerCount = indexed ? indices.count : positions.count;
+			for (size_t i = 0; i + 2 < cornerCount; i += 3) {
+				FaceVector face;
+				for (int j = 0; j < 3; j++) {
+					const size_t index = indexed ? indices.integer(indices.data + (i + j) * indices.stride) : i + j;
+					if (index >= positions.count) {
+						return false;
+					}
+					const int corner = static_cast<int>(firstVertex + index);
+					face[j] = Vector3i(corner, corner, corner);
+				}
+				model.faces.push_back(face);
+			}
+
+			if (!hasNormals) {
+				computeNormals(model, firstVertex, firstFace);
+			}
+		}
+
+		const size_t separator = path.find_last_of("/\\");
+		const std::string directory = separator == std::string::npos ? "" : path.substr(0, separator + 1);
+		if (!primitives.empty()) {
+			const JsonValue &material = json["materials"][(*primitives[0].primitive)["material"].asInt(-1)];
+			model.baseColour = readImage(json, material["pbrMetallicRoughness"]["baseColorTexture"], binary, directory);
+			model.normalMap = readImage(json, material["normalTexture"], binary, directory);
+		}
+		model.file = file;
+		return true;
+	}
+}
\ No newline at end of file
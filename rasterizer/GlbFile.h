@@ -0,0 +1,42 @@
+#pragma once
+
+#include <memory>
+#include <string>
+#include <vector>
+#include "MappedFile.h"
+#include "ObjFile.h"
+#include "../types/ArrayView.h"
+
+// Reader of binary glTF 2.0 files. The triangles of every mesh in the scene are
+// merged into one model with the transforms of their nodes applied. With a single
+// primitive, no transform and tightly packed floats the positions and normals are
+// read in place from the binary chunk, everything else is converted. Texture
+// coordinates always are, glTF puts v = 0 at the top of the image.
+namespace GlbFile {
+
+	// image in the binary chunk, or a file next to the GLB file
+	struct Image {
+		ArrayView<byte> data;
+		std::string path;
+		bool empty() const { return data.empty() && path.empty(); }
+	};
+
+	struct Model {
+		// keeps the views into the binary chunk alive
+		std::shared_ptr<const MappedFile> file;
+		// positions and normals read in place, the vectors are empty then
+		ArrayView<Vector3f> mappedVertices;
+		ArrayView<Vector3f> mappedNormals;
+		std::vector<Vector3f> vertices;
+		std::vector<Vector3f> textureCoordinates;
+		std::vector<Vector3f> normals;
+		// every corner uses the same index for the three attributes
+		std::vector<FaceVector> faces;
+		// textures of the material of the first primitive, empty when it has none
+		Image baseColour;
+		Image normalMap;
+	};
+
+	// false when the file can't be read, isn't GLB or references data outside it
+	bool load(const std::string &path, Model &model);
+}
\ No newline at end of file
@@ -0,0 +1,241 @@
+#include "JobSystem.h"
+
+#include <cassert>
+#include <cstdlib>
+#include <cstring>
+
+#ifdef _WIN32
+#define WIN32_LEAN_AND_MEAN
+#define NOMINMAX
+#include <windows.h>
+#elif defined(__linux__)
+#include <pthread.h>
+#include <sched.h>
+#endif
+
+namespace {
+	// the pool and queue of the calling thread, queue 0 outside of the workers
+	thread_local const JobSystem *currentSystem = nullptr;
+	thread_local int currentQueue = 0;
+
+	void pinThread(std::thread &thread, int processor) {
+#ifdef _WIN32
+		SetThreadAffinityMask(thread.native_handle(), static_cast<DWORD_PTR>(1) << (processor % (sizeof(DWORD_PTR) * 8)));
+#elif defined(__linux__)
+		cpu_set_t processors;
+		CPU_ZERO(&processors);
+		CPU_SET(processor % CPU_SETSIZE, &processors);
+		pthread_setaffinity_np(thread.native_handle(), sizeof(processors), &processors);
+#else
+		(void)thread;
+		(void)processor;
+#endif
+	}
+}
+
+TaskGroup::TaskGroup(JobSystem &jobs, bool background) : jobs(jobs), background(background), pending(0) {}
+
+TaskGroup::~TaskGroup() {
+	wait();
+}
+
+void TaskGroup::run(std::function<void()> task) {
+	pending.fetch_add(1, std::memory_order_relaxed);
+	JobSystem::Job job;
+	job.task = std::move(task);
+	job.group = this;
+	jobs.push(std::move(job));
+}
+
+void TaskGroup::wait() {
+	while (pending.load(std::memory_order_acquire) != 0) {
+		if (!jobs.runQueuedJob(this)) {
+			std::this_thread::yield();
+		}
+	}
+}
+
+JobSystem::JobSystem(int workerCount, bool pinThreads) : queuedJobs(0), queuedBackgroundJobs(0), stopping(false) {
+	workerCount = std::max(workerCount, 0);
+	for (int i = 0; i <= workerCount; i++) {
+		queues.emplace_back(new Queue());
+	}
+	for (int i = 0; i < workerCount; i++) {
+		workers.emplace_back(&JobSystem::work, this, i + 1, false);
+		if (pinThreads) {
+			pinThread(workers.back(), i + 1);
+		}
+	}
+	if (workerCount == 0) {
+		queues.emplace_back(new Queue());
+		backgroundWorker = std::thread(&JobSystem::work, this, 1, true);
+	}
+}
+
+JobSystem::~JobSystem() {
+	{
+		std::lock_guard<std::mutex> lock(sleepMutex);
+		stopping = true;
+	}
+	wake.notify_all();
+	for (std::thread &worker : workers) {
+		worker.join();
+	}
+	if (backgroundWorker.joinable()) {
+		backgroundWorker.join();
+	}
+}
+
+JobSystem& JobSystem::shared() {
+	static JobSystem jobs([]() {
+		int threads = static_cast<int>(std::thread::hardware_concurrency());
+		if (const char *forced = std::getenv("SOFTWARE_RENDERER_THREADS")) {
+			threads = std::atoi(forced);
+		}
+		return std::max(threads, 1) - 1;
+	}(), []() {
+		const char *pin = std::getenv("SOFTWARE_RENDERER_PIN_THREADS");
+		return pin != nullptr && std::strcmp(pin, "1") == 0;
+	}());
+	return jobs;
+}
+
+void JobSystem::push(Job job) {
+	const bool background = job.group->background;
+	Queue &queue = background ? backgroundQueue : *queues[queueOfThisThread()];
+	{
+		std::lock_guard<std::mutex> lock(queue.mutex);
+		queue.jobs.push_back(std::move(job));
+	}
+	(background ? queuedBackgroundJobs : queuedJobs).fetch_add(1, std::memory_order_release);
+
+	// taking the lock orders the wake up after the check of a worker going to sleep
+	{
+		std::lock_guard<std::mutex> lock(sleepMutex);
+	}
+	wake.notify_one();
+}
+
+bool JobSystem::runQueuedJob(const TaskGroup *group) {
+	// a background group keeps its jobs in the background queue only
+	if (group != nullptr && group->background) {
+		Job job;
+		if (queuedBackgroundJobs.load(std::memory_order_acquire) == 0 || !popJob(backgroundQueue, false, group, job)) {
+			return false;
+		}
+		runJob(job);
+		return true;
+	}
+	if (queuedJobs.load(std::memory_order_acquire) == 0) {
+		return false;
+	}
+
+	// the newest job of our own queue is the one whose data is warmest, the oldest of the
+	// others is the largest part of their work left
+	const int own = queueOfThisThread();
+	const int count = static_cast<int>(queues.size());
+	Job job;
+	bool found = popJob(*queues[own], true, group, job);
+	for (int i = 1; i < count && !found; i++) {
+		found = popJob(*queues[(own + i) % count], false, group, job);
+	}
+	if (!found) {
+		return false;
+	}
+	runJob(job);
+	return true;
+}
+
+bool JobSystem::runBackgroundJob() {
+	Job job;
+	if (queuedBackgroundJobs.load(std::memory_order_acquire) == 0 || !popJob(backgroundQueue, false, nullptr, job)) {
+		return false;
+	}
+	runJob(job);
+	return true;
+}
+
+bool JobSystem::popJob(Queue &source, bool back, const TaskGroup *group, Job &job) {
+	std::lock_guard<std::mutex> lock(source.mutex);
+	const size_t count = source.jobs.size();
+	for (size_t i = 0; i < count; i++) {
+		const size_t index = back ? count - 1 - i : i;
+		if (group != nullptr && source.jobs[index].group != group) {
+			continue;
+		}
+		job = std::move(source.jobs[index]);
+		source.jobs.erase(source.jobs.begin() + index);
+		(job.group->background ? queuedBackgroundJobs : queuedJobs).fetch_sub(1, std::memory_order_relaxed);
+		return true;
+	}
+	return false;
+}
+
+void JobSystem::runJob(Job &job) {
+	job.task();
+	job.group->pending.fetch_sub(1, std::memory_order_release);
+}
+
+void JobSystem::work(int queue, bool backgroundOnly) {
+	currentSystem = this;
+	currentQueue = queue;
+	// jobs of the frames come first, the background ones only when there are none
+	const auto hasJobs = [this, backgroundOnly]() {
+		return queuedBackgroundJobs.load(std::memory_order_acquire) > 0 || (!backgroundOnly && queuedJobs.load(std::memory_order_acquire) > 0);
+	};
+	while (true) {
+		if ((!backgroundOnly && runQueuedJob()) || runBackgroundJob()) {
+			continue;
+		}
+		std::unique_lock<std::mutex> lock(sleepMutex);
+		wake.wait(lock, [this, &hasJobs]() { return stopping || hasJobs(); });
+		if (stopping && !hasJobs()) {
+			return;
+		}
+	}
+}
+
+int JobSystem::queueOfThisThread() const {
+	return currentSystem == this ? currentQueue : 0;
+}
+
+int TaskGraph::add(std::function<void()> task, const std::vector<int> &dependencies) {
+	const int index = static_cast<int>(nodes.size());
+	std::unique_ptr<Node> node(new Node());
+	node->task = std::move(task);
+	node->dependencyCount = static_cast<int>(dependencies.size());
+	node->remaining = 0;
+	for (int dependency : dependencies) {
+		assert(dependency >= 0 && dependency < index);
+		nodes[dependency]->successors.push_back(index);
+	}
+	nodes.push_back(std::move(node));
+	return index;
+}
+
+void TaskGraph::run(JobSystem &jobs) {
+	for (std::unique_ptr<Node> &node : nodes) {
+		node->remaining.store(node->dependencyCount, std::memory_order_relaxed);
+	}
+	TaskGroup group(jobs);
+	for (size_t i = 0; i < nodes.size(); i++) {
+		if (nodes[i]->dependencyCount == 0) {
+			start(group, static_cast<int>(i));
+		}
+	}
+	group.wait();
+}
+
+// the successors are queued before the node counts as done, so the group never
+// runs out of pending jobs while the graph still has nodes to run
+void TaskGraph::start(TaskGroup &group, int node) {
+	group.run([this, &group, node]() {
+		Node &current = *nodes[node];
+		current.task();
+		for (int successor : current.successors) {
+			if (nodes[successor]->remaining.fetch_sub(1, std::memory_order_acq_rel) == 1) {
+				start(group, successor);
+			}
+		}
+	});
+}
\ No newline at end of file
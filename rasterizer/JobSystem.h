@@ -0,0 +1,171 @@
+#pragma once
+
+#include <algorithm>
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+class JobSystem;
+
+// Jobs that are waited on together. Waiting runs the queued jobs of this group until
+// they are done, so jobs can wait on groups of their own without blocking a worker,
+// and a thread never picks up a long job of another group while it waits. The
+// destructor waits.
+class TaskGroup {
+public:
+	// Jobs of a background group, like loads, are only taken by idle workers and by
+	// threads waiting on the group itself, so they never hold up a frame
+	explicit TaskGroup(JobSystem &jobs, bool background = false);
+	~TaskGroup();
+
+	void run(std::function<void()> task);
+	void wait();
+
+private:
+	friend class JobSystem;
+
+	JobSystem &jobs;
+	const bool background;
+	std::atomic<int> pending;
+
+	TaskGroup(const TaskGroup&) = delete;
+	TaskGroup& operator=(const TaskGroup&) = delete;
+};
+
+// Fixed pool of worker threads shared by every parallel stage, from loading to the
+// tiles of a frame, so stages never add threads of their own. Every worker owns a
+// deque of jobs: it pushes and pops at the back, and idle threads steal from the front
+// of the others. Threads that are not workers queue their jobs in a deque of their own.
+// Jobs of background groups wait in one more deque, in order, for workers with nothing
+// else to do.
+class JobSystem {
+public:
+	// workerCount threads besides the ones that wait on jobs. With pinThreads worker i
+	// runs on logical processor i + 1 only, leaving the first one to the main thread.
+	// Without workers one thread runs the background jobs alone, so they still load
+	// while the thread that draws never takes them.
+	explicit JobSystem(int workerCount, bool pinThreads = false);
+	~JobSystem();
+
+	// Pool of the process, created on first use with a worker per logical processor but
+	// one. The environment variable SOFTWARE_RENDERER_THREADS sets the number of threads,
+	// the main thread included, and SOFTWARE_RENDERER_PIN_THREADS=1 pins them.
+	static JobSystem& shared();
+
+	// threads that run jobs, with the one waiting on them
+	int getThreadCount() const { return static_cast<int>(workers.size()) + 1; }
+
+	// Calls body(begin, end) on ranges that split [first, last) in pieces of at least
+	// grain indices and returns once every range is done. The calling thread takes the
+	// first range, and nothing is queued when there is a single one.
+	template <typename Body>
+	void parallelFor(size_t first, size_t last, size_t grain, const Body &body) {
+		if (last <= first) {
+			return;
+		}
+		const size_t count = last - first;
+		const size_t ranges = std::min(static_cast<size_t>(getThreadCount()) * RANGES_PER_THREAD, (count + grain - 1) / std::max<size_t>(grain, 1));
+		if (ranges <= 1) {
+			body(first, last);
+			return;
+		}
+
+		TaskGroup group(*this);
+		for (size_t i = 1; i < ranges; i++) {
+			const size_t begin = first + count * i / ranges;
+			const size_t end = first + count * (i + 1) / ranges;
+			group.run([&body, begin, end]() { body(begin, end); });
+		}
+		body(first, first + count / ranges);
+		group.wait();
+	}
+
+	// Runs queued jobs, but background ones, until done() is true, for threads that wait
+	// on something other than a group, like the frames of a pipeline
+	template <typename Condition>
+	void waitUntil(const Condition &done) {
+		while (!done()) {
+			if (!runQueuedJob()) {
+				std::this_thread::yield();
+			}
+		}
+	}
+
+private:
+	friend class TaskGroup;
+
+	// ranges of parallelFor per thread, more than one evens out uneven ranges
+	static const size_t RANGES_PER_THREAD = 4;
+
+	struct Job {
+		std::function<void()> task;
+		TaskGroup *group;
+	};
+
+	struct Queue {
+		std::mutex mutex;
+		std::deque<Job> jobs;
+	};
+
+	// queue 0 is shared by the threads that are not workers, worker i owns queue i + 1
+	std::vector<std::unique_ptr<Queue>> queues;
+	std::vector<std::thread> workers;
+	std::atomic<int> queuedJobs;
+	// jobs of background groups, oldest first
+	Queue backgroundQueue;
+	std::atomic<int> queuedBackgroundJobs;
+	// runs the background jobs when there are no workers, with the last queue
+	std::thread backgroundWorker;
+
+	std::mutex sleepMutex;
+	std::condition_variable wake;
+	bool stopping;
+
+	void push(Job job);
+	// Runs one job of group, or of any group but the background ones without it, from
+	// the queue of the calling thread first, and returns false when there was none
+	bool runQueuedJob(const TaskGroup *group = nullptr);
+	// runs the oldest background job and returns false when there was none
+	bool runBackgroundJob();
+	// takes the job nearest to the back or the front that belongs to group, or any job
+	// without it
+	bool popJob(Queue &source, bool back, const TaskGroup *group, Job &job);
+	void runJob(Job &job);
+	void work(int queue, bool backgroundOnly);
+	int queueOfThisThread() const;
+
+	JobSystem(const JobSystem&) = delete;
+	JobSystem& operator=(const JobSystem&) = delete;
+};
+
+// Jobs with dependencies between them, like the stages of a frame. Dependencies are
+// nodes added before, so the graph has no cycles. Every run starts the nodes without
+// dependencies, and the others once the last of their dependencies is done. A graph
+// can be run again once a run returned.
+class TaskGraph {
+public:
+	// returns the node, to name it as a dependency of later ones
+	int add(std::function<void()> task, const std::vector<int> &dependencies = std::vector<int>());
+	size_t size() const { return nodes.size(); }
+	void clear() { nodes.clear(); }
+
+	// runs every node on jobs and returns once they are all done
+	void run(JobSystem &jobs);
+
+private:
+	struct Node {
+		std::function<void()> task;
+		std::vector<int> successors;
+		int dependencyCount;
+		std::atomic<int> remaining;
+	};
+	std::vector<std::unique_ptr<Node>> nodes;
+
+	void start(TaskGroup &group, int node);
+};
\ No newline at end of file
@@ -0,0 +1,252 @@
+#include "Json.h"
+
+#include <cstdlib>
+#include <cstring>
+
+namespace {
+	const JsonValue NULL_VALUE;
+	// deeper documents are rejected instead of overflowing the stack
+	const int MAX_DEPTH = 128;
+}
+
+class JsonParser {
+public:
+	JsonParser(const char *text, size_t size) : p(text), end(text + size) {}
+
+	bool parseDocument(JsonValue &value) {
+		if (!parseValue(value, 0)) {
+			return false;
+		}
+		skipSpaces();
+		return p == end;
+	}
+
+private:
+	const char *p;
+	const char *end;
+
+	void skipSpaces() {
+		while (p < end && (*p == ' ' || *p == '\t' || *p == '\n' || *p == '\r')) {
+			p++;
+		}
+	}
+
+	bool consume(const char *literal) {
+		const size_t length = std::strlen(literal);
+		if (static_cast<size_t>(end - p) < length || std::memcmp(p, literal, length) != 0) {
+			return false;
+		}
+		p += length;
+		return true;
+	}
+
+	bool parseValue(JsonValue &value, int depth) {
+		skipSpaces();
+		if (p == end || depth > MAX_DEPTH) {
+			return false;
+		}
+
+		switch (*p) {
+			case '{': return parseObject(value, depth);
+			case '[': return parseArray(value, depth);
+			case '"':
+				value.type = JsonValue::Type::STRING;
+				return parseString(value.string);
+			case 't':
+				value.type = JsonValue::Type::BOOLEAN;
+				value.boolean = true;
+				return consume("true");
+			case 'f':
+				value.type = JsonValue::Type::BOOLEAN;
+				value.boolean = false;
+				return consume("false");
+			case 'n':
+				value.type = JsonValue::Type::NUL;
+				return consume("null");
+			default:
+				value.type = JsonValue::Type::NUMBER;
+				return parseNumber(value.number);
+		}
+	}
+
+	bool parseObject(JsonValue &value, int depth) {
+		value.type = JsonValue::Type::OBJECT;
+		p++;
+		skipSpaces();
+		if (p < end && *p == '}') {
+			p++;
+			return true;
+		}
+		for (;;) {
+			skipSpaces();
+			std::string key;
+			if (p == end || *p != '"' || !parseString(key)) {
+				return false;
+			}
+			skipSpaces();
+			if (p == end || *p++ != ':') {
+				return false;
+			}
+			value.keys.push_back(key);
+			value.values.push_back(JsonValue());
+			if (!parseValue(value.values.back(), depth + 1)) {
+				return false;
+			}
+			skipSpaces();
+			if (p == end) {
+				return false;
+			}
+			const char separator = *p++;
+			if (separator == '}') {
+				return true;
+			}
+			if (separator != ',') {
+				return false;
+			}
+		}
+	}
+
+	bool parseArray(JsonValue &value, int depth) {
+		value.type = JsonValue::Type::ARRAY;
+		p++;
+		skipSpaces();
+		if (p < end && *p == ']') {
+			p++;
+			return true;
+		}
+		for (;;) {
+			value.values.push_back(JsonValue());
+			if (!parseValue(value.values.back(), depth + 1)) {
+				return false;
+			}
+			skipSpaces();
+			if (p == end) {
+				return false;
+			}
+			const char separator = *p++;
+			if (separator == ']') {
+				return true;
+			}
+			if (separator != ',') {
+				return false;
+			}
+		}
+	}
+
+	bool parseHex(unsigned int &code) {
+		if (end - p < 4) {
+			return false;
+		}
+		code = 0;
+		for (int i = 0; i < 4; i++, p++) {
+			const char c = *p;
+			const int digit = c >= '0' && c <= '9' ? c - '0' : c >= 'a' && c <= 'f' ? c - 'a' + 10 : c >= 'A' && c <= 'F' ? c - 'A' + 10 : -1;
+			if (digit < 0) {
+				return false;
+			}
+			code = code * 16 + digit;
+		}
+		return true;
+	}
+
+	void appendUtf8(unsigned int code, std::string &string) {
+		if (code < 0x80) {
+			string += static_cast<char>(code);
+		} else if (code < 0x800) {
+			string += static_cast<char>(0xC0 | (code >> 6));
+			string += static_cast<char>(0x80 | (code & 0x3F));
+		} else if (code < 0x10000) {
+			string += static_cast<char>(0xE0 | (code >> 12));
+			string += static_cast<char>(0x80 | ((code >> 6) & 0x3F));
+			string += static_cast<char>(0x80 | (code & 0x3F));
+		} else {
+			string += static_cast<char>(0xF0 | (code >> 18));
+			string += static_cast<char>(0x80 | ((code >> 12) & 0x3F));
+			string += static_cast<char>(0x80 | ((code >> 6) & 0x3F));
+			string += static_cast<char>(0x80 | (code & 0x3F));
+		}
+	}
+
+	bool parseString(std::string &string) {
+		p++;
+		while (p < end && *p != '"') {
+			if (*p != '\\') {
+				string += *p++;
+				continue;
+			}
+			if (++p == end) {
+				return false;
+			}
+			const char escape = *p++;
+			switch (escape) {
+				case '"': string += '"'; break;
+				case '\\': string += '\\'; break;
+				case '/': string += '/'; break;
+				case 'b': string += '\b'; break;
+				case 'f': string += '\f'; break;
+				case 'n': string += '\n'; break;
+				case 'r': string += '\r'; break;
+				case 't': string += '\t'; break;
+				case 'u': {
+					unsigned int code;
+					if (!parseHex(code)) {
+						return false;
+					}
+					// characters past the first plane come as a pair of surrogates
+					unsigned int low;
+					if (code >= 0xD800 && code < 0xDC00 && consume("\\u") && parseHex(low) && low >= 0xDC00 && low < 0xE000) {
+						code = 0x10000 + ((code - 0xD800) << 10) + (low - 0xDC00);
+					}
+					appendUtf8(code, string);
+					break;
+				}
+				default:
+					return false;
+			}
+		}
+		if (p == end) {
+			return false;
+		}
+		p++;
+		return true;
+	}
+
+	bool parseNumber(double &number) {
+		// strtod needs a terminated string
+		char token[64];
+		size_t length = 0;
+		while (p + length < end && length < sizeof(token) - 1 && std::strchr("+-0123456789.eE", p[length]) != nullptr) {
+			token[length] = p[length];
+			length++;
+		}
+		token[length] = '\0';
+		char *parsed;
+		number = std::strtod(token, &parsed);
+		if (length == 0 || parsed != token + length) {
+			return false;
+		}
+		p += length;
+		return true;
+	}
+};
+
+bool JsonValue::parse(const char *text, size_t size, JsonValue &value) {
+	value = JsonValue();
+	JsonParser parser(text, size);
+	return parser.parseDocument(value);
+}
+
+const JsonValue& JsonValue::operator[](size_t index) const {
+	return type == Type::ARRAY && index < values.size() ? values[index] : NULL_VALUE;
+}
+
+const JsonValue& JsonValue::operator[](const std::string &key) const {
+	if (type == Type::OBJECT) {
+		for (size_t i = 0; i < keys.size(); i++) {
+			if (keys[i] == key) {
+				return values[i];
+			}
+		}
+	}
+	return NULL_VALUE;
+}
\ No newline at end of file
@@ -0,0 +1,46 @@
+#pragma once
+
+#include <string>
+#include <vector>
+
+// Minimal reader of JSON documents, enough for the glTF description in GLB files.
+// Lookups of missing members or elements return a null value, so paths can be chained.
+class JsonValue {
+public:
+	enum class Type : int {
+		NUL = 0,
+		BOOLEAN,
+		NUMBER,
+		STRING,
+		ARRAY,
+		OBJECT
+	};
+
+	JsonValue() : type(Type::NUL), number(0.0), boolean(false) {}
+
+	// false when text isn't a whole JSON document
+	static bool parse(const char *text, size_t size, JsonValue &value);
+
+	Type getType() const { return type; }
+	bool isNull() const { return type == Type::NUL; }
+	double asNumber(double fallback = 0.0) const { return type == Type::NUMBER ? number : fallback; }
+	int asInt(int fallback = 0) const { return type == Type::NUMBER ? static_cast<int>(number) : fallback; }
+	bool asBool(bool fallback = false) const { return type == Type::BOOLEAN ? boolean : fallback; }
+	const std::string& asString() const { return string; }
+
+	// elements of an array or members of an object
+	size_t size() const { return values.size(); }
+	const JsonValue& operator[](size_t index) const;
+	const JsonValue& operator[](const std::string &key) const;
+
+private:
+	Type type;
+	double number;
+	bool boolean;
+	std::string string;
+	// member names of an object, in the order of values
+	std::vector<std::string> keys;
+	std::vector<JsonValue> values;
+
+	friend class JsonParser;
+};
\ No newline at end of file
@@ -0,0 +1,2 @@
+#define FLOATX8_ISA FLOATX8_ISA_AVX512
+#include "KernelsImpl.h"
\ No newline at end of file
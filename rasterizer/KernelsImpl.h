@@ -0,0 +1,251 @@
+// Kernels of the dispatch table, written once against Floatx8. Every Kernels*.cpp
+// defines FLOATX8_ISA and includes this file once, so it has no #pragma once. Only
+// headers that do not use Floatx8 can be included before it.
+#include <cstring>
+
+#include "CpuDispatch.h"
+#include "../types/Floatx8.h"
+#include "../types/Vector3fx8.h"
+#include "../types/Colourx8.h"
+
+FLOATX8_BEGIN_TARGET
+namespace FLOATX8_NAMESPACE {
+namespace {
+
+	// loads up to eight vertices and splits them into x, y and z lanes
+	void loadVectors(const Vector3f *vectors, size_t count, Floatx8 &x, Floatx8 &y, Floatx8 &z) {
+		float lanes[3][Floatx8::LANES] = {};
+		for (size_t i = 0; i < count; i++) {
+			lanes[0][i] = vectors[i].x;
+			lanes[1][i] = vectors[i].y;
+			lanes[2][i] = vectors[i].z;
+		}
+		x = Floatx8::load(lanes[0]);
+		y = Floatx8::load(lanes[1]);
+		z = Floatx8::load(lanes[2]);
+	}
+
+	// positions in quantized units, the matrix of the kernel scales them to the bounds
+	void loadVectors(const QuantizedPosition *positions, size_t count, Floatx8 &x, Floatx8 &y, Floatx8 &z) {
+		float lanes[3][Floatx8::LANES] = {};
+		for (size_t i = 0; i < count; i++) {
+			lanes[0][i] = positions[i].x;
+			lanes[1][i] = positions[i].y;
+			lanes[2][i] = positions[i].z;
+		}
+		x = Floatx8::load(lanes[0]);
+		y = Floatx8::load(lanes[1]);
+		z = Floatx8::load(lanes[2]);
+	}
+
+	// unit normals unfolded from the octahedron, see VertexEncoding::decodeOctahedral
+	void loadVectors(const OctahedralNormal *normals, size_t count, Floatx8 &x, Floatx8 &y, Floatx8 &z) {
+		float lanes[2][Floatx8::LANES] = {};
+		for (size_t i = 0; i < count; i++) {
+			lanes[0][i] = normals[i].x;
+			lanes[1][i] = normals[i].y;
+		}
+		const Floatx8 zero(0.0f), one(1.0f), scale(1.0f / VertexEncoding::OCTAHEDRAL_SCALE);
+		x = Floatx8::load(lanes[0]) * scale;
+		y = Floatx8::load(lanes[1]) * scale;
+		z = one - Floatx8::max(x, zero - x) - Floatx8::max(y, zero - y);
+		const Floatx8 fold = Floatx8::max(zero - z, zero);
+		x = x + Floatx8::select(x >= zero, zero - fold, fold);
+		y = y + Floatx8::select(y >= zero, zero - fold, fold);
+		const Floatx8 inversedMagnitude = one / Floatx8::sqrt(x * x + y * y + z * z);
+		x = x * inversedMagnitude;
+		y = y * inversedMagnitude;
+		z = z * inversedMagnitude;
+	}
+
+	void storeLanes(const Floatx8 &value, size_t count, float *out) {
+		if (count == Floatx8::LANES) {
+			value.store(out);
+		} else {
+			float lanes[Floatx8::LANES];
+			value.store(lanes);
+			for (size_t i = 0; i < count; i++) {
+				out[i] = lanes[i];
+			}
+		}
+	}
+
+	template <typename Point>
+	void transformPointsOf(const Matrix4f &matrix, const Point *points, size_t count, float *outX, float *outY, float *outZ) {
+		Floatx8 m[4][4];
+		for (int r = 0; r < 4; r++) {
+			for (int c = 0; c < 4; c++) {
+				m[r][c] = Floatx8(matrix[r][c]);
+			}
+		}
+
+		for (size_t i = 0; i < count; i += Floatx8::LANES) {
+			const size_t lanes = count - i < Floatx8::LANES ? count - i : Floatx8::LANES;
+			Floatx8 x, y, z;
+			loadVectors(points + i, lanes, x, y, z);
+
+			// same order of operations as Matrix4f * homogeneous vector
+			Floatx8 w = m[3][0] * x + m[3][1] * y + m[3][2] * z + m[3][3];
+			storeLanes((m[0][0] * x + m[0][1] * y + m[0][2] * z + m[0][3]) / w, lanes, outX + i);
+			storeLanes((m[1][0] * x + m[1][1] * y + m[1][2] * z + m[1][3]) / w, lanes, outY + i);
+			storeLanes((m[2][0] * x + m[2][1] * y + m[2][2] * z + m[2][3]) / w, lanes, outZ + i);
+		}
+	}
+
+	template <typename Normal>
+	void lightIntensitiesOf(const Normal *normals, size_t count, const Vector3f &lightDirection, float *out) {
+		const Floatx8 lx(lightDirection.x), ly(lightDirection.y), lz(lightDirection.z);
+
+		for (size_t i = 0; i < count; i += Floatx8::LANES) {
+			const size_t lanes = count - i < Floatx8::LANES ? count - i : Floatx8::LANES;
+			Floatx8 x, y, z;
+			loadVectors(normals + i, lanes, x, y, z);
+
+			const Floatx8 inversedMagnitude = Floatx8(1.0f) / Floatx8::sqrt(x * x + y * y + z * z);
+			storeLanes((x * inversedMagnitude) * lx + (y * inversedMagnitude) * ly + (z * inversedMagnitude) * lz, lanes, out + i);
+		}
+	}
+
+	void transformPoints(const Matrix4f &matrix, const Vector3f *points, size_t count, float *outX, float *outY, float *outZ) {
+		transformPointsOf(matrix, points, count, outX, outY, outZ);
+	}
+
+	void transformQuantizedPoints(const Matrix4f &matrix, const QuantizedPosition *points, size_t count, float *outX, float *outY, float *outZ) {
+		transformPointsOf(matrix, points, count, outX, outY, outZ);
+	}
+
+	void transformOctahedralPoints(const Matrix4f &matrix, const OctahedralNormal *points, size_t count, float *outX, float *outY, float *outZ) {
+		transformPointsOf(matrix, points, count, outX, outY, outZ);
+	}
+
+	void transformDirections(const Matrix4f &matrix, const Vector3f *directions, size_t count, float *outX, float *outY, float *outZ) {
+		Floatx8 m[3][3];
+		for (int r = 0; r < 3; r++) {
+			for (int c = 0; c < 3; c++) {
+				m[r][c] = Floatx8(matrix[r][c]);
+			}
+		}
+
+		for (size_t i = 0; i < count; i += Floatx8::LANES) {
+			const size_t lanes = count - i < Floatx8::LANES ? count - i : Floatx8::LANES;
+			Floatx8 x, y, z;
+			loadVectors(directions + i, lanes, x, y, z);
+
+			storeLanes(m[0][0] * x + m[0][1] * y + m[0][2] * z, lanes, outX + i);
+			storeLanes(m[1][0] * x + m[1][1] * y + m[1][2] * z, lanes, outY + i);
+			storeLanes(m[2][0] * x + m[2][1] * y + m[2][2] * z, lanes, outZ + i);
+		}
+	}
+
+	void lightIntensities(const Vector3f *normals, size_t count, const Vector3f &lightDirection, float *out) {
+		lightIntensitiesOf(normals, count, lightDirection, out);
+	}
+
+	void octahedralLightIntensities(const OctahedralNormal *normals, size_t count, const Vector3f &lightDirection, float *out) {
+		lightIntensitiesOf(normals, count, lightDirection, out);
+	}
+
+	int coverage(FragmentBatch &batch, const Vector3f &v0, const Vector3f &v1, const Vector3f &v2, const BoundingBox &box) {
+		static const float LANE_OFFSETS_X[FragmentBatch::SIZE] = { 0, 1, 0, 1, 2, 3, 2, 3 };
+		static const float LANE_OFFSETS_Y[FragmentBatch::SIZE] = { 0, 0, 1, 1, 0, 0, 1, 1 };
+
+		// a x b where a = (v2.x - v0.x, v1.x - v0.x, v0.x - point.x) and b the same for y
+		const float ax = v2.x - v0.x, ay = v1.x - v0.x;
+		const float bx = v2.y - v0.y, by = v1.y - v0.y;
+		const float uz = ax * by - ay * bx;
+		if (uz == 0) {
+			for (int i = 0; i < FragmentBatch::SIZE; i++) {
+				batch.barycentricX[i] = -1;
+				batch.barycentricY[i] = 1;
+				batch.barycentricZ[i] = 1;
+			}
+			return 0;
+		}
+
+		const Floatx8 x = Floatx8(static_cast<float>(batch.x)) + Floatx8::load(LANE_OFFSETS_X);
+		const Floatx8 y = Floatx8(static_cast<float>(batch.y)) + Floatx8::load(LANE_OFFSETS_Y);
+		const Floatx8 az = Floatx8(v0.x) - x;
+		const Floatx8 bz = Floatx8(v0.y) - y;
+		const Floatx8 ux = (Floatx8(ay) * bz) - (az * Floatx8(by));
+		const Floatx8 uy = (az * Floatx8(bx)) - (Floatx8(ax) * bz);
+
+		const Floatx8 barycentricX = Floatx8(1.f) - (ux + uy) / Floatx8(uz);
+		const Floatx8 barycentricY = uy / Floatx8(uz);
+		const Floatx8 barycentricZ = ux / Floatx8(uz);
+		barycentricX.store(batch.barycentricX);
+		barycentricY.store(batch.barycentricY);
+		barycentricZ.store(batch.barycentricZ);
+
+		const Floatx8 zero(0.0f);
+		const Floatx8 inside = (barycentricX >= zero) & (barycentricY >= zero) & (barycentricZ >= zero);
+		const Floatx8 inBox = (x >= Floatx8(static_cast<float>(box.min.x))) & (Floatx8(static_cast<float>(box.max.x)) >= x)
+			& (y >= Floatx8(static_cast<float>(box.min.y))) & (Floatx8(static_cast<float>(box.max.y)) >= y);
+		return (inside & inBox).movemask();
+	}
+
+	int depthTest(const FragmentBatch &batch, int mask, const Vector3f &v0, const Vector3f &v1, const Vector3f &v2, float *zBuffer, int width) {
+		const Floatx8 depth = Barycentricx8::load(batch.barycentricX, batch.barycentricY, batch.barycentricZ).interpolate(v0.z, v1.z, v2.z);
+		float *top = zBuffer + batch.x + batch.y * width;
+		float *bottom = top + width;
+		const Floatx8 current = Floatx8::loadQuads(top, bottom);
+		const Floatx8 passed = (current < depth) & Floatx8::fromMask(mask);
+		Floatx8::select(passed, depth, current).storeQuads(top, bottom);
+		return passed.movemask();
+	}
+
+	void clear(RGBA *colours, float *depths, size_t count, float depth) {
+		std::memset(colours, 0x00, sizeof(RGBA) * count);
+		Floatx8::fill(depths, count, depth);
+	}
+
+	void gatherTexels(const byte *texels, const int offsets[FragmentBatch::SIZE], int mask, float channels[4][FragmentBatch::SIZE]) {
+		const Intx8 packed = Intx8::gather(texels, Intx8::load(offsets), Floatx8::fromMask(mask));
+		for (int c = 0; c < 4; c++) {
+			((packed >> (c * 8)) & Intx8(0xFF)).toFloat().store(channels[c]);
+		}
+	}
+
+	void gatherColours(const byte *texels, const int offsets[FragmentBatch::SIZE], int mask, RGBA colours[FragmentBatch::SIZE]) {
+		int values[FragmentBatch::SIZE];
+		Intx8::gather(texels, Intx8::load(offsets), Floatx8::fromMask(mask)).store(values);
+		std::memcpy(colours, values, sizeof(values));
+	}
+
+	// RGBA is packed in an int with red in the lowest byte, as on little endian processors
+	void packColours(const float channels[4][FragmentBatch::SIZE], RGBA colours[FragmentBatch::SIZE]) {
+		Intx8 packed(0);
+		for (int c = 0; c < 4; c++) {
+			packed = packed | (((Floatx8::load(channels[c]) + Floatx8(0.5f)).toInt() & Intx8(0xFF)) << (c * 8));
+		}
+		int values[FragmentBatch::SIZE];
+		packed.store(values);
+		std::memcpy(colours, values, sizeof(values));
+	}
+
+	void lightColours(const int intensities[FragmentBatch::SIZE], RGBA colours[FragmentBatch::SIZE]) {
+		Colourx8::load(colours).scale(Intx8::load(intensities)).store(colours);
+	}
+}
+
+const KernelTable& kernelTable() {
+	// the FLOATX8_ISA numbers follow CpuIsa
+	static const KernelTable table = {
+		static_cast<CpuIsa>(FLOATX8_ISA),
+		transformPoints,
+		transformQuantizedPoints,
+		transformOctahedralPoints,
+		transformDirections,
+		lightIntensities,
+		octahedralLightIntensities,
+		coverage,
+		depthTest,
+		clear,
+		gatherTexels,
+		gatherColours,
+		packColours,
+		lightColours
+	};
+	return table;
+}
+}
+FLOATX8_END_TARGET
\ No newline at end of file
@@ -0,0 +1,2 @@
+#define FLOATX8_ISA FLOATX8_ISA_SSE2
+#include "KernelsImpl.h"
\ No newline at end of file
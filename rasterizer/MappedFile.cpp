@@ -0,0 +1,124 @@
+#include "MappedFile.h"
+
+#include <algorithm>
+
+#ifdef _WIN32
+#define WIN32_LEAN_AND_MEAN
+#define NOMINMAX
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+#ifdef _WIN32
+
+MappedFile::MappedFile(const std::string &path, bool sequential) : mapping(nullptr), length(0), opened(false), file(INVALID_HANDLE_VALUE), fileMapping(nullptr) {
+	file = CreateFileA(path.c_str(), GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING, sequential ? FILE_FLAG_SEQUENTIAL_SCAN : FILE_FLAG_RANDOM_ACCESS, nullptr);
+	LARGE_INTEGER fileSize;
+	if (file == INVALID_HANDLE_VALUE || !GetFileSizeEx(file, &fileSize)) {
+		return;
+	}
+	opened = true;
+	length = static_cast<size_t>(fileSize.QuadPart);
+	if (length == 0) {
+		return;
+	}
+
+	fileMapping = CreateFileMappingA(file, nullptr, PAGE_READONLY, 0, 0, nullptr);
+	if (fileMapping != nullptr) {
+		mapping = MapViewOfFile(fileMapping, FILE_MAP_READ, 0, 0, 0);
+	}
+}
+
+MappedFile::~MappedFile() {
+	if (mapping != nullptr) {
+		UnmapViewOfFile(mapping);
+	}
+	if (fileMapping != nullptr) {
+		CloseHandle(fileMapping);
+	}
+	if (file != INVALID_HANDLE_VALUE) {
+		CloseHandle(file);
+	}
+}
+
+void MappedFile::prefetch(size_t offset, size_t size) const {
+	if (mapping == nullptr || offset >= length) {
+		return;
+	}
+	WIN32_MEMORY_RANGE_ENTRY range = { static_cast<byte*>(mapping) + offset, std::min(size, length - offset) };
+	PrefetchVirtualMemory(GetCurrentProcess(), 1, &range, 0);
+}
+
+void MappedFile::release(size_t offset, size_t size) const {
+	// unlocking pages that aren't locked takes them out of the working set
+	if (mapping != nullptr && offset < length) {
+		VirtualUnlock(static_cast<byte*>(mapping) + offset, std::min(size, length - offset));
+	}
+}
+
+#else
+
+namespace {
+	size_t pageSize() {
+		static const size_t size = static_cast<size_t>(sysconf(_SC_PAGESIZE));
+		return size;
+	}
+}
+
+MappedFile::MappedFile(const std::string &path, bool sequential) : mapping(nullptr), length(0), opened(false) {
+	const int file = open(path.c_str(), O_RDONLY);
+	struct stat status;
+	if (file < 0) {
+		return;
+	}
+	if (fstat(file, &status) == 0) {
+		opened = true;
+		length = static_cast<size_t>(status.st_size);
+	}
+
+	if (opened && length > 0) {
+		void *address = mmap(nullptr, length, PROT_READ, MAP_PRIVATE, file, 0);
+		if (address != MAP_FAILED) {
+			mapping = address;
+			if (sequential) {
+				madvise(mapping, length, MADV_SEQUENTIAL);
+			}
+		}
+	}
+	// the mapping keeps its own reference to the file
+	close(file);
+}
+
+MappedFile::~MappedFile() {
+	if (mapping != nullptr) {
+		munmap(mapping, length);
+	}
+}
+
+void MappedFile::prefetch(size_t offset, size_t size) const {
+	if (mapping == nullptr || offset >= length) {
+		return;
+	}
+	// widened out to whole pages
+	const size_t start = offset / pageSize() * pageSize();
+	const size_t end = std::min(offset + size, length);
+	madvise(static_cast<byte*>(mapping) + start, end - start, MADV_WILLNEED);
+}
+
+void MappedFile::release(size_t offset, size_t size) const {
+	if (mapping == nullptr || offset >= length) {
+		return;
+	}
+	// narrowed down to whole pages, the pages at the ends may hold bytes outside the range
+	const size_t start = (offset + pageSize() - 1) / pageSize() * pageSize();
+	const size_t end = std::min(offset + size, length) / pageSize() * pageSize();
+	if (start < end) {
+		madvise(static_cast<byte*>(mapping) + start, end - start, MADV_DONTNEED);
+	}
+}
+
+#endif
\ No newline at end of file
@@ -0,0 +1,35 @@
+#pragma once
+
+#include <string>
+#include "../types/Types.h"
+
+// Read only memory mapping of a whole file. The pages are read by the OS as they
+// are touched, so opening is cheap whatever the size of the file.
+class MappedFile {
+public:
+	// sequential when the file is read front to back once, to read ahead more
+	MappedFile(const std::string &path, bool sequential = false);
+	~MappedFile();
+
+	MappedFile(const MappedFile&) = delete;
+	MappedFile& operator=(const MappedFile&) = delete;
+
+	bool isOpen() const { return opened && (mapping != nullptr || length == 0); }
+	const byte* data() const { return static_cast<const byte*>(mapping); }
+	size_t size() const { return length; }
+
+	// Hints for a range of the file: prefetch starts reading it ahead of its first use,
+	// release drops the pages wholly inside it from memory. Released pages are read
+	// from the file again when they are touched.
+	void prefetch(size_t offset, size_t size) const;
+	void release(size_t offset, size_t size) const;
+
+private:
+	void *mapping;
+	size_t length;
+	bool opened;
+#ifdef _WIN32
+	void *file;
+	void *fileMapping;
+#endif
+};
\ No newline at end of file
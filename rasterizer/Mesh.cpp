@@ -1,195 +1,938 @@
 #include "Mesh.h"
+#include "DdsFile.h"
+#include "AssetPack.h"
+#include "GlbFile.h"
+#include "CpuDispatch.h"
 
-#include <fstream>
-#include <sstream>
-#include <iostream>
+#include <cctype>
 #include <cmath>
+#include <cstring>
+#include <fstream>
+#include <unordered_map>
+#include <algorithm>
 
 #define STB_IMAGE_IMPLEMENTATION
+// the failure reason is a global that every probe for the image type writes,
+// which races when textures decode on several threads
+#define STBI_NO_FAILURE_STRINGS
 #include "stb_image.h"
 
-Mesh::Mesh() : model(Matrix4f::identity()) {
-	vertices.clear();
-	textureCoordinates.clear();
-	normals.clear();
-	faces.clear();
+Mesh::Mesh() : textureLayout(TextureLayout::LINEAR), textureCompression(false), virtualTextureBudget(256), chunkBudget(static_cast<size_t>(256) << 20), vertexFormat(VertexFormat::FLOAT), model(Matrix4f::identity()), dequantization(Matrix4f::identity()) {
 	spaceVertices.clear();
 }
 
 Mesh::~Mesh() {
-	if (diffuse.data != nullptr) {
-		stbi_image_free(diffuse.data);
+	stopLoading();
+}
+
+void Mesh::loadObjFromFile(const std::string& path) {
+	stopLoading();
+	mapping.reset();
+	chunks.reset();
+	loaded = Geometry();
+	const bool parsed = ObjFile::load(path, loaded.vertices, loaded.textureCoordinates, loaded.normals, loaded.faces);
+	assert(parsed);
+	if (!parsed) {
+		// a file that can't be read leaves an empty mesh rather than part of one
+		loaded = Geometry();
+	}
+	viewLoadedGeometry();
+	computeTangents();
+	computeBounds();
+	viewLoadedGeometry();
+	quantizeGeometry();
+}
+
+void Mesh::loadGlbFromFile(const std::string &path) {
+	GlbFile::Model model;
+	const bool parsed = GlbFile::load(path, model);
+	assert(parsed);
+	if (!parsed) {
+		// a file that can't be read leaves an empty mesh with placeholder textures
+		model = GlbFile::Model();
 	}
-	if (specularMap.data != nullptr) {
-		stbi_image_free(specularMap.data);
+
+	stopLoading();
+	mapping = model.file;
+	chunks.reset();
+	loaded = Geometry();
+	loaded.vertices.swap(model.vertices);
+	loaded.textureCoordinates.swap(model.textureCoordinates);
+	loaded.normals.swap(model.normals);
+	loaded.faces.swap(model.faces);
+	viewLoadedGeometry();
+	// positions and normals are read in place or converted each on their own
+	if (!model.mappedVertices.empty()) {
+		vertices = model.mappedVertices;
 	}
-	if (normalMap.data != nullptr) {
-		stbi_image_free(normalMap.data);
+	if (!model.mappedNormals.empty()) {
+		normals = model.mappedNormals;
 	}
+	computeTangents();
+	computeBounds();
+	tangents = loaded.tangents;
+	bitangentSigns = loaded.bitangentSigns;
+	faceTangents = loaded.faceTangents;
+	quantizeGeometry();
+
+	const GlbFile::Image images[2] = { model.baseColour, model.normalMap };
+	Texture *textures[3] = { &diffuse, &normalMap, &specularMap };
+	std::unique_ptr<VirtualTexture> *virtualTextures[3] = { &virtualDiffuse, &virtualNormalMap, &virtualSpecularMap };
+	const TextureFormat compressedFormats[2] = { TextureFormat::BC1, TextureFormat::BC5 };
+	material = Texture();
+	for (int i = 0; i < 3; i++) {
+		const GlbFile::Image *image = i < 2 && !images[i].empty() ? &images[i] : nullptr;
+		if (image != nullptr && !image->path.empty()) {
+			loadTexture(*textures[i], *virtualTextures[i], image->path, STBI_rgb_alpha, compressedFormats[i]);
+			continue;
+		}
+
+		virtualTextures[i]->reset();
+		*textures[i] = Texture();
+		int width = 0, height = 0, format;
+		byte *data = image != nullptr ? stbi_load_from_memory(image->data.data(), static_cast<int>(image->data.size()), &width, &height, &format, STBI_rgb_alpha) : nullptr;
+		if (data != nullptr) {
+			createTexture(*textures[i], data, width, height, compressedFormats[i]);
+			stbi_image_free(data);
+		}
+	}
+	createPlaceholderTextures();
 }
 
-void Mesh::loadObjFromFile(const std::string& path) {
-	std::ifstream file(path, std::ifstream::in);
-
-	if (file.is_open()) {
-
-		float x, y, z;
-		std::string line;
-		std::string faceLine;
-		std::string indexValues;
-		int faceComponentIndex;
-		std::istringstream faceStream;
-		std::istringstream in;
-		Vector3i face;
-
-		while (std::getline(file, line)) {
-			in.clear();
-			in.str(line);
-
-			if (line[0] != '#') {
-				x = 0, y = 0, z = 0;
-
-				std::string type;
-				in >> type;
-
-				if (type == "v") {
-					in >> x >> y >> z;
-					vertices.emplace_back(x,y,z);
-				} else if (type == "vt") {
-					in >> x >> y;
-					textureCoordinates.emplace_back(x, y, 0);
-				} else if (type == "vn") {
-					in >> x >> y >> z;
-					normals.emplace_back(x, y, z);
-				} else if (type == "f") {
-					FaceVector vector;
-					while (std::getline(in, faceLine, ' ')) {
-						if (!faceLine.empty()) {
-							faceStream.clear();
-							faceStream.str(faceLine);
-
-							face = { 0,0,0 };
-							faceComponentIndex = 0;
-							while (std::getline(faceStream, indexValues, '/')) {
-								face[faceComponentIndex] = atoi(indexValues.c_str()) - 1;
-								++faceComponentIndex;
-							}
-							vector.push_back(face);
-						}
-					}
-					faces.push_back(vector);
+void Mesh::loadScanFromFile(const std::string &path, const ScanFile::ProgressCallback &progress) {
+	std::string extension = path.size() > 4 ? path.substr(path.size() - 4) : "";
+	std::transform(extension.begin(), extension.end(), extension.begin(), ::tolower);
+	assert(extension == ".stl" || extension == ".ply");
+
+	stopLoading();
+	mapping.reset();
+	chunks.reset();
+	loaded = Geometry();
+	const bool parsed = extension == ".stl" ? ScanFile::loadStl(path, loaded.vertices, loaded.normals, loaded.faces, progress) : ScanFile::loadPly(path, loaded.vertices, loaded.normals, loaded.faces, progress);
+	assert(parsed);
+	if (!parsed) {
+		// a file that can't be read leaves an empty mesh rather than part of one
+		loaded = Geometry();
+	}
+	loaded.textureCoordinates.emplace_back(0.0f, 0.0f, 0.0f);
+	viewLoadedGeometry();
+	computeTangents();
+	computeBounds();
+	viewLoadedGeometry();
+	quantizeGeometry();
+	createPlaceholderTextures();
+}
+
+void Mesh::createPlaceholderTextures() {
+	if (hasPackedMaterial()) {
+		return;
+	}
+	Texture *textures[3] = { &diffuse, &normalMap, &specularMap };
+	const VirtualTexture *virtualTextures[3] = { virtualDiffuse.get(), virtualNormalMap.get(), virtualSpecularMap.get() };
+	// light grey rather than white, the shaders add the specular highlight on top of the
+	// lit colour without clamping
+	const RGBA placeholders[3] = { { 0xEB, 0xEB, 0xEB, 0xFF }, { 0x80, 0x80, 0xFF, 0xFF }, { 0xFF, 0xFF, 0xFF, 0xFF } };
+	for (int i = 0; i < 3; i++) {
+		if (textures[i]->empty() && virtualTextures[i] == nullptr) {
+			textures[i]->create(&placeholders[i].red, 1, 1, textureLayout);
+		}
+	}
+}
+
+bool Mesh::loadAssetPack(const std::string &path) {
+	std::shared_ptr<const MappedFile> file = std::make_shared<MappedFile>(path);
+	AssetPack::Header header;
+	if (!file->isOpen() || file->size() < sizeof(header)) {
+		return false;
+	}
+	std::memcpy(&header, file->data(), sizeof(header));
+	if (std::memcmp(header.magic, AssetPack::MAGIC, sizeof(header.magic)) != 0 || header.version != AssetPack::VERSION) {
+		return false;
+	}
+
+	const ArrayView<Vector3f> packedVertices = AssetPack::view<Vector3f>(*file, header.arrays[AssetPack::VERTICES]);
+	const ArrayView<Vector3f> packedTextureCoordinates = AssetPack::view<Vector3f>(*file, header.arrays[AssetPack::TEXTURE_COORDINATES]);
+	const ArrayView<Vector3f> packedNormals = AssetPack::view<Vector3f>(*file, header.arrays[AssetPack::NORMALS]);
+	const ArrayView<FaceVector> packedFaces = AssetPack::view<FaceVector>(*file, header.arrays[AssetPack::FACES]);
+	const ArrayView<Vector3f> packedTangents = AssetPack::view<Vector3f>(*file, header.arrays[AssetPack::TANGENTS]);
+	const ArrayView<float> packedBitangentSigns = AssetPack::view<float>(*file, header.arrays[AssetPack::BITANGENT_SIGNS]);
+	const ArrayView<Vector3i> packedFaceTangents = AssetPack::view<Vector3i>(*file, header.arrays[AssetPack::FACE_TANGENTS]);
+	const size_t sizes[AssetPack::ARRAY_COUNT] = { packedVertices.size(), packedTextureCoordinates.size(), packedNormals.size(), packedFaces.size(), packedTangents.size(), packedBitangentSigns.size(), packedFaceTangents.size() };
+	for (int i = 0; i < AssetPack::ARRAY_COUNT; i++) {
+		if (sizes[i] != header.arrays[i].count) {
+			return false;
+		}
+	}
+	if (!AssetPack::indicesFit(packedVertices, packedTextureCoordinates, packedNormals, packedFaces, packedTangents, packedBitangentSigns, packedFaceTangents)) {
+		return false;
+	}
+
+	Texture textures[AssetPack::TEXTURE_COUNT];
+	for (int i = 0; i < AssetPack::TEXTURE_COUNT; i++) {
+		if (!AssetPack::map(file, header.textures[i], textures[i])) {
+			return false;
+		}
+	}
+
+	stopLoading();
+	mapping = file;
+	chunks.reset();
+	loaded = Geometry();
+	vertices = packedVertices;
+	textureCoordinates = packedTextureCoordinates;
+	normals = packedNormals;
+	faces = packedFaces;
+	tangents = packedTangents;
+	bitangentSigns = packedBitangentSigns;
+	faceTangents = packedFaceTangents;
+	boundsMin = Vector3f(header.boundsMin[0], header.boundsMin[1], header.boundsMin[2]);
+	boundsMax = Vector3f(header.boundsMax[0], header.boundsMax[1], header.boundsMax[2]);
+
+	diffuse = textures[AssetPack::DIFFUSE];
+	normalMap = textures[AssetPack::NORMAL_MAP];
+	specularMap = textures[AssetPack::SPECULAR_MAP];
+	material = textures[AssetPack::MATERIAL];
+	virtualDiffuse.reset();
+	virtualNormalMap.reset();
+	virtualSpecularMap.reset();
+	return true;
+}
+
+bool Mesh::saveAssetPack(const std::string &path, bool mipmaps) const {
+	assert(!isQuantized());
+	std::ofstream out(path, std::ofstream::out | std::ofstream::binary);
+	if (!out.is_open()) {
+		return false;
+	}
+
+	// the header is written again once the offsets are known
+	AssetPack::Header header = {};
+	std::memcpy(header.magic, AssetPack::MAGIC, sizeof(header.magic));
+	header.version = AssetPack::VERSION;
+	const float bounds[6] = { boundsMin.x, boundsMin.y, boundsMin.z, boundsMax.x, boundsMax.y, boundsMax.z };
+	std::copy(bounds, bounds + 3, header.boundsMin);
+	std::copy(bounds + 3, bounds + 6, header.boundsMax);
+	out.write(reinterpret_cast<const char*>(&header), sizeof(header));
+
+	header.arrays[AssetPack::VERTICES] = AssetPack::write(out, vertices);
+	header.arrays[AssetPack::TEXTURE_COORDINATES] = AssetPack::write(out, textureCoordinates);
+	header.arrays[AssetPack::NORMALS] = AssetPack::write(out, normals);
+	header.arrays[AssetPack::FACES] = AssetPack::write(out, faces);
+	header.arrays[AssetPack::TANGENTS] = AssetPack::write(out, tangents);
+	header.arrays[AssetPack::BITANGENT_SIGNS] = AssetPack::write(out, bitangentSigns);
+	header.arrays[AssetPack::FACE_TANGENTS] = AssetPack::write(out, faceTangents);
+	header.textures[AssetPack::DIFFUSE] = AssetPack::write(out, diffuse, mipmaps);
+	header.textures[AssetPack::NORMAL_MAP] = AssetPack::write(out, normalMap, mipmaps);
+	header.textures[AssetPack::SPECULAR_MAP] = AssetPack::write(out, specularMap, mipmaps);
+	header.textures[AssetPack::MATERIAL] = AssetPack::write(out, material, mipmaps);
+
+	out.seekp(0);
+	out.write(reinterpret_cast<const char*>(&header), sizeof(header));
+	return out.good();
+}
+
+bool Mesh::loadChunkFile(const std::string &path) {
+	std::unique_ptr<ChunkedGeometry> file(new ChunkedGeometry(path, chunkBudget));
+	if (!file->isOpen()) {
+		return false;
+	}
+
+	stopLoading();
+	mapping.reset();
+	loaded = Geometry();
+	viewLoadedGeometry();
+	boundsMin = file->getBoundsMin();
+	boundsMax = file->getBoundsMax();
+	chunks = std::move(file);
+	return true;
+}
+
+bool Mesh::saveChunkFile(const std::string &path, int facesPerChunk) const {
+	assert(!isQuantized());
+	ChunkedGeometry::Arrays arrays;
+	arrays.vertices = vertices;
+	arrays.textureCoordinates = textureCoordinates;
+	arrays.normals = normals;
+	arrays.faces = faces;
+	arrays.tangents = tangents;
+	arrays.bitangentSigns = bitangentSigns;
+	arrays.faceTangents = faceTangents;
+	return ChunkedGeometry::createChunkFile(path, arrays, facesPerChunk);
+}
+
+void Mesh::bindChunk(size_t index) {
+	const ChunkedGeometry::Arrays arrays = chunks->acquire(index);
+	vertices = arrays.vertices;
+	textureCoordinates = arrays.textureCoordinates;
+	normals = arrays.normals;
+	faces = arrays.faces;
+	tangents = arrays.tangents;
+	bitangentSigns = arrays.bitangentSigns;
+	faceTangents = arrays.faceTangents;
+}
+
+void Mesh::viewLoadedGeometry() {
+	vertices = loaded.vertices;
+	textureCoordinates = loaded.textureCoordinates;
+	normals = loaded.normals;
+	faces = loaded.faces;
+	tangents = loaded.tangents;
+	bitangentSigns = loaded.bitangentSigns;
+	faceTangents = loaded.faceTangents;
+}
+
+void Mesh::computeBounds() {
+	boundsMin = Vector3f(0.0f, 0.0f, 0.0f);
+	boundsMax = Vector3f(0.0f, 0.0f, 0.0f);
+	for (size_t i = 0; i < vertices.size(); i++) {
+		for (int axis = 0; axis < 3; axis++) {
+			const float value = Vector3f(vertices[i])[axis];
+			boundsMin[axis] = i == 0 ? value : std::min(boundsMin[axis], value);
+			boundsMax[axis] = i == 0 ? value : std::max(boundsMax[axis], value);
+		}
+	}
+}
+
+void Mesh::quantizeGeometry() {
+	if (vertexFormat != VertexFormat::QUANTIZED || vertices.empty()) {
+		return;
+	}
+
+	// positions as 16 bit fractions of the bounds, a flat axis keeps its minimum
+	float scales[3];
+	for (int axis = 0; axis < 3; axis++) {
+		const float extent = boundsMax[axis] - boundsMin[axis];
+		scales[axis] = extent > 0.0f ? extent / 65535.0f : 0.0f;
+	}
+	dequantization = {
+		{ scales[0],0,0,boundsMin.x },
+		{ 0,scales[1],0,boundsMin.y },
+		{ 0,0,scales[2],boundsMin.z },
+		{ 0,0,0,1 }
+	};
+	loaded.quantizedVertices.resize(vertices.size());
+	for (size_t i = 0; i < vertices.size(); i++) {
+		uint16_t quantized[3];
+		for (int axis = 0; axis < 3; axis++) {
+			const float value = scales[axis] > 0.0f ? (Vector3f(vertices[i])[axis] - boundsMin[axis]) / scales[axis] : 0.0f;
+			quantized[axis] = static_cast<uint16_t>(std::lround(std::min(std::max(value, 0.0f), 65535.0f)));
+		}
+		loaded.quantizedVertices[i] = { quantized[0], quantized[1], quantized[2] };
+	}
+
+	loaded.quantizedNormals.resize(normals.size());
+	for (size_t i = 0; i < normals.size(); i++) {
+		loaded.quantizedNormals[i] = VertexEncoding::encodeOctahedral(normals[i]);
+	}
+	loaded.quantizedTextureCoordinates.resize(textureCoordinates.size());
+	for (size_t i = 0; i < textureCoordinates.size(); i++) {
+		loaded.quantizedTextureCoordinates[i] = { VertexEncoding::floatToHalf(textureCoordinates[i].x), VertexEncoding::floatToHalf(textureCoordinates[i].y) };
+	}
+
+	// the indices of every cluster of faces as offsets from the smallest of them
+	std::vector<QuantizedFace> quantizedFaces(faces.size());
+	std::vector<Vector3i> clusterBases;
+	bool fits = true;
+	for (size_t first = 0; first < faces.size() && fits; first += VertexEncoding::FACES_PER_CLUSTER) {
+		const size_t last = std::min(faces.size(), first + VertexEncoding::FACES_PER_CLUSTER);
+		Vector3i base = faces[first][0], top = faces[first][0];
+		for (size_t i = first; i < last; i++) {
+			for (const Vector3i &corner : faces[i]) {
+				base = Vector3i(std::min(base.x, corner.x), std::min(base.y, corner.y), std::min(base.z, corner.z));
+				top = Vector3i(std::max(top.x, corner.x), std::max(top.y, corner.y), std::max(top.z, corner.z));
+			}
+		}
+		fits = top.x - base.x <= 0xFFFF && top.y - base.y <= 0xFFFF && top.z - base.z <= 0xFFFF;
+		for (size_t i = first; i < last && fits; i++) {
+			for (int j = 0; j < 3; j++) {
+				const Vector3i &corner = faces[i][j];
+				quantizedFaces[i][j] = { static_cast<uint16_t>(corner.x - base.x), static_cast<uint16_t>(corner.y - base.y), static_cast<uint16_t>(corner.z - base.z) };
+			}
+		}
+		clusterBases.push_back(base);
+	}
+	if (fits) {
+		loaded.quantizedFaces.swap(quantizedFaces);
+		loaded.clusterBases.swap(clusterBases);
+		std::vector<FaceVector>().swap(loaded.faces);
+	}
+
+	std::vector<Vector3f>().swap(loaded.vertices);
+	std::vector<Vector3f>().swap(loaded.normals);
+	std::vector<Vector3f>().swap(loaded.textureCoordinates);
+	viewLoadedGeometry();
+}
+
+namespace {
+	struct CornerHash {
+		size_t operator()(const Vector3i &corner) const {
+			return (static_cast<size_t>(corner.x) * 73856093u) ^ (static_cast<size_t>(corner.y) * 19349663u) ^ (static_cast<size_t>(corner.z) * 83492791u);
+		}
+	};
+
+	struct CornerEqual {
+		bool operator()(const Vector3i &a, const Vector3i &b) const {
+			return a.x == b.x && a.y == b.y && a.z == b.z;
+		}
+	};
+
+	// Tangent frames of the faces, one per distinct (vertex, uv, normal) corner, see
+	// Mesh::tangents. The faces may be a part of the mesh the arrays belong to.
+	void computeTangentFrames(ArrayView<Vector3f> vertices, ArrayView<Vector3f> textureCoordinates, ArrayView<Vector3f> normals, ArrayView<FaceVector> faces, std::vector<Vector3f> &tangents, std::vector<float> &bitangentSigns, std::vector<Vector3i> &faceTangents) {
+		tangents.clear();
+		bitangentSigns.clear();
+		faceTangents.clear();
+		if (textureCoordinates.empty() || normals.empty()) {
+			return;
+		}
+
+		// one tangent frame per distinct corner, so uv seams get their own tangents
+		std::unordered_map<Vector3i, int, CornerHash, CornerEqual> cornerIndices;
+		std::vector<Vector3f> bitangents;
+		faceTangents.resize(faces.size());
+		for (size_t i = 0; i < faces.size(); i++) {
+			const FaceVector &face = faces[i];
+			for (int j = 0; j < 3; j++) {
+				auto inserted = cornerIndices.insert({ face[j], static_cast<int>(tangents.size()) });
+				if (inserted.second) {
+					tangents.emplace_back(0.0f, 0.0f, 0.0f);
+					bitangents.emplace_back(0.0f, 0.0f, 0.0f);
 				}
+				faceTangents[i][j] = inserted.first->second;
 			}
+
+			// accumulate the directions of increasing u and v of the face on its corners
+			const Vector3f &p0 = vertices[face[0].x];
+			const Vector3f &uv0 = textureCoordinates[face[0].y];
+			const Vector3f e1 = vertices[face[1].x] - p0;
+			const Vector3f e2 = vertices[face[2].x] - p0;
+			const Vector3f uv1 = textureCoordinates[face[1].y] - uv0;
+			const Vector3f uv2 = textureCoordinates[face[2].y] - uv0;
+			const float determinant = uv1.x * uv2.y - uv2.x * uv1.y;
+			if (determinant == 0.0f) {
+				continue;
+			}
+
+			const float r = 1.0f / determinant;
+			const Vector3f uDirection = (e1 * uv2.y - e2 * uv1.y) * r;
+			const Vector3f vDirection = (e2 * uv1.x - e1 * uv2.x) * r;
+			for (int j = 0; j < 3; j++) {
+				Vector3f &tangent = tangents[faceTangents[i][j]];
+				Vector3f &bitangent = bitangents[faceTangents[i][j]];
+				tangent = tangent + uDirection;
+				bitangent = bitangent + vDirection;
+			}
+		}
+
+		// orthogonalize against the normal and keep the handedness of the uv mapping
+		bitangentSigns.resize(tangents.size());
+		for (const auto &corner : cornerIndices) {
+			const int index = corner.second;
+			const Vector3f n = normals[corner.first.z].getNormalizeVector();
+			Vector3f t = tangents[index] - n * n.dot(tangents[index]);
+			if (t.dot(t) > 0.0f) {
+				t.normalize();
+			} else {
+				// no usable uv gradient, pick any direction perpendicular to the normal
+				t = (std::fabs(n.x) < 0.9f ? Vector3f(1.0f, 0.0f, 0.0f) : Vector3f(0.0f, 1.0f, 0.0f)).cross(n).normalize();
+			}
+			tangents[index] = t;
+			bitangentSigns[index] = n.cross(t).dot(bitangents[index]) < 0.0f ? -1.0f : 1.0f;
 		}
 	}
+}
 
-	file.close();
+void Mesh::computeTangents() {
+	computeTangentFrames(vertices, textureCoordinates, normals, faces, loaded.tangents, loaded.bitangentSigns, loaded.faceTangents);
 }
 
 void Mesh::loadDiffuseTexture(const std::string& path) {
-	loadTexture(diffuse, path, STBI_rgb_alpha);
+	loadTexture(diffuse, virtualDiffuse, path, STBI_rgb_alpha, TextureFormat::BC1);
 }
 
 void Mesh::loadNormalMap(const std::string& path) {
-	loadTexture(normalMap, path, STBI_rgb_alpha);
+	loadTexture(normalMap, virtualNormalMap, path, STBI_rgb_alpha, TextureFormat::BC5);
 }
 
 void Mesh::loadSpecularMap(const std::string& path) {
-	loadTexture(specularMap, path, STBI_rgb_alpha);
+	loadTexture(specularMap, virtualSpecularMap, path, STBI_rgb_alpha, TextureFormat::BC4);
+}
+
+std::future<void> Mesh::loadAsync(const std::string &objPath, const std::string &diffusePath, const std::string &normalMapPath, const std::string &specularMapPath) {
+	stopLoading();
+	// every load writes its own members, so they run side by side
+	std::shared_ptr<TaskGroup> loads = std::make_shared<TaskGroup>(JobSystem::shared(), true);
+	if (!diffusePath.empty()) {
+		loads->run([this, diffusePath]() { loadDiffuseTexture(diffusePath); });
+	}
+	if (!normalMapPath.empty()) {
+		loads->run([this, normalMapPath]() { loadNormalMap(normalMapPath); });
+	}
+	if (!specularMapPath.empty()) {
+		loads->run([this, specularMapPath]() { loadSpecularMap(specularMapPath); });
+	}
+	loads->run([this, objPath]() { loadObjFromFile(objPath); });
+
+	// idle workers take the jobs meanwhile, the thread waiting runs those left
+	return std::async(std::launch::deferred, [loads]() { loads->wait(); });
+}
+
+void Mesh::loadProgressive(const std::string &objPath, const std::string &diffusePath, const std::string &normalMapPath, const std::string &specularMapPath) {
+	stopLoading();
+	mapping.reset();
+	chunks.reset();
+	loaded = Geometry();
+	viewLoadedGeometry();
+	computeBounds();
+	material = Texture();
+	diffuse = Texture();
+	normalMap = Texture();
+	specularMap = Texture();
+	virtualDiffuse.reset();
+	virtualNormalMap.reset();
+	virtualSpecularMap.reset();
+	createPlaceholderTextures();
+
+	progressive.reset(new ProgressiveLoad());
+	ProgressiveLoad *state = progressive.get();
+	state->remaining = 1;
+	state->loads.run([state, objPath]() {
+		if (state->cancelled) {
+			return;
+		}
+		Geometry parsed;
+		size_t publishedVertices = 0, publishedTextureCoordinates = 0, publishedNormals = 0, publishedFaces = 0;
+		const bool opened = ObjFile::loadInSlices(objPath, parsed.vertices, parsed.textureCoordinates, parsed.normals, parsed.faces, [&]() {
+			// the faces of the slice with the attributes parsed since the last one, the
+			// tangents are smoothed over the slice until the whole mesh is published
+			Geometry batch;
+			batch.vertices.assign(parsed.vertices.begin() + publishedVertices, parsed.vertices.end());
+			batch.textureCoordinates.assign(parsed.textureCoordinates.begin() + publishedTextureCoordinates, parsed.textureCoordinates.end());
+			batch.normals.assign(parsed.normals.begin() + publishedNormals, parsed.normals.end());
+			batch.faces.assign(parsed.faces.begin() + publishedFaces, parsed.faces.end());
+			computeTangentFrames(parsed.vertices, parsed.textureCoordinates, parsed.normals, batch.faces, batch.tangents, batch.bitangentSigns, batch.faceTangents);
+			publishedVertices = parsed.vertices.size();
+			publishedTextureCoordinates = parsed.textureCoordinates.size();
+			publishedNormals = parsed.normals.size();
+			publishedFaces = parsed.faces.size();
+
+			std::lock_guard<std::mutex> lock(state->mutex);
+			appendGeometry(state->batch, batch);
+			return !state->cancelled;
+		});
+		assert(opened);
+		if (state->cancelled) {
+			return;
+		}
+		if (!opened) {
+			// a file that can't be read ends as an empty mesh rather than part of one
+			parsed = Geometry();
+		}
+
+		computeTangentFrames(parsed.vertices, parsed.textureCoordinates, parsed.normals, parsed.faces, parsed.tangents, parsed.bitangentSigns, parsed.faceTangents);
+		std::lock_guard<std::mutex> lock(state->mutex);
+		state->whole = std::move(parsed);
+		state->parsed = true;
+	});
+
+	const std::string paths[3] = { diffusePath, normalMapPath, specularMapPath };
+	const TextureFormat compressedFormats[3] = { TextureFormat::BC1, TextureFormat::BC5, TextureFormat::BC4 };
+	for (int i = 0; i < 3; i++) {
+		if (paths[i].empty()) {
+			continue;
+		}
+		state->remaining++;
+		const std::string path = paths[i];
+		const TextureFormat compressedFormat = compressedFormats[i];
+		state->loads.run([this, state, i, path, compressedFormat]() {
+			if (state->cancelled) {
+				return;
+			}
+			Texture texture;
+			std::unique_ptr<VirtualTexture> virtualTexture;
+			loadTexture(texture, virtualTexture, path, STBI_rgb_alpha, compressedFormat);
+
+			std::lock_guard<std::mutex> lock(state->mutex);
+			state->textures[i] = std::move(texture);
+			state->virtualTextures[i] = std::move(virtualTexture);
+			state->decoded[i] = true;
+		});
+	}
+}
+
+void Mesh::appendGeometry(Geometry &geometry, const Geometry &batch) {
+	// tangents are kept only while every face has them
+	const bool tangentsComplete = geometry.faceTangents.size() == geometry.faces.size() && batch.faceTangents.size() == batch.faces.size();
+	const int tangentsBase = static_cast<int>(geometry.tangents.size());
+	geometry.vertices.insert(geometry.vertices.end(), batch.vertices.begin(), batch.vertices.end());
+	geometry.textureCoordinates.insert(geometry.textureCoordinates.end(), batch.textureCoordinates.begin(), batch.textureCoordinates.end());
+	geometry.normals.insert(geometry.normals.end(), batch.normals.begin(), batch.normals.end());
+	geometry.faces.insert(geometry.faces.end(), batch.faces.begin(), batch.faces.end());
+	if (!tangentsComplete) {
+		geometry.tangents.clear();
+		geometry.bitangentSigns.clear();
+		geometry.faceTangents.clear();
+		return;
+	}
+	geometry.tangents.insert(geometry.tangents.end(), batch.tangents.begin(), batch.tangents.end());
+	geometry.bitangentSigns.insert(geometry.bitangentSigns.end(), batch.bitangentSigns.begin(), batch.bitangentSigns.end());
+	for (const Vector3i &corners : batch.faceTangents) {
+		geometry.faceTangents.emplace_back(corners.x + tangentsBase, corners.y + tangentsBase, corners.z + tangentsBase);
+	}
+}
+
+void Mesh::takeProgressiveLoad() {
+	Geometry batch, whole;
+	bool parsed = false;
+	Texture *textures[3] = { &diffuse, &normalMap, &specularMap };
+	std::unique_ptr<VirtualTexture> *virtualTextures[3] = { &virtualDiffuse, &virtualNormalMap, &virtualSpecularMap };
+	{
+		std::lock_guard<std::mutex> lock(progressive->mutex);
+		std::swap(batch, progressive->batch);
+		if (progressive->parsed) {
+			whole = std::move(progressive->whole);
+			progressive->parsed = false;
+			parsed = true;
+		}
+		for (int i = 0; i < 3; i++) {
+			if (progressive->decoded[i]) {
+				// a texture that couldn't be loaded keeps its placeholder
+				if (!progressive->textures[i].empty() || progressive->virtualTextures[i] != nullptr) {
+					*textures[i] = std::move(progressive->textures[i]);
+					*virtualTextures[i] = std::move(progressive->virtualTextures[i]);
+				}
+				progressive->decoded[i] = false;
+				progressive->remaining--;
+			}
+		}
+	}
+
+	// the whole mesh replaces the batches, with the tangents smoothed across them
+	if (parsed) {
+		loaded = std::move(whole);
+		viewLoadedGeometry();
+		computeBounds();
+		quantizeGeometry();
+		progressive->remaining--;
+	} else {
+		appendGeometry(loaded, batch);
+		viewLoadedGeometry();
+	}
+	if (progressive->remaining == 0) {
+		stopLoading();
+	}
+}
+
+void Mesh::stopLoading() {
+	if (!progressive) {
+		return;
+	}
+	progressive->cancelled = true;
+	progressive->loads.wait();
+	progressive.reset();
 }
 
-void Mesh::loadTexture(Texture &texture, const std::string &filename, int format) {
-	stbi_set_flip_vertically_on_load(true);
+void Mesh::loadTexture(Texture &texture, std::unique_ptr<VirtualTexture> &virtualTexture, const std::string &filename, int format, TextureFormat compressedFormat) {
+	if (filename.size() > 3 && filename.compare(filename.size() - 3, 3, ".vt") == 0) {
+		virtualTexture.reset(new VirtualTexture(filename, virtualTextureBudget));
+		assert(virtualTexture->isOpen());
+		if (!virtualTexture->isOpen()) {
+			// a tile file that can't be read leaves no texture, like a DDS file
+			virtualTexture.reset();
+		}
+		texture = Texture();
+		return;
+	}
+	virtualTexture.reset();
+
+	const std::string extension = filename.size() > 4 ? filename.substr(filename.size() - 4) : "";
+	if (extension == ".dds" || extension == ".DDS") {
+		const bool loaded = DdsFile::load(filename, texture);
+		assert(loaded);
+		if (!loaded) {
+			// a file that can't be read leaves no texture rather than part of one
+			texture = Texture();
+		}
+		return;
+	}
 
 	int width, height, orig_format;
 	byte *textureData = stbi_load(filename.c_str(), &width, &height, &orig_format, format);
 	assert(textureData != nullptr);
+	if (textureData == nullptr) {
+		// an image that can't be decoded leaves no texture, like a DDS file
+		texture = Texture();
+		return;
+	}
+	createTexture(texture, textureData, width, height, compressedFormat);
+	stbi_image_free(textureData);
+}
+
+void Mesh::createTexture(Texture &texture, byte *textureData, int width, int height, TextureFormat compressedFormat) const {
+	Texture::flipRows(textureData, width, height);
+
+	if (textureCompression) {
+		// BC1 keeps 1 bit of alpha and BC5 only the x and y of normals
+		const TextureFormat preferredFormat = compressedFormat;
+		for (int i = 0; i < width * height && compressedFormat == preferredFormat; i++) {
+			if (compressedFormat == TextureFormat::BC1 && textureData[i * 4 + 3] != 255) {
+				compressedFormat = TextureFormat::BC3;
+			} else if (compressedFormat == TextureFormat::BC5 && textureData[i * 4 + 2] < 128) {
+				compressedFormat = TextureFormat::BC1;
+			}
+		}
+	}
+
+	texture.create(textureData, width, height, textureLayout);
+	if (textureCompression) {
+		texture.compress(compressedFormat);
+	}
+}
+
+void Mesh::packMaterial() {
+	assert(!virtualDiffuse && !virtualNormalMap && !virtualSpecularMap);
+	material.createMaterial(diffuse, normalMap, specularMap);
+	diffuse = Texture();
+	normalMap = Texture();
+	specularMap = Texture();
+}
+
+void Mesh::endFrame() {
+	if (progressive) {
+		takeProgressiveLoad();
+	}
+	for (VirtualTexture *virtualTexture : { virtualDiffuse.get(), virtualNormalMap.get(), virtualSpecularMap.get() }) {
+		if (virtualTexture != nullptr) {
+			virtualTexture->endFrame();
+		}
+	}
+}
+
+const byte* Mesh::lookupTexel(const Texture &texture, const VirtualTexture *virtualTexture, const Vector3f &textureCoordinate) const {
+	return virtualTexture != nullptr ? virtualTexture->texel(sampler, textureCoordinate) : sampler.texel(texture, textureCoordinate);
+}
+
+void Mesh::sampleTexture(const Texture &texture, const VirtualTexture *virtualTexture, const Floatx8 &u, const Floatx8 &v, const Floatx8 &lod, const Floatx8 &mask, Floatx8 *channels) const {
+	if (virtualTexture != nullptr) {
+		virtualTexture->sample(sampler, u, v, lod, mask, channels);
+	} else {
+		sampler.sample(texture, u, v, lod, mask, channels);
+	}
+}
+
+namespace {
+	void toColours(const Floatx8 channels[4], RGBA colours[Floatx8::LANES]) {
+		float values[4][Floatx8::LANES];
+		for (int c = 0; c < 4; c++) {
+			channels[c].store(values[c]);
+		}
+		CpuDispatch::kernels().packColours(values, colours);
+	}
 
-	texture = { width, height, orig_format, textureData };
+	// eight lane version of Texture::decodeOctahedral on filtered bytes
+	void decodeOctahedral(const Floatx8 &encodedX, const Floatx8 &encodedY, Floatx8 &x, Floatx8 &y, Floatx8 &z) {
+		const Floatx8 zero(0.0f);
+		x = ((encodedX / 255.f) * 2.0f) - 1.f;
+		y = ((encodedY / 255.f) * 2.0f) - 1.f;
+		z = Floatx8(1.0f) - Floatx8::max(x, zero - x) - Floatx8::max(y, zero - y);
+		const Floatx8 fold = Floatx8::max(zero - z, zero);
+		x = x + Floatx8::select(x >= zero, zero - fold, fold);
+		y = y + Floatx8::select(y >= zero, zero - fold, fold);
+		const Floatx8 inversedMagnitude = Floatx8(1.0f) / Floatx8::sqrt(x * x + y * y + z * z);
+		x = x * inversedMagnitude;
+		y = y * inversedMagnitude;
+		z = z * inversedMagnitude;
+	}
 }
 
 RGBA Mesh::getDiffuseColor(const Vector3f &textureCoordinate) const {
-	assert(diffuse.data != nullptr);
-	Vector2i uv( textureCoordinate.x * diffuse.width , textureCoordinate.y * diffuse.height );
-	int index = ((uv.x * diffuse.pitch) + (uv.y * diffuse.height * diffuse.pitch));
+	// a packed material starts with the diffuse colour
+	const byte *texel = hasPackedMaterial() ? sampler.texel(material, textureCoordinate) : lookupTexel(diffuse, virtualDiffuse.get(), textureCoordinate);
 	RGBA colour;
-	colour.red = diffuse.data[index];
-	colour.green = diffuse.data[index + 1];
-	colour.blue = diffuse.data[index + 2];
-	colour.alpha = diffuse.data[index + 3];
+	colour.red = texel[0];
+	colour.green = texel[1];
+	colour.blue = texel[2];
+	colour.alpha = texel[3];
 	return colour;
 }
 
 Vector3f Mesh::getNormalFromMap(const Vector3f &textureCoordinate) const {
-	assert(normalMap.data != nullptr);
-	Vector2i uv(textureCoordinate.x * normalMap.width, textureCoordinate.y * normalMap.height);
-	int index = ((uv.x * normalMap.pitch) + (uv.y * normalMap.height * normalMap.pitch));
+	if (hasPackedMaterial()) {
+		const byte *texel = sampler.texel(material, textureCoordinate);
+		return Texture::decodeOctahedral(texel[MATERIAL_NORMAL_X], texel[MATERIAL_NORMAL_Y]);
+	}
+
+	const byte *texel = lookupTexel(normalMap, virtualNormalMap.get(), textureCoordinate);
 	Vector3f normal;
-	for (int i = 0; i < 3; i++, index++) {
-		normal[i] = (((float)normalMap.data[index] / 255.f) * 2.0f) - 1.f;
+	for (int i = 0; i < 3; i++) {
+		normal[i] = (((float)texel[i] / 255.f) * 2.0f) - 1.f;
 	}
 	return normal;
 }
 
 RGBA Mesh::getNormalAsColour(const Vector3f &textureCoordinate) const {
-	assert(normalMap.data != nullptr);
-	Vector2i uv(textureCoordinate.x * normalMap.width, textureCoordinate.y * normalMap.height);
-	int index = ((uv.x * normalMap.pitch) + (uv.y * normalMap.height * normalMap.pitch));
 	RGBA colour;
-	colour.red = normalMap.data[index];
-	colour.green = normalMap.data[index + 1];
-	colour.blue = normalMap.data[index + 2];
+	if (hasPackedMaterial()) {
+		Vector3f normal = getNormalFromMap(textureCoordinate);
+		colour.red = static_cast<byte>((normal.x * 0.5f + 0.5f) * 255.0f + 0.5f);
+		colour.green = static_cast<byte>((normal.y * 0.5f + 0.5f) * 255.0f + 0.5f);
+		colour.blue = static_cast<byte>((normal.z * 0.5f + 0.5f) * 255.0f + 0.5f);
+		return colour;
+	}
+
+	const byte *texel = lookupTexel(normalMap, virtualNormalMap.get(), textureCoordinate);
+	colour.red = texel[0];
+	colour.green = texel[1];
+	colour.blue = texel[2];
 	return colour;
 }
 
 float Mesh::getSpecularIntensity(const Vector3f &textureCoordinate) const {
-	assert(specularMap.data != nullptr);
-	Vector2i uv(textureCoordinate.x * specularMap.width, textureCoordinate.y * specularMap.height);
-	int index = ((textureCoordinate.x * specularMap.pitch) + (textureCoordinate.y * specularMap.height * specularMap.pitch));
-	return specularMap.data[index] / 1.0f;
+	if (hasPackedMaterial()) {
+		return sampler.texel(material, textureCoordinate)[MATERIAL_SPECULAR] / 1.0f;
+	}
+	const byte *texel = lookupTexel(specularMap, virtualSpecularMap.get(), textureCoordinate);
+	return texel[0] / 1.0f;
+}
+
+void Mesh::getDiffuseColors(const Floatx8 &u, const Floatx8 &v, const Floatx8 &lod, const Floatx8 &mask, RGBA colours[Floatx8::LANES]) const {
+	if (hasPackedMaterial()) {
+		sampler.sampleColours(material, u, v, lod, mask, colours);
+	} else if (virtualDiffuse) {
+		Floatx8 channels[4];
+		virtualDiffuse->sample(sampler, u, v, lod, mask, channels);
+		toColours(channels, colours);
+	} else {
+		sampler.sampleColours(diffuse, u, v, lod, mask, colours);
+	}
+}
+
+void Mesh::getNormalsFromMap(const Floatx8 &u, const Floatx8 &v, const Floatx8 &lod, const Floatx8 &mask, Floatx8 &x, Floatx8 &y, Floatx8 &z) const {
+	Floatx8 channels[MATERIAL_CHANNELS];
+	if (hasPackedMaterial()) {
+		sampler.sample(material, u, v, lod, mask, channels);
+		decodeOctahedral(channels[MATERIAL_NORMAL_X], channels[MATERIAL_NORMAL_Y], x, y, z);
+		return;
+	}
+
+	sampleTexture(normalMap, virtualNormalMap.get(), u, v, lod, mask, channels);
+	x = ((channels[0] / 255.f) * 2.0f) - 1.f;
+	y = ((channels[1] / 255.f) * 2.0f) - 1.f;
+	z = ((channels[2] / 255.f) * 2.0f) - 1.f;
+}
+
+Floatx8 Mesh::getSpecularIntensities(const Floatx8 &u, const Floatx8 &v, const Floatx8 &lod, const Floatx8 &mask) const {
+	Floatx8 channels[MATERIAL_CHANNELS];
+	if (hasPackedMaterial()) {
+		sampler.sample(material, u, v, lod, mask, channels);
+		return channels[MATERIAL_SPECULAR];
+	}
+	sampleTexture(specularMap, virtualSpecularMap.get(), u, v, lod, mask, channels);
+	return channels[0];
+}
+
+void Mesh::getMaterials(const Floatx8 &u, const Floatx8 &v, const Floatx8 &lod, const Floatx8 &mask, RGBA colours[Floatx8::LANES], Floatx8 &normalX, Floatx8 &normalY, Floatx8 &normalZ, Floatx8 &specular) const {
+	if (!hasPackedMaterial()) {
+		getDiffuseColors(u, v, lod, mask, colours);
+		getNormalsFromMap(u, v, lod, mask, normalX, normalY, normalZ);
+		specular = getSpecularIntensities(u, v, lod, mask);
+		return;
+	}
+
+	Floatx8 channels[MATERIAL_CHANNELS];
+	sampler.sample(material, u, v, lod, mask, channels);
+	toColours(channels, colours);
+	decodeOctahedral(channels[MATERIAL_NORMAL_X], channels[MATERIAL_NORMAL_Y], normalX, normalY, normalZ);
+	specular = channels[MATERIAL_SPECULAR];
 }
 
 int Mesh::getVerticesCount() const {
-	return vertices.size();
+	return isQuantized() ? loaded.quantizedVertices.size() : vertices.size();
 }
 
 int Mesh::getTextureCoordinatesCount() const {
-	return textureCoordinates.size();
+	return isQuantized() ? loaded.quantizedTextureCoordinates.size() : textureCoordinates.size();
 }
 
 int Mesh::getNormalsCount() const {
-	return normals.size();
+	return isQuantized() ? loaded.quantizedNormals.size() : normals.size();
 }
 
 int Mesh::getFacesCount() const {
-	return faces.size();
-}
-
-const std::vector<FaceVector>& Mesh::getFaces() const {
-	return faces;
+	return loaded.quantizedFaces.empty() ? faces.size() : loaded.quantizedFaces.size();
 }
 
 Vector3f Mesh::getDiffuseTextureCoordinate(size_t index) const {
+	if (isQuantized()) {
+		assert(index < loaded.quantizedTextureCoordinates.size());
+		const HalfTextureCoordinate &uv = loaded.quantizedTextureCoordinates[index];
+		return Vector3f(VertexEncoding::halfToFloat(uv.u), VertexEncoding::halfToFloat(uv.v), 0.0f);
+	}
 	assert(index < textureCoordinates.size());
 	Vector3f uv = textureCoordinates[index];
 	return uv;
 }
 
-const Vector3f& Mesh::getVertex(size_t index) const {
+Vector3f Mesh::getVertex(size_t index) const {
+	if (isQuantized()) {
+		assert(index < loaded.quantizedVertices.size());
+		const QuantizedPosition &position = loaded.quantizedVertices[index];
+		return Vector3f(dequantization[0][0] * position.x + dequantization[0][3], dequantization[1][1] * position.y + dequantization[1][3], dequantization[2][2] * position.z + dequantization[2][3]);
+	}
 	assert(index < vertices.size());
 	return vertices[index];
 }
 
-const Vector3f& Mesh::getNormal(size_t index) const {
+Vector3f Mesh::getNormal(size_t index) const {
+	if (isQuantized()) {
+		assert(index < loaded.quantizedNormals.size());
+		return VertexEncoding::decodeOctahedral(loaded.quantizedNormals[index]);
+	}
 	assert(index < normals.size());
 	return normals[index];
 }
 
-const FaceVector& Mesh::getFace(size_t index) const {
+FaceVector Mesh::getFace(size_t index) const {
+	if (!loaded.quantizedFaces.empty()) {
+		assert(index < loaded.quantizedFaces.size());
+		const QuantizedFace &face = loaded.quantizedFaces[index];
+		const Vector3i &base = loaded.clusterBases[index / VertexEncoding::FACES_PER_CLUSTER];
+		FaceVector decoded;
+		for (int i = 0; i < 3; i++) {
+			decoded[i] = Vector3i(base.x + face[i].vertex, base.y + face[i].textureCoordinate, base.z + face[i].normal);
+		}
+		return decoded;
+	}
 	assert(index < faces.size());
 	return faces[index];
 }
 
+Vector3i Mesh::getFaceCorner(size_t faceIndex, int vertexIndex) const {
+	if (!loaded.quantizedFaces.empty()) {
+		assert(faceIndex < loaded.quantizedFaces.size());
+		const QuantizedCorner &corner = loaded.quantizedFaces[faceIndex][vertexIndex];
+		const Vector3i &base = loaded.clusterBases[faceIndex / VertexEncoding::FACES_PER_CLUSTER];
+		return Vector3i(base.x + corner.vertex, base.y + corner.textureCoordinate, base.z + corner.normal);
+	}
+	assert(faceIndex < faces.size());
+	return faces[faceIndex][vertexIndex];
+}
+
+const Vector3f& Mesh::getTangent(size_t index) const {
+	assert(index < tangents.size());
+	return tangents[index];
+}
+
+float Mesh::getBitangentSign(size_t index) const {
+	assert(index < bitangentSigns.size());
+	return bitangentSigns[index];
+}
+
+const Vector3i& Mesh::getFaceTangents(size_t index) const {
+	assert(index < faceTangents.size());
+	return faceTangents[index];
+}
+
 void Mesh::translate(Vector3f translation) {
 	Matrix4f translationMatrix = {
 		{ 1,0,0,translation.x },
@@ -1,12 +1,25 @@
 #pragma once
 
+#include <atomic>
+#include <future>
+#include <memory>
+#include <mutex>
 #include <string>
 #include <vector>
 #include "../types/Vector3.h"
 #include "../types/Types.h"
 #include "../types/Matrix.h"
-
-using FaceVector = std::vector<Vector3i>;
+#include "../types/Floatx8.h"
+#include "../types/ArrayView.h"
+#include "../types/VertexFormat.h"
+#include "Texture.h"
+#include "Sampler.h"
+#include "VirtualTexture.h"
+#include "ObjFile.h"
+#include "ScanFile.h"
+#include "ChunkedGeometry.h"
+#include "MappedFile.h"
+#include "JobSystem.h"
 
 class Mesh {
 
@@ -15,26 +28,130 @@ public:
 	~Mesh();
 
 	void loadObjFromFile(const std::string& path);
+	// Loads the meshes of a binary glTF file (see GlbFile) with the base colour and
+	// normal textures of its material, or 1x1 placeholders for the ones it lacks
+	void loadGlbFromFile(const std::string &path);
+	// Streams a binary STL or PLY scan (see ScanFile) by its extension, welding vertices
+	// by position. Scans have no texture coordinates, textures that weren't loaded get
+	// 1x1 placeholders.
+	void loadScanFromFile(const std::string &path, const ScanFile::ProgressCallback &progress = nullptr);
+	// Maps an asset pack (see AssetPack) and reads the geometry and textures in place,
+	// replacing the ones loaded before. false when it isn't a whole pack of this version.
+	bool loadAssetPack(const std::string &path);
+	// Writes the geometry, tangents and textures to an asset pack, only the base level
+	// of the textures without mipmaps when mipmaps is false. Virtual textures and
+	// quantized geometry aren't written.
+	bool saveAssetPack(const std::string &path, bool mipmaps = true) const;
+	// Maps a chunk file (see ChunkedGeometry) in place of the geometry, for meshes larger
+	// than memory. Nothing is read until the rasterizer binds the chunks it draws, the
+	// geometry getters return the arrays of the bound chunk. false when it isn't a whole
+	// chunk file of this version.
+	bool loadChunkFile(const std::string &path);
+	// Writes the geometry and tangents to a chunk file, at most facesPerChunk faces per
+	// chunk. The geometry can't be quantized.
+	bool saveChunkFile(const std::string &path, int facesPerChunk = 16384) const;
 	void loadDiffuseTexture(const std::string& path);
 	void loadNormalMap(const std::string& path);
 	void loadSpecularMap(const std::string& path);
+	// Parses the OBJ file and decodes every texture side by side, as background jobs of
+	// the shared job system. The mesh must not be used until the future is waited on, which runs
+	// the jobs still queued on the waiting thread, so the future is deferred rather than
+	// ready by itself. Textures with an empty path are skipped.
+	std::future<void> loadAsync(const std::string &objPath, const std::string &diffusePath, const std::string &normalMapPath, const std::string &specularMapPath);
+	// Loads in the background while the mesh is drawn. The OBJ file is parsed in slices
+	// and the textures start as 1x1 placeholders. endFrame() takes in the faces parsed
+	// and the textures decoded since the frame before, and the final geometry with the
+	// tangents and bounds of the whole mesh. The loads are background jobs of the shared
+	// job system, which the frames never wait on. Textures with an empty path are skipped.
+	void loadProgressive(const std::string &objPath, const std::string &diffusePath, const std::string &normalMapPath, const std::string &specularMapPath);
+	// whether part of a progressive load hasn't been taken in yet
+	bool isLoading() const { return progressive != nullptr; }
 
 	int getVerticesCount() const;
 	int getTextureCoordinatesCount() const;
 	int getNormalsCount() const;
 	int getFacesCount() const;
-	const std::vector<FaceVector>& getFaces() const;
+	// empty when the geometry is quantized
+	ArrayView<FaceVector> getFaces() const { return faces; }
+	ArrayView<Vector3f> getVertices() const { return vertices; }
+	ArrayView<Vector3f> getNormals() const { return normals; }
+	ArrayView<Vector3f> getTangents() const { return tangents; }
+	ArrayView<float> getBitangentSigns() const { return bitangentSigns; }
+	// corners of the axis aligned box around the vertices
+	const Vector3f& getBoundsMin() const { return boundsMin; }
+	const Vector3f& getBoundsMax() const { return boundsMax; }
 
-	const Vector3f& getVertex(size_t index) const;
+	// decoded when the geometry is quantized
+	Vector3f getVertex(size_t index) const;
 	Vector3f getDiffuseTextureCoordinate(size_t index) const;
-	const Vector3f& getNormal(size_t index) const;
-	const FaceVector& getFace(size_t index) const;
+	Vector3f getNormal(size_t index) const;
+	FaceVector getFace(size_t index) const;
+	// vertex, texture coordinate and normal indices of a corner of a face
+	Vector3i getFaceCorner(size_t faceIndex, int vertexIndex) const;
+	const Vector3f& getTangent(size_t index) const;
+	float getBitangentSign(size_t index) const;
+	const Vector3i& getFaceTangents(size_t index) const;
+	bool hasTangents() const { return !tangents.empty(); }
+
+	// Format of the vertex attributes of the OBJ, glTF, scan and progressive loads after
+	// this call. Quantized meshes read their positions and normals through the getters
+	// below, the kernels of VertexKernels decode them in the vertex stage.
+	void setVertexFormat(VertexFormat format) { vertexFormat = format; }
+	bool isQuantized() const { return !loaded.quantizedVertices.empty(); }
+	ArrayView<QuantizedPosition> getQuantizedVertices() const { return loaded.quantizedVertices; }
+	ArrayView<OctahedralNormal> getQuantizedNormals() const { return loaded.quantizedNormals; }
+	// scales quantized positions to the bounds, to apply before the transform
+	const Matrix4f& getDequantizationMatrix() const { return dequantization; }
+
+	bool isChunked() const { return chunks != nullptr; }
+	size_t getChunkCount() const { return chunks != nullptr ? chunks->getChunkCount() : 0; }
+	void getChunkBounds(size_t index, Vector3f &min, Vector3f &max) const { chunks->getChunkBounds(index, min, max); }
+	// points the geometry views at the arrays of the chunk, paging it in
+	void bindChunk(size_t index);
+	// starts reading a chunk that is likely to be bound soon
+	void prefetchChunk(size_t index) { chunks->prefetch(index); }
+	// bytes of chunks kept in memory, for the chunk files loaded after this call
+	void setChunkBudget(size_t bytes) { chunkBudget = bytes; }
 
 	RGBA getDiffuseColor(const Vector3f &textureCoordinate) const;
 	Vector3f getNormalFromMap(const Vector3f &textureCoordinate) const;
 	RGBA getNormalAsColour(const Vector3f &textureCoordinate) const;
 	float getSpecularIntensity(const Vector3f &textureCoordinate) const;
 
+	// Eight lane versions of the lookups above. lod is the log2 of the footprint of
+	// every lane in uv units (see Shader::textureLod), it picks the mip level once
+	// scaled by the texture size. Lanes outside the mask are not fetched.
+	void getDiffuseColors(const Floatx8 &u, const Floatx8 &v, const Floatx8 &lod, const Floatx8 &mask, RGBA colours[Floatx8::LANES]) const;
+	void getNormalsFromMap(const Floatx8 &u, const Floatx8 &v, const Floatx8 &lod, const Floatx8 &mask, Floatx8 &x, Floatx8 &y, Floatx8 &z) const;
+	Floatx8 getSpecularIntensities(const Floatx8 &u, const Floatx8 &v, const Floatx8 &lod, const Floatx8 &mask) const;
+	// the three lookups above with a single fetch when the material is packed
+	void getMaterials(const Floatx8 &u, const Floatx8 &v, const Floatx8 &lod, const Floatx8 &mask, RGBA colours[Floatx8::LANES], Floatx8 &normalX, Floatx8 &normalY, Floatx8 &normalZ, Floatx8 &specular) const;
+
+	// Interleaves the diffuse texture, normal map and specular map, which must have the
+	// same size and be uncompressed, into one texture of 8 byte texels (see
+	// MaterialChannel) and releases the three textures. Every lookup reads the packed
+	// material afterwards. Virtual textures can't be packed.
+	void packMaterial();
+	bool hasPackedMaterial() const { return !material.empty(); }
+
+	void setSampler(const Sampler &textureSampler) { sampler = textureSampler; }
+	const Sampler& getSampler() const { return sampler; }
+	// layout of the textures loaded after this call
+	void setTextureLayout(TextureLayout layout) { textureLayout = layout; }
+	// Block compresses the textures loaded from images after this call: BC1 for the
+	// diffuse texture (BC3 with alpha), BC5 for the normal map (BC1 when it has normals
+	// facing away from the surface) and BC4 for the specular map. DDS files are always
+	// loaded in their own format.
+	void setTextureCompression(bool enabled) { textureCompression = enabled; }
+	// Textures loaded from tile files (.vt, see VirtualTexture::createTileFile) after this
+	// call keep at most this many pages in memory, besides their mip tail
+	void setVirtualTextureBudget(int pages) { virtualTextureBudget = pages; }
+	// loads the pages of the virtual textures requested while drawing the frame and
+	// takes in what a progressive load has loaded since the last call
+	void endFrame();
+	// whether endFrame may change the mesh, while it loads or has virtual textures
+	bool needsEndFrame() const { return progressive != nullptr || virtualDiffuse != nullptr || virtualNormalMap != nullptr || virtualSpecularMap != nullptr; }
+
 	const Matrix4f& getModelMatrix() const { return model; }
 	void translate(Vector3f translation);
 	void scale(float x, float y, float z);
@@ -44,23 +161,102 @@ public:
 
 private:
 
-	struct Texture {
-		int width;
-		int height;
-		int pitch;
-		byte *data;
-	};
-	
+	Sampler sampler;
+	TextureLayout textureLayout;
+	bool textureCompression;
+	int virtualTextureBudget;
+	size_t chunkBudget;
+	VertexFormat vertexFormat;
 	Matrix4f model;
 	Texture diffuse;
 	Texture normalMap;
 	Texture specularMap;
+	Texture material;
+	std::unique_ptr<VirtualTexture> virtualDiffuse;
+	std::unique_ptr<VirtualTexture> virtualNormalMap;
+	std::unique_ptr<VirtualTexture> virtualSpecularMap;
 
-	std::vector<Vector3f> vertices;
-	std::vector<Vector3f> textureCoordinates;
-	std::vector<Vector3f> normals;
-	std::vector<FaceVector> faces;
+	// The geometry is read through views of the vectors in loaded, of a mapped asset
+	// pack or GLB file which mapping keeps alive, or of the bound chunk of chunks
+	ArrayView<Vector3f> vertices;
+	ArrayView<Vector3f> textureCoordinates;
+	ArrayView<Vector3f> normals;
+	ArrayView<FaceVector> faces;
+	Vector3f boundsMin;
+	Vector3f boundsMax;
+
+	// Tangent frames, one per distinct (vertex, uv, normal) corner. faceTangents
+	// holds the index into tangents of the first three corners of every face.
+	ArrayView<Vector3f> tangents;
+	ArrayView<float> bitangentSigns;
+	ArrayView<Vector3i> faceTangents;
+
+	struct Geometry {
+		std::vector<Vector3f> vertices;
+		std::vector<Vector3f> textureCoordinates;
+		std::vector<Vector3f> normals;
+		std::vector<FaceVector> faces;
+		std::vector<Vector3f> tangents;
+		std::vector<float> bitangentSigns;
+		std::vector<Vector3i> faceTangents;
+
+		// The attributes of VertexFormat::QUANTIZED, which replace the ones above apart
+		// from the tangents. Faces keep 32 bit indices when the indices of a cluster span
+		// more than 16 bits, clusterBases holds the first indices of every cluster.
+		std::vector<QuantizedPosition> quantizedVertices;
+		std::vector<OctahedralNormal> quantizedNormals;
+		std::vector<HalfTextureCoordinate> quantizedTextureCoordinates;
+		std::vector<QuantizedFace> quantizedFaces;
+		std::vector<Vector3i> clusterBases;
+	};
+	Geometry loaded;
+	Matrix4f dequantization;
+	std::shared_ptr<const MappedFile> mapping;
+	std::unique_ptr<ChunkedGeometry> chunks;
+
+	// What a progressive load has loaded and endFrame() hasn't taken in yet, shared
+	// with its loading jobs
+	struct ProgressiveLoad {
+		ProgressiveLoad() : parsed(false), decoded(), cancelled(false), loads(JobSystem::shared(), true), remaining(0) {}
+
+		std::mutex mutex;
+		// faces parsed since the last frame with the attributes parsed before them, and
+		// the tangent frames of those faces
+		Geometry batch;
+		// the whole mesh once it's parsed
+		Geometry whole;
+		bool parsed;
+		// diffuse texture, normal map and specular map
+		Texture textures[3];
+		std::unique_ptr<VirtualTexture> virtualTextures[3];
+		bool decoded[3];
+		std::atomic<bool> cancelled;
+		// the OBJ file parsed in slices and a job per texture
+		TaskGroup loads;
+		// parts not taken in yet, only used by endFrame
+		int remaining;
+	};
+	std::unique_ptr<ProgressiveLoad> progressive;
 	std::vector<Vector3f> spaceVertices;
 
-	void loadTexture(Texture &texture, const std::string &filename, int format);
+	void loadTexture(Texture &texture, std::unique_ptr<VirtualTexture> &virtualTexture, const std::string &filename, int format, TextureFormat compressedFormat);
+	// builds a texture from a decoded RGBA8 image, in the layout and compression set
+	void createTexture(Texture &texture, byte *data, int width, int height, TextureFormat compressedFormat) const;
+	// 1x1 textures for the ones that are missing, light grey, a flat normal and the
+	// tightest specular highlight
+	void createPlaceholderTextures();
+	// lookups in the virtual texture when there is one
+	const byte* lookupTexel(const Texture &texture, const VirtualTexture *virtualTexture, const Vector3f &textureCoordinate) const;
+	void sampleTexture(const Texture &texture, const VirtualTexture *virtualTexture, const Floatx8 &u, const Floatx8 &v, const Floatx8 &lod, const Floatx8 &mask, Floatx8 *channels) const;
+	void computeTangents();
+	void computeBounds();
+	// appends the elements of batch, which indexes the attributes of geometry
+	static void appendGeometry(Geometry &geometry, const Geometry &batch);
+	void takeProgressiveLoad();
+	// cancels a progressive load and waits for its jobs
+	void stopLoading();
+	// points the views at the vectors in loaded
+	void viewLoadedGeometry();
+	// replaces the loaded geometry with its quantized version when the format asks for it
+	void quantizeGeometry();
 };
\ No newline at end of file
@@ -0,0 +1,329 @@
+#include "ObjFile.h"
+#include "MappedFile.h"
+#include "JobSystem.h"
+
+#include <cmath>
+#include <cstring>
+#include <algorithm>
+
+namespace {
+	// smaller chunks aren't worth a job
+	const size_t MIN_CHUNK_SIZE = 1 << 20;
+	// sizes of the slices of loadInSlices, small first for a quick first slice
+	const size_t FIRST_SLICE_SIZE = 1 << 20;
+	const size_t MAX_SLICE_SIZE = 32 << 20;
+
+	// powers of ten that are exact in a double
+	const double POWERS_OF_TEN[] = {
+		1e0, 1e1, 1e2, 1e3, 1e4, 1e5, 1e6, 1e7, 1e8, 1e9, 1e10, 1e11,
+		1e12, 1e13, 1e14, 1e15, 1e16, 1e17, 1e18, 1e19, 1e20, 1e21, 1e22
+	};
+
+	enum Attribute { POSITION, TEXTURE_COORDINATE, NORMAL };
+
+	struct Chunk {
+		const char *begin;
+		const char *end;
+		std::vector<Vector3f> attributes[3];
+		std::vector<FaceVector> faces;
+		// bit 3 * corner + attribute is set for indices that are relative to the
+		// attributes of the previous chunks, which are only known when merging
+		std::vector<unsigned short> relativeIndices;
+		// index of the first attribute of the chunk in the merged vectors
+		int bases[3];
+		size_t firstFace;
+	};
+
+	bool isSpace(char c) {
+		return c == ' ' || c == '\t' || c == '\r';
+	}
+
+	bool isDigit(char c) {
+		return c >= '0' && c <= '9';
+	}
+
+	const char* skipSpaces(const char *p, const char *end) {
+		while (p < end && isSpace(*p)) {
+			p++;
+		}
+		return p;
+	}
+
+	const char* nextLine(const char *p, const char *end) {
+		const char *newLine = static_cast<const char*>(std::memchr(p, '\n', end - p));
+		return newLine != nullptr ? newLine + 1 : end;
+	}
+
+	// decimal number with optional fraction and exponent, 0 when there is none
+	const char* parseFloat(const char *p, const char *end, float &value) {
+		p = skipSpaces(p, end);
+		bool negative = false;
+		if (p < end && (*p == '-' || *p == '+')) {
+			negative = *p == '-';
+			p++;
+		}
+
+		// the first 19 significant digits fit in the mantissa, the rest only scale it
+		unsigned long long mantissa = 0;
+		int digits = 0, exponent = 0;
+		for (; p < end && isDigit(*p); p++) {
+			if (digits < 19) {
+				mantissa = mantissa * 10 + (*p - '0');
+				digits += mantissa != 0;
+			} else {
+				exponent++;
+			}
+		}
+		if (p < end && *p == '.') {
+			for (p++; p < end && isDigit(*p); p++) {
+				if (digits < 19) {
+					mantissa = mantissa * 10 + (*p - '0');
+					digits += mantissa != 0;
+					exponent--;
+				}
+			}
+		}
+		if (p < end && (*p == 'e' || *p == 'E')) {
+			const char *exponentStart = p++;
+			bool negativeExponent = false;
+			if (p < end && (*p == '-' || *p == '+')) {
+				negativeExponent = *p == '-';
+				p++;
+			}
+			if (p < end && isDigit(*p)) {
+				int written = 0;
+				for (; p < end && isDigit(*p); p++) {
+					written = std::min(written * 10 + (*p - '0'), 10000);
+				}
+				exponent += negativeExponent ? -written : written;
+			} else {
+				p = exponentStart;
+			}
+		}
+
+		double result = static_cast<double>(mantissa);
+		if (mantissa != 0) {
+			if (exponent < 0 && exponent >= -22) {
+				result /= POWERS_OF_TEN[-exponent];
+			} else if (exponent > 0 && exponent <= 22) {
+				result *= POWERS_OF_TEN[exponent];
+			} else if (exponent != 0) {
+				result *= std::pow(10.0, exponent);
+			}
+		}
+		value = static_cast<float>(negative ? -result : result);
+		return p;
+	}
+
+	const char* parseInt(const char *p, const char *end, int &value) {
+		bool negative = false;
+		if (p < end && (*p == '-' || *p == '+')) {
+			negative = *p == '-';
+			p++;
+		}
+		int result = 0;
+		for (; p < end && isDigit(*p); p++) {
+			result = result * 10 + (*p - '0');
+		}
+		value = negative ? -result : result;
+		return p;
+	}
+
+	const char* parseVector(const char *p, const char *end, int components, std::vector<Vector3f> &attribute) {
+		Vector3f vector(0.0f, 0.0f, 0.0f);
+		for (int i = 0; i < components; i++) {
+			p = parseFloat(p, end, vector[i]);
+		}
+		attribute.push_back(vector);
+		return p;
+	}
+
+	// one v/vt/vn corner, relative gets the bit of every attribute with a negative index
+	const char* parseCorner(const char *p, const char *end, const Chunk &chunk, Vector3i &corner, int &relative) {
+		corner = { 0, 0, 0 };
+		relative = 0;
+		for (int attribute = 0; attribute < 3; attribute++) {
+			if (attribute > 0) {
+				if (p == end || *p != '/') {
+					break;
+				}
+				p++;
+			}
+
+			int index = 0;
+			p = parseInt(p, end, index);
+			if (index > 0) {
+				corner[attribute] = index - 1;
+			} else if (index < 0) {
+				corner[attribute] = static_cast<int>(chunk.attributes[attribute].size()) + index;
+				relative |= 1 << attribute;
+			}
+		}
+		// skip what is left of a malformed corner
+		while (p < end && !isSpace(*p) && *p != '\n') {
+			p++;
+		}
+		return p;
+	}
+
+	const char* parseFace(const char *p, const char *end, Chunk &chunk) {
+		Vector3i first, previous, corner;
+		int firstRelative = 0, previousRelative = 0, relative = 0;
+		for (int corners = 0;; corners++) {
+			p = skipSpaces(p, end);
+			if (p == end || !(isDigit(*p) || *p == '-' || *p == '+')) {
+				return p;
+			}
+
+			p = parseCorner(p, end, chunk, corner, relative);
+			if (corners == 0) {
+				first = corner;
+				firstRelative = relative;
+			} else if (corners >= 2) {
+				// fan around the first corner
+				FaceVector face = { { first, previous, corner } };
+				chunk.faces.push_back(face);
+				chunk.relativeIndices.push_back(static_cast<unsigned short>(firstRelative | (previousRelative << 3) | (relative << 6)));
+			}
+			previous = corner;
+			previousRelative = relative;
+		}
+	}
+
+	void parseChunk(Chunk &chunk) {
+		const char *end = chunk.end;
+		for (const char *p = chunk.begin; p < end; p = nextLine(p, end)) {
+			p = skipSpaces(p, end);
+			if (end - p < 2) {
+				continue;
+			}
+
+			if (p[0] == 'v') {
+				if (isSpace(p[1])) {
+					parseVector(p + 1, end, 3, chunk.attributes[POSITION]);
+				} else if (p[1] == 't' && end - p > 2 && isSpace(p[2])) {
+					parseVector(p + 2, end, 2, chunk.attributes[TEXTURE_COORDINATE]);
+				} else if (p[1] == 'n' && end - p > 2 && isSpace(p[2])) {
+					parseVector(p + 2, end, 3, chunk.attributes[NORMAL]);
+				}
+			} else if (p[0] == 'f' && isSpace(p[1])) {
+				parseFace(p + 1, end, chunk);
+			}
+		}
+	}
+
+	void mergeChunk(const Chunk &chunk, std::vector<Vector3f> *attributes[3], std::vector<FaceVector> &faces) {
+		for (int attribute = 0; attribute < 3; attribute++) {
+			std::copy(chunk.attributes[attribute].begin(), chunk.attributes[attribute].end(), attributes[attribute]->begin() + chunk.bases[attribute]);
+		}
+
+		FaceVector *merged = faces.data() + chunk.firstFace;
+		for (size_t i = 0; i < chunk.faces.size(); i++) {
+			merged[i] = chunk.faces[i];
+			const unsigned short relative = chunk.relativeIndices[i];
+			if (relative == 0) {
+				continue;
+			}
+			for (int corner = 0; corner < 3; corner++) {
+				for (int attribute = 0; attribute < 3; attribute++) {
+					if (relative & (1 << (corner * 3 + attribute))) {
+						merged[i][corner][attribute] += chunk.bases[attribute];
+					}
+				}
+			}
+		}
+	}
+
+	// runs task(i) for every chunk on the job system, the first one on the calling thread
+	template <typename Task>
+	void forEachChunk(std::vector<Chunk> &chunks, Task task) {
+		JobSystem::shared().parallelFor(0, chunks.size(), 1, [&task](size_t begin, size_t end) {
+			for (size_t i = begin; i < end; i++) {
+				task(i);
+			}
+		});
+	}
+}
+
+namespace ObjFile {
+
+	bool load(const std::string &path, std::vector<Vector3f> &vertices, std::vector<Vector3f> &textureCoordinates, std::vector<Vector3f> &normals, std::vector<FaceVector> &faces) {
+		MappedFile file(path, true);
+		if (!file.isOpen()) {
+			return false;
+		}
+		parse(reinterpret_cast<const char*>(file.data()), file.size(), vertices, textureCoordinates, normals, faces);
+		return true;
+	}
+
+	bool loadInSlices(const std::string &path, std::vector<Vector3f> &vertices, std::vector<Vector3f> &textureCoordinates, std::vector<Vector3f> &normals, std::vector<FaceVector> &faces, const std::function<bool()> &sliceParsed) {
+		MappedFile file(path, true);
+		if (!file.isOpen()) {
+			return false;
+		}
+		for (std::vector<Vector3f> *attribute : { &vertices, &textureCoordinates, &normals }) {
+			attribute->clear();
+		}
+		faces.clear();
+
+		const char *text = reinterpret_cast<const char*>(file.data());
+		const char *end = text + file.size();
+		size_t sliceSize = FIRST_SLICE_SIZE;
+		for (const char *begin = text; begin < end; sliceSize = std::min(sliceSize * 2, MAX_SLICE_SIZE)) {
+			const char *split = end - begin > static_cast<std::ptrdiff_t>(sliceSize) ? nextLine(begin + sliceSize, end) : end;
+			append(begin, split - begin, vertices, textureCoordinates, normals, faces);
+			begin = split;
+			if (!sliceParsed()) {
+				break;
+			}
+		}
+		return true;
+	}
+
+	void parse(const char *text, size_t size, std::vector<Vector3f> &vertices, std::vector<Vector3f> &textureCoordinates, std::vector<Vector3f> &normals, std::vector<FaceVector> &faces, int threads) {
+		for (std::vector<Vector3f> *attribute : { &vertices, &textureCoordinates, &normals }) {
+			attribute->clear();
+		}
+		faces.clear();
+		append(text, size, vertices, textureCoordinates, normals, faces, threads);
+	}
+
+	void append(const char *text, size_t size, std::vector<Vector3f> &vertices, std::vector<Vector3f> &textureCoordinates, std::vector<Vector3f> &normals, std::vector<FaceVector> &faces, int threads) {
+		if (threads <= 0) {
+			threads = JobSystem::shared().getThreadCount();
+		}
+		const size_t chunkCount = std::max<size_t>(1, std::min<size_t>(threads, size / MIN_CHUNK_SIZE));
+
+		// move every split to the start of the next line
+		std::vector<Chunk> chunks(chunkCount);
+		const char *end = text + size;
+		const char *begin = text;
+		for (size_t i = 0; i < chunkCount; i++) {
+			const char *split = i + 1 == chunkCount ? end : std::max(begin, text + size / chunkCount * (i + 1));
+			chunks[i].begin = begin;
+			chunks[i].end = split == end ? end : nextLine(split, end);
+			begin = chunks[i].end;
+		}
+
+		forEachChunk(chunks, [&chunks](size_t i) { parseChunk(chunks[i]); });
+
+		// the chunks go after what the vectors hold
+		std::vector<Vector3f> *attributes[3] = { &vertices, &textureCoordinates, &normals };
+		int counts[3] = { static_cast<int>(vertices.size()), static_cast<int>(textureCoordinates.size()), static_cast<int>(normals.size()) };
+		size_t faceCount = faces.size();
+		for (Chunk &chunk : chunks) {
+			for (int attribute = 0; attribute < 3; attribute++) {
+				chunk.bases[attribute] = counts[attribute];
+				counts[attribute] += static_cast<int>(chunk.attributes[attribute].size());
+			}
+			chunk.firstFace = faceCount;
+			faceCount += chunk.faces.size();
+		}
+		for (int attribute = 0; attribute < 3; attribute++) {
+			attributes[attribute]->resize(counts[attribute]);
+		}
+		faces.resize(faceCount);
+
+		forEachChunk(chunks, [&chunks, &attributes, &faces](size_t i) { mergeChunk(chunks[i], attributes, faces); });
+	}
+}
\ No newline at end of file
@@ -0,0 +1,35 @@
+#pragma once
+
+#include <array>
+#include <functional>
+#include <string>
+#include <vector>
+#include "../types/Vector3.h"
+
+// vertex, texture coordinate and normal indices of the three corners of a triangle
+using FaceVector = std::array<Vector3i, 3>;
+
+// Parser of Wavefront OBJ files. It reads the positions, texture coordinates, normals
+// and faces, ignoring every other statement. Polygons are split into triangle fans and
+// negative indices, relative to the end of the data read so far, are resolved. Missing
+// indices of a corner are 0.
+namespace ObjFile {
+
+	// Maps the file and parses it in chunks split at line boundaries, one per thread.
+	// false when the file can't be opened.
+	bool load(const std::string &path, std::vector<Vector3f> &vertices, std::vector<Vector3f> &textureCoordinates, std::vector<Vector3f> &normals, std::vector<FaceVector> &faces);
+
+	// Maps the file and parses it in slices split at line boundaries, which double from
+	// 1 MB up to 32 MB, appending to the vectors. sliceParsed is called after every slice
+	// and parsing stops when it returns false. Faces of valid files only refer to data
+	// before them, so the vectors hold a whole mesh after every slice. false when the
+	// file can't be opened.
+	bool loadInSlices(const std::string &path, std::vector<Vector3f> &vertices, std::vector<Vector3f> &textureCoordinates, std::vector<Vector3f> &normals, std::vector<FaceVector> &faces, const std::function<bool()> &sliceParsed);
+
+	// Parses size bytes of text in at most threads chunks, 0 for one per thread of the job system, into
+	// the vectors, replacing what they held
+	void parse(const char *text, size_t size, std::vector<Vector3f> &vertices, std::vector<Vector3f> &textureCoordinates, std::vector<Vector3f> &normals, std::vector<FaceVector> &faces, int threads = 0);
+
+	// parse that appends to the vectors, negative indices are relative to their end
+	void append(const char *text, size_t size, std::vector<Vector3f> &vertices, std::vector<Vector3f> &textureCoordinates, std::vector<Vector3f> &normals, std::vector<FaceVector> &faces, int threads = 0);
+}
\ No newline at end of file
@@ -1,27 +1,21 @@
 #include "Rasterizer.h"
 #include <algorithm>
 
-#include "../shaders/FaceIlluminationShader.h"
-#include "../shaders/GouraudShader.h"
-#include "../shaders/ClampIlluminationShader.h"
-#include "../shaders/ZBufferShader.h"
-#include "../shaders/PhongShader.h"
-#include "../shaders/TangentNormalShader.h"
-
-Rasterizer::Rasterizer(Mesh *mesh, Camera *camera) : mesh(mesh), camera(camera) {
-	frameBuffer = new RGBA[SCREEN_WIDTH * SCREEN_HEIGHT];
-	zBuffer = new float[SCREEN_WIDTH * SCREEN_HEIGHT];
+Rasterizer::Rasterizer(Mesh *mesh, Camera *camera) : mesh(mesh), camera(camera), front(0), precision(ShadingPrecision::EXACT), window(nullptr), texture(nullptr), renderer(nullptr) {
+	frames.emplace_back(new Frame());
 	clearBuffers();
 }
 
 Rasterizer::~Rasterizer() {
-	delete[] frameBuffer;
-	delete[] zBuffer;
-
-	SDL_DestroyWindow(window);
-	SDL_DestroyTexture(texture);
-	SDL_DestroyRenderer(renderer);
-	SDL_Quit();
+	// the frames in flight use the shader and the buffers
+	pipeline.reset();
+
+	if (window != nullptr) {
+		SDL_DestroyWindow(window);
+		SDL_DestroyTexture(texture);
+		SDL_DestroyRenderer(renderer);
+		SDL_Quit();
+	}
 }
 
 void Rasterizer::createWindow() {
@@ -37,10 +31,55 @@ void Rasterizer::createWindow() {
 }
 
 void Rasterizer::clearBuffers() {
-	memset(frameBuffer, 0x00, sizeof(RGBA) * SCREEN_HEIGHT * SCREEN_WIDTH);
+	if (pipeline == nullptr) {
+		clearFrame(*frames[front]);
+	}
+}
+
+void Rasterizer::clearFrame(Frame &frame) {
+	JobSystem::shared().parallelFor(0, SCREEN_HEIGHT, CLEAR_ROWS_PER_JOB, [&frame](size_t first, size_t last) {
+		const size_t offset = first * SCREEN_WIDTH;
+		CpuDispatch::kernels().clear(frame.frameBuffer.get() + offset, frame.zBuffer.get() + offset, (last - first) * SCREEN_WIDTH, -std::numeric_limits<float>::max());
+	});
+}
+
+void Rasterizer::loadShader(std::unique_ptr<Shader> &shader) {
+	flush();
+	this->shader = std::move(shader);
+}
+
+void Rasterizer::setPipelineDepth(int depth) {
+	flush();
+	pipeline.reset();
+
+	// the frame presented last moves to the last slot, the first frame of a pipeline
+	// is drawn in the first one
+	const int slots = depth > 1 ? depth + 1 : 1;
+	std::swap(frames[0], frames[front]);
+	frames.resize(slots);
+	for (std::unique_ptr<Frame> &frame : frames) {
+		if (frame == nullptr) {
+			frame.reset(new Frame());
+		}
+	}
+	std::swap(frames[0], frames.back());
+	front = slots - 1;
+
+	if (depth > 1) {
+		pipeline.reset(new FramePipeline(JobSystem::shared(), depth,
+			[this](int slot) { processGeometry(*frames[slot], false); },
+			[this](int slot) {
+				Frame &frame = *frames[slot];
+				clearFrame(frame);
+				drawTiles(frame, 0, frame.sliceCount);
+				frame.sliceCount = 0;
+			}));
+	}
+}
 
-	for (int i = 0; i < SCREEN_WIDTH * SCREEN_HEIGHT; i++) {
-		zBuffer[i] = -std::numeric_limits<float>::max();
+void Rasterizer::flush() {
+	while (pipeline != nullptr && pipeline->getFramesInFlight() > 0) {
+		presentFrame(pipeline->waitForFrame());
 	}
 }
 
@@ -65,121 +104,232 @@ void Rasterizer::createProjectionMatrix() {
 	projection[3][2] = -1.f / (camera->eye - camera->center).magnitude();
 }
 
-void Rasterizer::setUniformsInShader() {
-	assert(shader != nullptr);
+Uniforms Rasterizer::createUniforms(const Frame &frame) const {
+	Uniforms uniforms;
+	uniforms.mesh = mesh;
+	uniforms.transform = transform;
+	uniforms.lightDirection = light;
+	uniforms.MWP = projection * view * mesh->getModelMatrix();
+	uniforms.MWPInversedTransposed = uniforms.MWP.invertTranspose();
+	uniforms.transformedLightDirection = uniforms.MWP.transformPoint(light).normalize();
+	uniforms.zBuffer = frame.zBuffer.get();
+	uniforms.depth = 320;
+	uniforms.screenWidth = SCREEN_WIDTH;
+	uniforms.precision = precision;
+	return uniforms;
+}
 
-	switch (shader->getType()) {
-		case ShaderType::FACE_ILLUMINATION:
-		{
-			FaceIlluminationShader * tmp = dynamic_cast<FaceIlluminationShader*>(shader.get());
-			tmp->mesh = mesh;
-			tmp->lightDirection = light;
-			tmp->transform = transform;
-		}
-		break;
-
-		case ShaderType::GOURAUD:
-		{
-			GouraudShader * tmp = dynamic_cast<GouraudShader*>(shader.get());
-			tmp->mesh = mesh;
-			tmp->lightDirection = light;
-			tmp->transform = transform;
-		}
-		break;
-
-		case ShaderType::CLAMP_ILUMINATION:
-		{
-			ClampIlluminationShader * tmp = dynamic_cast<ClampIlluminationShader*>(shader.get());
-			tmp->mesh = mesh;
-			tmp->lightDirection = light;
-			tmp->transform = transform;
-		}
-		break;
-		
-		case ShaderType::ZBUFFER:
-		{
-			ZBufferShader * tmp = dynamic_cast<ZBufferShader*>(shader.get());
-			tmp->mesh = mesh;
-			tmp->zBuffer = zBuffer;
-			tmp->depth = 320;
-			tmp->screenWidth = SCREEN_WIDTH;
-			tmp->transform = transform;
-		}
-		break;
-
-		case ShaderType::PHONG:
-		{
-			PhongShader * tmp = dynamic_cast<PhongShader*>(shader.get());
-			tmp->mesh = mesh;
-			tmp->transform = transform;
-			tmp->MWP = projection * view * mesh->getModelMatrix();
-			tmp->lightDirection = MatrixVectorf::vectorFromHomogeneousMatrix(tmp->MWP * Matrix4f::homogeneousMatrixfromVector(light)).normalize();
-			tmp->MWPInversedTransposed = (projection * view * mesh->getModelMatrix()).invertTranspose();
-		}
-		break;
+void Rasterizer::draw() {
+	assert(shader != nullptr);
 
-		case ShaderType::TANGENT_NORMAL:
-		{
-			TangentNormalShader * tmp = dynamic_cast<TangentNormalShader*>(shader.get());
-			tmp->mesh = mesh;
-			tmp->transform = transform;
-		}
-		break;
+	if (pipeline == nullptr) {
+		Frame &frame = *frames[front];
+		prepareFrame(frame);
+		processGeometry(frame, true);
+		// page in what the frame missed for the next one
+		mesh->endFrame();
+		presentFrame(front);
+		return;
+	}
 
-		default:
-			assert("uniforms not set");
-		break;
+	// the mesh can only change while no frame uses it
+	if (mesh->needsEndFrame()) {
+		flush();
+		mesh->endFrame();
+	}
+	prepareFrame(*frames[pipeline->getNextSlot()]);
+	pipeline->submit();
+	while (pipeline->getFramesInFlight() >= pipeline->getDepth()) {
+		presentFrame(pipeline->waitForFrame());
 	}
 }
 
-void Rasterizer::draw() {
-	assert(shader != nullptr);
-
+void Rasterizer::prepareFrame(Frame &frame) {
 	// Create the transform matrix 
 	model = mesh->getModelMatrix();
 	view = camera->lookat();
 	projection[3][2] = -1.f / (camera->eye - camera->center).magnitude();
 	transform = viewport * projection * view * model;
 
-	setUniformsInShader();
+	frame.uniforms = createUniforms(frame);
+	frame.shader = shader.get();
+}
 
-	// draw faces of the mesh
-	for (int i = 0; i < mesh->getFacesCount(); i++) {
-		const FaceVector& face = mesh->getFace(i);
-		Vector3f screenCoordinates[3];
-		for (int j = 0; j < 3; j++) {
-			screenCoordinates[j] = shader->vertex(i, j);
-		}
+void Rasterizer::presentFrame(int slot) {
+	front = slot;
+	if (window != nullptr) {
+		SDL_UpdateTexture(texture, nullptr, frames[slot]->frameBuffer.get(), SCREEN_WIDTH * sizeof(byte) * 4);
+		SDL_RenderClear(renderer);
+		SDL_RenderCopy(renderer, texture, nullptr, nullptr);
+		SDL_RenderPresent(renderer);
+	}
+}
 
-		shader->geometry(i, screenCoordinates);
+void Rasterizer::processFaces(Frame &frame, bool drawSlices) {
+	// Faces of the mesh are binned in slices, which bound the memory of the triangles
+	// drawn at once. Slices drawn as they are binned take turns in SLICE_SLOTS slots and
+	// are drawn in order, the others are kept until the raster stage.
+	const int faceCount = mesh->getFacesCount();
+	const int sliceCount = (faceCount + MAX_BINNED_FACES - 1) / MAX_BINNED_FACES;
+	const size_t firstSlot = frame.sliceCount;
+	const size_t slotCount = drawSlices && sliceCount > SLICE_SLOTS ? SLICE_SLOTS : sliceCount;
+	if (frame.slices.size() < firstSlot + slotCount) {
+		frame.slices.resize(firstSlot + slotCount);
+	}
 
-		// back face culling
-		Vector3f faceNormal = (screenCoordinates[1] - screenCoordinates[0]) ^ (screenCoordinates[2] - screenCoordinates[0]);
-		faceNormal.normalize();
-		if (faceNormal.dot(light) > 0.0f) {
-			drawTriangle(screenCoordinates);
+	TaskGraph &graph = frame.geometry;
+	graph.clear();
+	// transform all the vertices of the mesh at once
+	const int vertices = graph.add([&frame]() { frame.shader->vertexBatch(frame.uniforms, frame.streams); });
+	std::vector<int> draws;
+	for (int i = 0; i < sliceCount; i++) {
+		const int first = i * MAX_BINNED_FACES;
+		const int last = std::min(first + MAX_BINNED_FACES, faceCount);
+		const size_t slot = firstSlot + (drawSlices ? i % SLICE_SLOTS : i);
+		std::vector<int> dependencies(1, vertices);
+		if (drawSlices && i >= SLICE_SLOTS) {
+			// the slot is free once the slice binned in it before is drawn
+			dependencies.push_back(draws[i - SLICE_SLOTS]);
 		}
+		const int bin = graph.add([this, &frame, slot, first, last]() { binFaces(frame, frame.slices[slot], first, last); }, dependencies);
+		if (drawSlices) {
+			dependencies.assign(1, bin);
+			if (i > 0) {
+				dependencies.push_back(draws.back());
+			}
+			draws.push_back(graph.add([this, &frame, slot]() { drawTiles(frame, slot, slot + 1); }, dependencies));
+		}
+	}
+	graph.run(JobSystem::shared());
+	if (!drawSlices) {
+		frame.sliceCount += sliceCount;
 	}
+}
+
+void Rasterizer::binFaces(Frame &frame, BinnedFaces &slice, int first, int last) {
+	// Ranges of faces are set up in parallel, each into bins of its own, so every bin
+	// holds its triangles in face order and the tiles draw them in the order of the mesh
+	JobSystem &jobs = JobSystem::shared();
+	const Uniforms &uniforms = frame.uniforms;
+	const Shader &shader = *frame.shader;
+	const VertexStreams &streams = frame.streams;
+	const size_t faceCount = last - first;
+	slice.ranges = std::max<size_t>(1, std::min<size_t>(jobs.getThreadCount() * BIN_RANGES_PER_THREAD, faceCount / MIN_FACES_PER_BIN_RANGE));
+	slice.triangles.resize(faceCount);
+	slice.bins.resize(std::max(slice.bins.size(), slice.ranges * TILE_COUNT));
+
+	jobs.parallelFor(0, slice.ranges, 1, [&](size_t begin, size_t end) {
+		for (size_t range = begin; range < end; range++) {
+			std::vector<int> *rangeBins = &slice.bins[range * TILE_COUNT];
+			for (int tile = 0; tile < TILE_COUNT; tile++) {
+				rangeBins[tile].clear();
+			}
 
-	SDL_UpdateTexture(texture, nullptr, frameBuffer, SCREEN_WIDTH * sizeof(byte) * 4);
-	SDL_RenderClear(renderer);
-	SDL_RenderCopy(renderer, texture, nullptr, nullptr);
-	SDL_RenderPresent(renderer);
+			const int rangeFirst = first + static_cast<int>(faceCount * range / slice.ranges);
+			const int rangeLast = first + static_cast<int>(faceCount * (range + 1) / slice.ranges);
+			for (int i = rangeFirst; i < rangeLast; i++) {
+				Triangle &triangle = slice.triangles[i - first];
+				for (int j = 0; j < 3; j++) {
+					triangle.vertices[j] = shader.assembleVertex(uniforms, streams, i, j);
+				}
+
+				shader.geometry(uniforms, i, triangle);
+
+				// back face culling
+				const Varyings *v = triangle.vertices;
+				Vector3f faceNormal = (v[1].position - v[0].position) ^ (v[2].position - v[0].position);
+				faceNormal.normalize();
+				if (!(faceNormal.dot(uniforms.lightDirection) > 0.0f) || isDegenerate(v[0].position, v[1].position, v[2].position)) {
+					continue;
+				}
+
+				// triangles off screen have an empty box
+				const BoundingBox box = calculateBoundingBoxOfTriangle(v[0].position, v[1].position, v[2].position);
+				if (box.min.x > box.max.x || box.min.y > box.max.y) {
+					continue;
+				}
+				for (int y = box.min.y / TILE_SIZE; y <= box.max.y / TILE_SIZE; y++) {
+					for (int x = box.min.x / TILE_SIZE; x <= box.max.x / TILE_SIZE; x++) {
+						rangeBins[x + y * TILES_X].push_back(i - first);
+					}
+				}
+			}
+		}
+	});
 }
 
+void Rasterizer::drawTiles(Frame &frame, size_t first, size_t last) {
+	// every tile writes its own pixels only, they need no synchronization
+	JobSystem::shared().parallelFor(0, TILE_COUNT, 1, [&](size_t begin, size_t end) {
+		for (size_t tile = begin; tile < end; tile++) {
+			BoundingBox tileBox;
+			tileBox.min = Vector2i(static_cast<int>(tile % TILES_X) * TILE_SIZE, static_cast<int>(tile / TILES_X) * TILE_SIZE);
+			tileBox.max = Vector2i(tileBox.min.x + TILE_SIZE - 1, tileBox.min.y + TILE_SIZE - 1);
+			for (size_t s = first; s < last; s++) {
+				const BinnedFaces &slice = frame.slices[s];
+				for (size_t range = 0; range < slice.ranges; range++) {
+					for (int triangle : slice.bins[range * TILE_COUNT + tile]) {
+						drawTriangle(frame, slice.triangles[triangle], tileBox);
+					}
+				}
+			}
+		}
+	});
+}
+
+void Rasterizer::processGeometry(Frame &frame, bool drawSlices) {
+	if (!mesh->isChunked()) {
+		processFaces(frame, drawSlices);
+		return;
+	}
+
+	// Every visible chunk is read ahead before the first one is drawn, then the chunks
+	// just off screen while there is room for them, for the frames to come
+	visibleChunks.clear();
+	nearbyChunks.clear();
+	Vector3f min, max;
+	for (size_t i = 0; i < mesh->getChunkCount(); i++) {
+		mesh->getChunkBounds(i, min, max);
+		if (isBoxInsideFrustum(frame.uniforms.transform, min, max, 0.0f)) {
+			visibleChunks.push_back(i);
+		} else if (isBoxInsideFrustum(frame.uniforms.transform, min, max, CHUNK_PREFETCH_MARGIN)) {
+			nearbyChunks.push_back(i);
+		}
+	}
+	for (const std::vector<size_t> *chunks : { &visibleChunks, &nearbyChunks }) {
+		for (size_t chunk : *chunks) {
+			mesh->prefetchChunk(chunk);
+		}
+	}
 
-bool Rasterizer::passZBufferTest(const Vector2i &point, const Vector3f &v0, const Vector3f &v1, const Vector3f &v2, const Vector3f &barycentricCoordinates) {
-	float zValue = v0.z *barycentricCoordinates.x + v1.z * barycentricCoordinates.y + v2.z * barycentricCoordinates.z;
+	for (size_t chunk : visibleChunks) {
+		mesh->bindChunk(chunk);
+		processFaces(frame, drawSlices);
+	}
+}
 
-	int index = point.x + point.y * SCREEN_WIDTH;
-	if (zBuffer[index] < zValue) {
-		zBuffer[index] = zValue;
-		return true;
-	} else {
-		return false;
+bool Rasterizer::isBoxInsideFrustum(const Matrix4f &transform, const Vector3f &min, const Vector3f &max, float margin) const {
+	// Planes of the screen rectangle and of the eye in model space, from the rows of the
+	// transform: x >= -margin * width becomes (row 0 + margin * width * row 3) . p >= 0.
+	// The box is outside when its corner furthest along the normal of a plane is behind it.
+	const float left = -margin * SCREEN_WIDTH, right = (1.0f + margin) * SCREEN_WIDTH;
+	const float bottom = -margin * SCREEN_HEIGHT, top = (1.0f + margin) * SCREEN_HEIGHT;
+	const float planeWeights[5][2] = { { 1.0f, -left }, { -1.0f, right }, { 1.0f, -bottom }, { -1.0f, top }, { 0.0f, 1.0f } };
+	const int planeRows[5] = { 0, 0, 1, 1, 0 };
+	for (int i = 0; i < 5; i++) {
+		float plane[4];
+		for (int j = 0; j < 4; j++) {
+			plane[j] = planeWeights[i][0] * transform[planeRows[i]][j] + planeWeights[i][1] * transform[3][j];
+		}
+		const Vector3f corner(plane[0] >= 0.0f ? max.x : min.x, plane[1] >= 0.0f ? max.y : min.y, plane[2] >= 0.0f ? max.z : min.z);
+		if (plane[0] * corner.x + plane[1] * corner.y + plane[2] * corner.z + plane[3] < 0.0f) {
+			return false;
+		}
 	}
+	return true;
 }
 
+
 void Rasterizer::drawBoundingBox(const BoundingBox &box, const RGBA &colour) {
 	drawLine(box.min.x, box.min.y, box.max.x, box.min.y, colour);
 	drawLine(box.min.x, box.max.y, box.max.x, box.max.y, colour);
@@ -190,8 +340,7 @@ void Rasterizer::drawBoundingBox(const BoundingBox &box, const RGBA &colour) {
 void Rasterizer::plotPixel(int x, int y, RGBA colour) {
 	assert(x < SCREEN_WIDTH && y < SCREEN_HEIGHT);
 
-	int index = x + ((SCREEN_HEIGHT - y) * SCREEN_WIDTH);
-	frameBuffer[index] = colour;
+	frames[front]->frameBuffer[pixelIndex(x, y)] = colour;
 }
 
 void Rasterizer::drawLine(int x0, int y0, int x1, int y1, RGBA colour) {
@@ -228,23 +377,39 @@ void Rasterizer::drawLine(int x0, int y0, int x1, int y1, RGBA colour) {
 	}
 }
 
-void Rasterizer::drawTriangle(Vector3f vertices[3]) {
-	// check if triangle is degenerate to discard it
-	if (isDegenerate(vertices[0], vertices[1], vertices[2])) {
-		return;
-	}
+void Rasterizer::drawTriangle(Frame &frame, const Triangle &triangle, const BoundingBox &tile) {
+	const Vector3f vertices[3] = { triangle.vertices[0].position, triangle.vertices[1].position, triangle.vertices[2].position };
 
-	// draw triangle
+	// draw the part of the triangle in the tile walking its bounding box in blocks of two
+	// 2x2 quads, tiles are made of whole blocks
 	BoundingBox box = calculateBoundingBoxOfTriangle(vertices[0], vertices[1], vertices[2]);
-	for (int x = box.min.x; x <= box.max.x; x++) {
-		for (int y = box.min.y; y <= box.max.y; y++) {
-			Vector2i point = { x, y };
-			Vector3f barycentric = calculateBarycentricCoordinates(point, vertices[0], vertices[1], vertices[2]);
-			if (isPointInsideTriangle(barycentric) && passZBufferTest(point, vertices[0], vertices[1], vertices[2], barycentric)) {
-				// Call fragment shader
-				shader->FRAGMENT_COORDINATES = point;
-				RGBA colour = shader->fragment(barycentric);
-				plotPixel(x, y, colour);
+	box.min.x = std::max(box.min.x, tile.min.x);
+	box.min.y = std::max(box.min.y, tile.min.y);
+	box.max.x = std::min(box.max.x, tile.max.x);
+	box.max.y = std::min(box.max.y, tile.max.y);
+	const KernelTable &kernels = CpuDispatch::kernels();
+	FragmentBatch batch;
+	RGBA colours[FragmentBatch::SIZE];
+	for (int y = box.min.y & ~1; y <= box.max.y; y += 2) {
+		for (int x = box.min.x & ~3; x <= box.max.x; x += 4) {
+			batch.x = x;
+			batch.y = y;
+			int mask = kernels.coverage(batch, vertices[0], vertices[1], vertices[2], box);
+			if (mask == 0) {
+				continue;
+			}
+
+			batch.mask = kernels.depthTest(batch, mask, vertices[0], vertices[1], vertices[2], frame.zBuffer.get(), SCREEN_WIDTH);
+			if (batch.mask == 0) {
+				continue;
+			}
+
+			// Call fragment shader
+			frame.shader->fragmentBatch(frame.uniforms, triangle, batch, colours);
+			for (int i = 0; i < FragmentBatch::SIZE; i++) {
+				if (batch.mask & (1 << i)) {
+					frame.frameBuffer[pixelIndex(x + FragmentBatch::laneOffsetX(i), y + FragmentBatch::laneOffsetY(i))] = colours[i];
+				}
 			}
 		}
 	}
@@ -262,22 +427,11 @@ BoundingBox Rasterizer::calculateBoundingBoxOfTriangle(const Vector3f &v0, const
 	box.max = Vector2i(std::max({ v0.x, v1.x, v2.x }),
 		std::max({ v0.y, v1.y, v2.y }));
 
+	// clipped to the screen, triangles partly off screen would wrap around the rows
+	box.min.x = std::max(box.min.x, 0);
+	box.min.y = std::max(box.min.y, 0);
 	box.max.x = std::min(box.max.x, SCREEN_WIDTH - 1);
 	box.max.y = std::min(box.max.y, SCREEN_HEIGHT - 1);
 
 	return box;
-}
-
-Vector3f Rasterizer::calculateBarycentricCoordinates(const Vector2i &point, const Vector3f &v0, const Vector3f &v1, const Vector3f &v2) {
-	Vector3f a(v2.x - v0.x, v1.x - v0.x, v0.x - point.x);
-	Vector3f b(v2.y - v0.y, v1.y - v0.y, v0.y - point.y);
-	Vector3f u = a.cross(b);
-	if (u.z == 0) {
-		return Vector3f(-1, 1, 1);
-	}
-	return Vector3f(1.f - (u.x + u.y) / u.z, u.y / u.z, u.x / u.z);
-}
-
-bool Rasterizer::isPointInsideTriangle(const Vector3f &barycentricCoordinates) {
-	return barycentricCoordinates.x >= 0 && barycentricCoordinates.y >= 0 && barycentricCoordinates.z >= 0;
 }
\ No newline at end of file
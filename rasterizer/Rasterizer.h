@@ -2,10 +2,14 @@
 
 #include <SDL.h>
 #include <memory>
+#include <vector>
 
 #include "Mesh.h"
 #include "../types/Types.h"
 #include "Camera.h"
+#include "CpuDispatch.h"
+#include "JobSystem.h"
+#include "FramePipeline.h"
 #include "../shaders/Shader.h"
 
 class Rasterizer {
@@ -17,24 +21,102 @@ public:
 	void createWindow();
 	void createViewportMatrix();
 	void createProjectionMatrix();
-	void loadShader(std::unique_ptr<Shader> &shader) { this->shader = std::move(shader); }
+	// waits for the frames in flight, which are drawn with the shader before
+	void loadShader(std::unique_ptr<Shader> &shader);
 
 	void draw();
+	// Clears the buffers the next frame is drawn in. Pipelined frames are cleared by
+	// their raster stage, it does nothing then.
 	void clearBuffers();
 
+	// Frames in flight at once. With more than one, draw starts the frame and presents the
+	// one submitted depth - 1 frames before, so the vertex stage and triangle setup of
+	// a frame overlap the fragment stage of the frames before it (see FramePipeline).
+	// Meshes still loading or paging in virtual textures wait for the frames in flight
+	// before every frame. 1, the default, draws every frame before draw returns.
+	void setPipelineDepth(int depth);
+	int getPipelineDepth() const { return pipeline != nullptr ? pipeline->getDepth() : 1; }
+	// presents the frames in flight
+	void flush();
+
+	// Colours of the last frame presented, SCREEN_WIDTH * SCREEN_HEIGHT of them from the
+	// top row down. Without createWindow the rasterizer draws into them without
+	// presenting them.
+	const RGBA* getFrameBuffer() const { return frames[front]->frameBuffer.get(); }
+	static int getScreenWidth() { return SCREEN_WIDTH; }
+	static int getScreenHeight() { return SCREEN_HEIGHT; }
+
 	void setCamera(Camera* camera) { this->camera = camera; }
 	void setLightPosition(const Vector3f light) { this->light = light; }
-	void setFpsCount(int fps) { SDL_SetWindowTitle(window, ("Software Renderer FPS:" + std::to_string(fps)).c_str()); }
+	void setShadingPrecision(ShadingPrecision precision) { this->precision = precision; }
+	ShadingPrecision getShadingPrecision() const { return precision; }
+	void setFpsCount(int fps) { SDL_SetWindowTitle(window, ("Software Renderer (" + std::string(CpuDispatch::getIsaName(CpuDispatch::getActiveIsa())) + ") FPS:" + std::to_string(fps)).c_str()); }
 
 private:
 
 	static const int SCREEN_WIDTH = 1024;
 	static const int SCREEN_HEIGHT = 768;
+	// the depth test reads and writes whole batches of 4x2 fragments
+	static_assert(SCREEN_WIDTH % 4 == 0 && SCREEN_HEIGHT % 2 == 0, "the screen has to be made of whole batches");
+	// chunks this far off screen, as a fraction of the screen size, are read ahead
+	static constexpr float CHUNK_PREFETCH_MARGIN = 0.25f;
+
+	// Triangles are binned to square tiles of the screen, which are drawn in parallel.
+	// Tiles are made of whole batches.
+	static const int TILE_SIZE = 64;
+	static const int TILES_X = SCREEN_WIDTH / TILE_SIZE;
+	static const int TILES_Y = SCREEN_HEIGHT / TILE_SIZE;
+	static const int TILE_COUNT = TILES_X * TILES_Y;
+	static_assert(SCREEN_WIDTH % TILE_SIZE == 0 && SCREEN_HEIGHT % TILE_SIZE == 0 && TILE_SIZE % 4 == 0, "the screen has to be made of whole tiles");
+	// faces binned before their tiles are drawn, which bounds the memory of the triangles
+	static const int MAX_BINNED_FACES = 1 << 16;
+	// slices drawn as they are binned take turns in this many, so one is binned while
+	// the one before is drawn
+	static const int SLICE_SLOTS = 2;
+	// ranges of faces binned in parallel
+	static const size_t BIN_RANGES_PER_THREAD = 4;
+	static const size_t MIN_FACES_PER_BIN_RANGE = 256;
+	static const size_t CLEAR_ROWS_PER_JOB = 64;
+
+	// Set up triangles of a slice of faces and the indices of those that cover every
+	// tile, TILE_COUNT bins for each range of faces binned in parallel
+	struct BinnedFaces {
+		std::vector<Triangle> triangles;
+		std::vector<std::vector<int>> bins;
+		size_t ranges;
+	};
+
+	// Everything a frame is drawn with, so the frames in flight share nothing but the
+	// mesh and its shader
+	struct Frame {
+		Frame() : shader(nullptr), frameBuffer(new RGBA[SCREEN_WIDTH * SCREEN_HEIGHT]), zBuffer(new float[SCREEN_WIDTH * SCREEN_HEIGHT]), sliceCount(0) {}
+
+		Uniforms uniforms;
+		const Shader *shader;
+		std::unique_ptr<RGBA[]> frameBuffer;
+		std::unique_ptr<float[]> zBuffer;
+		VertexStreams streams;
+		// slices binned and not drawn yet, the vector keeps the ones before for reuse
+		std::vector<BinnedFaces> slices;
+		size_t sliceCount;
+		// vertex stage, bins and draws of the slices of the mesh bound last
+		TaskGraph geometry;
+	};
 
 	Mesh *mesh;
 	Camera *camera;
 	std::unique_ptr<Shader> shader;
+	// chunks of the frame that are on screen and just off screen, for the vertex stage
+	// of one frame at a time
+	std::vector<size_t> visibleChunks;
+	std::vector<size_t> nearbyChunks;
+	// one frame, or a slot per frame of the pipeline
+	std::vector<std::unique_ptr<Frame>> frames;
+	// frame presented last
+	int front;
+	std::unique_ptr<FramePipeline> pipeline;
 	Vector3f light;
+	ShadingPrecision precision;
 
 	Matrix4f model;
 	Matrix4f view;
@@ -46,19 +128,29 @@ private:
 	SDL_Texture* texture;
 	SDL_Renderer* renderer;
 
-	RGBA *frameBuffer;
-	float *zBuffer;
-
+	// index in the frame buffer of a pixel, y counts up from the bottom row
+	static int pixelIndex(int x, int y) { return x + ((SCREEN_HEIGHT - 1 - y) * SCREEN_WIDTH); }
 	void plotPixel(int x, int y, RGBA colour);
 	void drawLine(int x0, int y0, int x1, int y1, RGBA colour);
-	void drawTriangle(Vector3f vertices[3]);
+	void drawTriangle(Frame &frame, const Triangle &triangle, const BoundingBox &tile);
+	void clearFrame(Frame &frame);
+	// Runs the vertex stage and bins the faces of the frame. With drawSlices every slice
+	// is drawn once it's binned, which bounds the memory of the triangles, otherwise the
+	// raster stage draws them all.
+	void processGeometry(Frame &frame, bool drawSlices);
+	void processFaces(Frame &frame, bool drawSlices);
+	void binFaces(Frame &frame, BinnedFaces &slice, int first, int last);
+	// draws the slices [first, last) of the frame
+	void drawTiles(Frame &frame, size_t first, size_t last);
+	void presentFrame(int slot);
 	
-	void setUniformsInShader();
+	void prepareFrame(Frame &frame);
+	Uniforms createUniforms(const Frame &frame) const;
 
+	// whether the box in model space may be on screen through transform, grown by margin
+	// times its size
+	bool isBoxInsideFrustum(const Matrix4f &transform, const Vector3f &min, const Vector3f &max, float margin) const;
 	bool isDegenerate(const Vector3f &v0, const Vector3f &v1, const Vector3f &v2);
 	BoundingBox calculateBoundingBoxOfTriangle(const Vector3f &v0, const Vector3f &v1, const Vector3f &v2);
-	bool isPointInsideTriangle(const Vector3f &barycentricCoordinates);
-	Vector3f calculateBarycentricCoordinates(const Vector2i &point, const Vector3f &v0, const Vector3f &v1, const Vector3f &v2);
-	bool passZBufferTest(const Vector2i &point, const Vector3f &v0, const Vector3f &v1, const Vector3f &v2, const Vector3f &barycentricCoordinates);
 	void drawBoundingBox(const BoundingBox &box, const RGBA &colour);
 };
\ No newline at end of file
@@ -0,0 +1,275 @@
+#include "Sampler.h"
+#include "BlockCompression.h"
+#include "CpuDispatch.h"
+
+#include <cmath>
+#include <cstring>
+#include <cassert>
+#include <algorithm>
+
+namespace {
+	// Byte offsets of texels split into their row and column parts, see Texture::texelOffset
+	Intx8 rowOffsets(const Texture &texture, const Intx8 &pitch, const Intx8 &y) {
+		return texture.layout == TextureLayout::TILED ? (y >> 2) * pitch + ((y & Intx8(3)) << (texture.texelShift + 2)) : y * pitch;
+	}
+
+	Intx8 columnOffsets(const Texture &texture, const Intx8 &x) {
+		return texture.layout == TextureLayout::TILED ? ((x >> 2) << (texture.texelShift + 4)) + ((x & Intx8(3)) << texture.texelShift) : x << texture.texelShift;
+	}
+
+	void splitChannels(const Intx8 &packed, Floatx8 channels[4]) {
+		for (int c = 0; c < 4; c++) {
+			channels[c] = ((packed >> (c * 8)) & Intx8(0xFF)).toFloat();
+		}
+	}
+
+	// reads four bytes at offsets of every lane in the mask and splits them in channels
+	void gatherTexels(const byte *texels, const Intx8 &offsets, const Floatx8 &mask, Floatx8 channels[4]) {
+		int offset[Floatx8::LANES];
+		float split[4][Floatx8::LANES];
+		offsets.store(offset);
+		CpuDispatch::kernels().gatherTexels(texels, offset, mask.movemask(), split);
+		for (int c = 0; c < 4; c++) {
+			channels[c] = Floatx8::load(split[c]);
+		}
+	}
+
+	// every four bytes of the texels at offsets
+	void gatherTexels(const Texture &texture, const Intx8 &offsets, const Floatx8 &mask, Floatx8 *channels) {
+		for (int c = 0; c < texture.texelSize(); c += 4) {
+			gatherTexels(texture.data(), offsets + Intx8(c), mask, channels + c);
+		}
+	}
+
+	struct DecodedBlock {
+		// id of the texture, 0 while the entry is empty
+		unsigned int texture;
+		int offset;
+		byte texels[64];
+	};
+
+	// Direct mapped cache of decoded blocks. Neighbouring fragments and the four taps of
+	// bilinear filtering mostly hit the same blocks, each thread keeps its own cache.
+	const int DECODED_BLOCK_CACHE_SIZE = 256;
+	thread_local DecodedBlock decodedBlockCache[DECODED_BLOCK_CACHE_SIZE];
+	thread_local DecodedBlock decodedBlockScratch;
+
+	// RGBA8 texels of the block at offset, valid until the next call on this thread
+	const byte* decodeBlock(const Texture &texture, int offset, bool cached) {
+		if (!cached) {
+			BlockCompression::decodeBlock(texture.format, texture.data() + offset, decodedBlockScratch.texels);
+			return decodedBlockScratch.texels;
+		}
+
+		const unsigned int slot = (static_cast<unsigned int>(offset) / texture.blockSize() + texture.id * 2654435761u) % DECODED_BLOCK_CACHE_SIZE;
+		DecodedBlock &entry = decodedBlockCache[slot];
+		if (entry.texture != texture.id || entry.offset != offset) {
+			BlockCompression::decodeBlock(texture.format, texture.data() + offset, entry.texels);
+			entry.texture = texture.id;
+			entry.offset = offset;
+		}
+		return entry.texels;
+	}
+
+	// texels (x, y) of every lane in the mask, through the blocks that hold them
+	void decodeTexels(const Texture &texture, const Intx8 &levelOffset, const Intx8 &pitch, const Intx8 &x, const Intx8 &y, const Floatx8 &mask, bool cached, Floatx8 channels[4]) {
+		int blocks[Floatx8::LANES], indices[Floatx8::LANES], values[Floatx8::LANES];
+		(levelOffset + (y >> 2) * pitch + (x >> 2) * Intx8(texture.blockSize())).store(blocks);
+		(((y & Intx8(3)) << 2) + (x & Intx8(3))).store(indices);
+
+		const int bits = mask.movemask();
+		for (int i = 0; i < Floatx8::LANES; i++) {
+			values[i] = 0;
+			if (bits & (1 << i)) {
+				std::memcpy(&values[i], decodeBlock(texture, blocks[i], cached) + indices[i] * 4, 4);
+			}
+		}
+		splitChannels(Intx8::load(values), channels);
+	}
+}
+
+Sampler::Sampler(TextureFilter filter, TextureWrap wrap, bool decodedBlockCache) : filter(filter), wrap(wrap), decodedBlockCache(decodedBlockCache) {}
+
+const byte* Sampler::texel(const Texture &texture, const Vector3f &textureCoordinate) const {
+	assert(!texture.empty());
+	const MipLevel &level = texture.levels[0];
+	float u = textureCoordinate.x, v = textureCoordinate.y;
+	if (wrap == TextureWrap::REPEAT) {
+		u -= std::floor(u);
+		v -= std::floor(v);
+	}
+	if (texture.topDown) {
+		v = 1.0f - v;
+	}
+	int x = std::min(std::max(static_cast<int>(u * level.width), 0), level.width - 1);
+	int y = std::min(std::max(static_cast<int>(v * level.height), 0), level.height - 1);
+	if (texture.compressed()) {
+		return decodeBlock(texture, texture.blockOffset(level, x, y), decodedBlockCache) + ((y & 3) * 4 + (x & 3)) * 4;
+	}
+	return texture.data() + texture.texelOffset(level, x, y);
+}
+
+void Sampler::sample(const Texture &texture, const Floatx8 &u, const Floatx8 &v, const Floatx8 &lod, const Floatx8 &mask, Floatx8 *channels) const {
+	assert(!texture.empty());
+	if (filter != TextureFilter::TRILINEAR) {
+		int levels[Floatx8::LANES];
+		nearestLevels(texture, lod, levels);
+		fetch(texture, levels, u, v, mask, filter == TextureFilter::BILINEAR, channels);
+		return;
+	}
+
+	const int lastLevel = static_cast<int>(texture.levels.size()) - 1;
+	float levelOfDetail[Floatx8::LANES];
+	(lod + Floatx8(std::log2(static_cast<float>(std::max(texture.levels[0].width, texture.levels[0].height))))).store(levelOfDetail);
+
+	int levels[2][Floatx8::LANES];
+	float weights[Floatx8::LANES];
+	for (int i = 0; i < Floatx8::LANES; i++) {
+		float level = levelOfDetail[i];
+		if (!(level > 0.0f)) {
+			levels[0][i] = levels[1][i] = 0;
+			weights[i] = 0.0f;
+		} else if (level >= lastLevel) {
+			levels[0][i] = levels[1][i] = lastLevel;
+			weights[i] = 0.0f;
+		} else {
+			levels[0][i] = static_cast<int>(level);
+			levels[1][i] = levels[0][i] + 1;
+			weights[i] = level - levels[0][i];
+		}
+	}
+
+	Floatx8 fine[MATERIAL_CHANNELS], coarse[MATERIAL_CHANNELS];
+	fetch(texture, levels[0], u, v, mask, true, fine);
+	fetch(texture, levels[1], u, v, mask, true, coarse);
+	const Floatx8 weight = Floatx8::load(weights);
+	for (int c = 0; c < texture.texelSize(); c++) {
+		channels[c] = fine[c] + (coarse[c] - fine[c]) * weight;
+	}
+}
+
+void Sampler::sampleColours(const Texture &texture, const Floatx8 &u, const Floatx8 &v, const Floatx8 &lod, const Floatx8 &mask, RGBA colours[Floatx8::LANES]) const {
+	assert(!texture.empty());
+	if (filter != TextureFilter::NEAREST || texture.compressed()) {
+		Floatx8 channels[MATERIAL_CHANNELS];
+		float values[4][Floatx8::LANES];
+		sample(texture, u, v, lod, mask, channels);
+		for (int c = 0; c < 4; c++) {
+			channels[c].store(values[c]);
+		}
+		CpuDispatch::kernels().packColours(values, colours);
+		return;
+	}
+
+	int levels[Floatx8::LANES], offsets[Floatx8::LANES];
+	nearestLevels(texture, lod, levels);
+	const Footprint texels = footprint(texture, levels, u, v);
+	const Intx8 x = Intx8::min(texels.u >> 8, texels.width - Intx8(1));
+	const Intx8 y = Intx8::min(texels.v >> 8, texels.height - Intx8(1));
+	(texels.levelOffset + rowOffsets(texture, texels.pitch, y) + columnOffsets(texture, x)).store(offsets);
+	CpuDispatch::kernels().gatherColours(texture.data(), offsets, mask.movemask(), colours);
+}
+
+// mip level of every lane, the uv footprint is scaled by the size of the base level
+void Sampler::nearestLevels(const Texture &texture, const Floatx8 &lod, int levels[Floatx8::LANES]) const {
+	const int lastLevel = static_cast<int>(texture.levels.size()) - 1;
+	const MipLevel &base = texture.levels[0];
+	float levelOfDetail[Floatx8::LANES];
+	(lod + Floatx8(std::log2(static_cast<float>(std::max(base.width, base.height))))).store(levelOfDetail);
+	for (int i = 0; i < Floatx8::LANES; i++) {
+		float level = levelOfDetail[i] + 0.5f;
+		levels[i] = level > 0.0f ? std::min(static_cast<int>(level), lastLevel) : 0;
+	}
+}
+
+Sampler::Footprint Sampler::footprint(const Texture &texture, const int levels[Floatx8::LANES], const Floatx8 &u, const Floatx8 &v) const {
+	float scalesU[Floatx8::LANES], scalesV[Floatx8::LANES];
+	int widths[Floatx8::LANES], heights[Floatx8::LANES], pitches[Floatx8::LANES], offsets[Floatx8::LANES];
+	for (int i = 0; i < Floatx8::LANES; i++) {
+		const MipLevel &level = texture.levels[levels[i]];
+		scalesU[i] = level.scaleU;
+		scalesV[i] = level.scaleV;
+		widths[i] = level.width;
+		heights[i] = level.height;
+		pitches[i] = level.pitch;
+		offsets[i] = level.offset;
+	}
+
+	// coordinates brought into [0, 1] first, which keeps the fixed point conversion in
+	// range and non negative so truncating it is a floor
+	Floatx8 wrappedU, wrappedV;
+	if (wrap == TextureWrap::REPEAT) {
+		wrappedU = u - Floatx8::floor(u);
+		wrappedV = v - Floatx8::floor(v);
+	} else {
+		wrappedU = Floatx8::min(Floatx8::max(u, Floatx8(0.0f)), Floatx8(1.0f));
+		wrappedV = Floatx8::min(Floatx8::max(v, Floatx8(0.0f)), Floatx8(1.0f));
+	}
+	if (texture.topDown) {
+		wrappedV = Floatx8(1.0f) - wrappedV;
+	}
+
+	Footprint texels;
+	texels.u = (wrappedU * Floatx8::load(scalesU)).toInt();
+	texels.v = (wrappedV * Floatx8::load(scalesV)).toInt();
+	texels.width = Intx8::load(widths);
+	texels.height = Intx8::load(heights);
+	texels.pitch = Intx8::load(pitches);
+	texels.levelOffset = Intx8::load(offsets);
+	return texels;
+}
+
+void Sampler::fetch(const Texture &texture, const int levels[Floatx8::LANES], const Floatx8 &u, const Floatx8 &v, const Floatx8 &mask, bool bilinear, Floatx8 *channels) const {
+	const Footprint texels = footprint(texture, levels, u, v);
+	const Intx8 &fixedU = texels.u, &fixedV = texels.v;
+	const Intx8 &width = texels.width, &height = texels.height;
+	const Intx8 &pitch = texels.pitch, &levelOffset = texels.levelOffset;
+
+	if (!bilinear) {
+		// a coordinate of exactly 1 lands one past the last texel
+		const Intx8 x = Intx8::min(fixedU >> 8, width - Intx8(1));
+		const Intx8 y = Intx8::min(fixedV >> 8, height - Intx8(1));
+		fetchTexels(texture, levelOffset, pitch, x, y, mask, channels);
+		return;
+	}
+
+	// four closest texel centers, half a texel from the texel corners
+	const Intx8 x = fixedU - Intx8(128);
+	const Intx8 y = fixedV - Intx8(128);
+	const Intx8 x0 = x >> 8;
+	const Intx8 y0 = y >> 8;
+	const Floatx8 fractionX = (x & Intx8(0xFF)).toFloat() * Floatx8(1.0f / 256.0f);
+	const Floatx8 fractionY = (y & Intx8(0xFF)).toFloat() * Floatx8(1.0f / 256.0f);
+	const Intx8 left = wrapTexels(x0, width);
+	const Intx8 right = wrapTexels(x0 + Intx8(1), width);
+	const Intx8 top = wrapTexels(y0, height);
+	const Intx8 bottom = wrapTexels(y0 + Intx8(1), height);
+
+	Floatx8 topLeft[MATERIAL_CHANNELS], topRight[MATERIAL_CHANNELS], bottomLeft[MATERIAL_CHANNELS], bottomRight[MATERIAL_CHANNELS];
+	fetchTexels(texture, levelOffset, pitch, left, top, mask, topLeft);
+	fetchTexels(texture, levelOffset, pitch, right, top, mask, topRight);
+	fetchTexels(texture, levelOffset, pitch, left, bottom, mask, bottomLeft);
+	fetchTexels(texture, levelOffset, pitch, right, bottom, mask, bottomRight);
+	for (int c = 0; c < texture.texelSize(); c++) {
+		const Floatx8 upper = topLeft[c] + (topRight[c] - topLeft[c]) * fractionX;
+		const Floatx8 lower = bottomLeft[c] + (bottomRight[c] - bottomLeft[c]) * fractionX;
+		channels[c] = upper + (lower - upper) * fractionY;
+	}
+}
+
+void Sampler::fetchTexels(const Texture &texture, const Intx8 &levelOffset, const Intx8 &pitch, const Intx8 &x, const Intx8 &y, const Floatx8 &mask, Floatx8 *channels) const {
+	if (texture.compressed()) {
+		decodeTexels(texture, levelOffset, pitch, x, y, mask, decodedBlockCache, channels);
+		return;
+	}
+	gatherTexels(texture, levelOffset + rowOffsets(texture, pitch, y) + columnOffsets(texture, x), mask, channels);
+}
+
+// Texel indices of a bilinear footprint are at most one texel outside [0, size)
+Intx8 Sampler::wrapTexels(const Intx8 &texels, const Intx8 &size) const {
+	const Intx8 last = size - Intx8(1);
+	if (wrap == TextureWrap::REPEAT) {
+		return Intx8::select(texels < Intx8(0), texels + size, Intx8::select(texels > last, texels - size, texels));
+	}
+	return Intx8::min(Intx8::max(texels, Intx8(0)), last);
+}
\ No newline at end of file
@@ -0,0 +1,62 @@
+#pragma once
+
+#include "Texture.h"
+#include "../types/Vector3.h"
+#include "../types/Floatx8.h"
+
+enum class TextureFilter : int {
+	// nearest texel of the nearest mip level
+	NEAREST = 0,
+	// four closest texels of the nearest mip level
+	BILINEAR,
+	// bilinear lookups of the two closest mip levels blended together
+	TRILINEAR
+};
+
+enum class TextureWrap : int {
+	CLAMP = 0,
+	REPEAT
+};
+
+// Filtering and addressing state used to read textures. Texture coordinates are
+// wrapped, then converted once to 24.8 fixed point with the scale factors of the
+// mip level: the integer part addresses the texel and the fraction is the weight
+// of bilinear filtering. Block compressed textures are decoded a block at a time,
+// through a small per thread cache of decoded blocks unless it is disabled.
+class Sampler {
+public:
+	Sampler(TextureFilter filter = TextureFilter::NEAREST, TextureWrap wrap = TextureWrap::CLAMP, bool decodedBlockCache = true);
+
+	// nearest texel of the base level. For compressed textures it points into a per thread
+	// buffer, valid until the next lookup on the same thread.
+	const byte* texel(const Texture &texture, const Vector3f &textureCoordinate) const;
+
+	// Eight lane lookup. lod is the log2 of the footprint of every lane in uv units
+	// (see Shader::textureLod), it picks the mip level once scaled by the texture size.
+	// Lanes outside the mask are not fetched. channels gets one entry per byte of a texel.
+	void sample(const Texture &texture, const Floatx8 &u, const Floatx8 &v, const Floatx8 &lod, const Floatx8 &mask, Floatx8 *channels) const;
+	// The first four channels of sample as colours. Nearest lookups of uncompressed
+	// textures copy the texel bytes as they are, other lookups round the filtered channels.
+	void sampleColours(const Texture &texture, const Floatx8 &u, const Floatx8 &v, const Floatx8 &lod, const Floatx8 &mask, RGBA colours[Floatx8::LANES]) const;
+
+	TextureFilter getFilter() const { return filter; }
+	TextureWrap getWrap() const { return wrap; }
+
+private:
+	TextureFilter filter;
+	TextureWrap wrap;
+	bool decodedBlockCache;
+
+	// texture coordinates of eight lanes in their mip level
+	struct Footprint {
+		// 24.8 fixed point texels
+		Intx8 u, v;
+		Intx8 width, height, pitch, levelOffset;
+	};
+
+	void nearestLevels(const Texture &texture, const Floatx8 &lod, int levels[Floatx8::LANES]) const;
+	Footprint footprint(const Texture &texture, const int levels[Floatx8::LANES], const Floatx8 &u, const Floatx8 &v) const;
+	void fetch(const Texture &texture, const int levels[Floatx8::LANES], const Floatx8 &u, const Floatx8 &v, const Floatx8 &mask, bool bilinear, Floatx8 *channels) const;
+	void fetchTexels(const Texture &texture, const Intx8 &levelOffset, const Intx8 &pitch, const Intx8 &x, const Intx8 &y, const Floatx8 &mask, Floatx8 *channels) const;
+	Intx8 wrapTexels(const Intx8 &texels, const Intx8 &size) const;
+};
\ No newline at end of file
@@ -0,0 +1,430 @@
+#include "ScanFile.h"
+
+#include <chrono>
+#include <cmath>
+#include <cstring>
+#include <fstream>
+#include <algorithm>
+
+namespace {
+	// bytes read from the file at a time
+	const size_t CHUNK_SIZE = 1 << 20;
+
+	// Reads a file through one fixed size buffer, reporting progress on every refill
+	class ChunkReader {
+	public:
+		ChunkReader(const std::string &path, const ScanFile::ProgressCallback &progress, const std::vector<Vector3f> &vertices, const std::vector<FaceVector> &faces)
+			: file(path, std::ifstream::in | std::ifstream::binary), buffer(CHUNK_SIZE), position(0), filled(0), bytesRead(0), totalBytes(0),
+			progress(progress), vertices(vertices), faces(faces), start(std::chrono::high_resolution_clock::now()) {
+			if (file.is_open()) {
+				file.seekg(0, std::ifstream::end);
+				totalBytes = static_cast<uint64_t>(file.tellg());
+				file.seekg(0, std::ifstream::beg);
+			}
+		}
+
+		bool isOpen() const { return file.is_open(); }
+		uint64_t size() const { return totalBytes; }
+
+		bool read(void *data, size_t size) {
+			char *out = static_cast<char*>(data);
+			while (size > 0) {
+				if (position == filled && !refill()) {
+					return false;
+				}
+				const size_t count = std::min(size, filled - position);
+				std::memcpy(out, buffer.data() + position, count);
+				position += count;
+				out += count;
+				size -= count;
+			}
+			return true;
+		}
+
+		// text line without the line break, for headers
+		bool readLine(std::string &line) {
+			line.clear();
+			char c;
+			while (read(&c, 1)) {
+				if (c == '\n') {
+					return true;
+				}
+				if (c != '\r') {
+					line += c;
+				}
+			}
+			return !line.empty();
+		}
+
+		void report() const {
+			if (progress) {
+				const std::chrono::duration<double> elapsed = std::chrono::high_resolution_clock::now() - start;
+				const ScanFile::Progress state = { bytesRead - (filled - position), totalBytes, vertices.size(), faces.size(), elapsed.count() };
+				progress(state);
+			}
+		}
+
+	private:
+		std::ifstream file;
+		std::vector<char> buffer;
+		size_t position;
+		size_t filled;
+		uint64_t bytesRead;
+		uint64_t totalBytes;
+		const ScanFile::ProgressCallback &progress;
+		const std::vector<Vector3f> &vertices;
+		const std::vector<FaceVector> &faces;
+		std::chrono::high_resolution_clock::time_point start;
+
+		bool refill() {
+			if (bytesRead > 0) {
+				report();
+			}
+			file.read(buffer.data(), buffer.size());
+			filled = static_cast<size_t>(file.gcount());
+			position = 0;
+			bytesRead += filled;
+			return filled > 0;
+		}
+	};
+
+	// Open addressing table of the indices of the vertices by position, kept at most
+	// 70% full, 4 bytes per slot on top of the vertices themselves
+	class VertexWelder {
+	public:
+		explicit VertexWelder(std::vector<Vector3f> &vertices) : vertices(vertices) {
+			size_t size = 1024;
+			while (vertices.capacity() * 10 > size * 7) {
+				size *= 2;
+			}
+			slots.assign(size, -1);
+		}
+
+		int add(const Vector3f &position) {
+			if ((vertices.size() + 1) * 10 > slots.size() * 7) {
+				grow();
+			}
+			const size_t mask = slots.size() - 1;
+			for (size_t slot = hash(position) & mask;; slot = (slot + 1) & mask) {
+				const int index = slots[slot];
+				if (index < 0) {
+					slots[slot] = static_cast<int>(vertices.size());
+					vertices.push_back(position);
+					return slots[slot];
+				}
+				const Vector3f &vertex = vertices[index];
+				if (vertex.x == position.x && vertex.y == position.y && vertex.z == position.z) {
+					return index;
+				}
+			}
+		}
+
+	private:
+		std::vector<Vector3f> &vertices;
+		std::vector<int> slots;
+
+		static size_t hash(const Vector3f &position) {
+			// adding 0 turns -0 into 0, which compares equal
+			const float coordinates[3] = { position.x + 0.0f, position.y + 0.0f, position.z + 0.0f };
+			uint32_t bits[3];
+			std::memcpy(bits, coordinates, sizeof(bits));
+			uint32_t h = bits[0] * 73856093u ^ bits[1] * 19349663u ^ bits[2] * 83492791u;
+			h ^= h >> 16;
+			h *= 0x85EBCA6Bu;
+			h ^= h >> 13;
+			return h;
+		}
+
+		void grow() {
+			slots.assign(slots.size() * 2, -1);
+			const size_t mask = slots.size() - 1;
+			for (size_t i = 0; i < vertices.size(); i++) {
+				size_t slot = hash(vertices[i]) & mask;
+				while (slots[slot] >= 0) {
+					slot = (slot + 1) & mask;
+				}
+				slots[slot] = static_cast<int>(i);
+			}
+		}
+	};
+
+	FaceVector face(int a, int b, int c) {
+		FaceVector triangle = { { Vector3i(a, 0, a), Vector3i(b, 0, b), Vector3i(c, 0, c) } };
+		return triangle;
+	}
+
+	// normalizes summed normals, or sums the area weighted normals of the faces first
+	void finishNormals(const std::vector<Vector3f> &vertices, const std::vector<FaceVector> &faces, std::vector<Vector3f> &normals) {
+		if (normals.empty()) {
+			normals.assign(vertices.size(), Vector3f(0.0f, 0.0f, 0.0f));
+			for (const FaceVector &face : faces) {
+				const Vector3f &a = vertices[face[0].x];
+				const Vector3f normal = (vertices[face[1].x] - a).cross(vertices[face[2].x] - a);
+				for (int j = 0; j < 3; j++) {
+					normals[face[j].x] = normals[face[j].x] + normal;
+				}
+			}
+		}
+		for (Vector3f &normal : normals) {
+			const float length = std::sqrt(normal.x * normal.x + normal.y * normal.y + normal.z * normal.z);
+			normal = length > 0.0f ? normal * (1.0f / length) : Vector3f(0.0f, 0.0f, 1.0f);
+		}
+	}
+
+	enum class PlyType : int { NONE = 0, INT8, UINT8, INT16, UINT16, INT32, UINT32, FLOAT32, FLOAT64 };
+
+	PlyType plyType(const std::string &name) {
+		if (name == "char" || name == "int8") return PlyType::INT8;
+		if (name == "uchar" || name == "uint8") return PlyType::UINT8;
+		if (name == "short" || name == "int16") return PlyType::INT16;
+		if (name == "ushort" || name == "uint16") return PlyType::UINT16;
+		if (name == "int" || name == "int32") return PlyType::INT32;
+		if (name == "uint" || name == "uint32") return PlyType::UINT32;
+		if (name == "float" || name == "float32") return PlyType::FLOAT32;
+		if (name == "double" || name == "float64") return PlyType::FLOAT64;
+		return PlyType::NONE;
+	}
+
+	int plyTypeSize(PlyType type) {
+		switch (type) {
+			case PlyType::INT8: case PlyType::UINT8: return 1;
+			case PlyType::INT16: case PlyType::UINT16: return 2;
+			case PlyType::FLOAT64: return 8;
+			default: return 4;
+		}
+	}
+
+	struct PlyProperty {
+		std::string name;
+		PlyType type;
+		// type of the count of list properties, NONE for single values
+		PlyType countType;
+	};
+
+	struct PlyElement {
+		std::string name;
+		uint64_t count;
+		std::vector<PlyProperty> properties;
+	};
+
+	// bytes of the smallest record of the element, lists may be empty
+	uint64_t plyRecordSize(const PlyElement &element) {
+		uint64_t size = 0;
+		for (const PlyProperty &property : element.properties) {
+			size += plyTypeSize(property.countType == PlyType::NONE ? property.type : property.countType);
+		}
+		return size;
+	}
+
+	bool readPlyValue(ChunkReader &reader, PlyType type, bool bigEndian, double &value) {
+		unsigned char bytes[8];
+		const int size = plyTypeSize(type);
+		if (!reader.read(bytes, size)) {
+			return false;
+		}
+		if (bigEndian) {
+			std::reverse(bytes, bytes + size);
+		}
+		switch (type) {
+			case PlyType::INT8: value = static_cast<signed char>(bytes[0]); break;
+			case PlyType::UINT8: value = bytes[0]; break;
+			case PlyType::INT16: { int16_t v; std::memcpy(&v, bytes, 2); value = v; break; }
+			case PlyType::UINT16: { uint16_t v; std::memcpy(&v, bytes, 2); value = v; break; }
+			case PlyType::INT32: { int32_t v; std::memcpy(&v, bytes, 4); value = v; break; }
+			case PlyType::UINT32: { uint32_t v; std::memcpy(&v, bytes, 4); value = v; break; }
+			case PlyType::FLOAT32: { float v; std::memcpy(&v, bytes, 4); value = v; break; }
+			case PlyType::FLOAT64: { double v; std::memcpy(&v, bytes, 8); value = v; break; }
+			default: return false;
+		}
+		return true;
+	}
+
+	bool readPlyHeader(ChunkReader &reader, std::vector<PlyElement> &elements, bool &bigEndian) {
+		std::string line;
+		if (!reader.readLine(line) || line != "ply") {
+			return false;
+		}
+		bool binary = false;
+		while (reader.readLine(line)) {
+			std::vector<std::string> words;
+			for (size_t start = 0, end; start < line.size(); start = end + 1) {
+				end = line.find(' ', start);
+				end = end == std::string::npos ? line.size() : end;
+				if (end > start) {
+					words.push_back(line.substr(start, end - start));
+				}
+			}
+			if (words.empty()) {
+				continue;
+			}
+
+			if (words[0] == "end_header") {
+				return binary;
+			} else if (words[0] == "format" && words.size() > 1) {
+				binary = words[1] == "binary_little_endian" || words[1] == "binary_big_endian";
+				bigEndian = words[1] == "binary_big_endian";
+			} else if (words[0] == "element" && words.size() > 2) {
+				PlyElement element = { words[1], std::strtoull(words[2].c_str(), nullptr, 10), {} };
+				elements.push_back(element);
+			} else if (words[0] == "property" && !elements.empty()) {
+				PlyProperty property;
+				if (words.size() > 4 && words[1] == "list") {
+					property = { words[4], plyType(words[3]), plyType(words[2]) };
+				} else if (words.size() > 2) {
+					property = { words[2], plyType(words[1]), PlyType::NONE };
+				} else {
+					return false;
+				}
+				if (property.type == PlyType::NONE || (words[1] == "list" && property.countType == PlyType::NONE)) {
+					return false;
+				}
+				elements.back().properties.push_back(property);
+			}
+		}
+		return false;
+	}
+}
+
+namespace ScanFile {
+
+	bool loadStl(const std::string &path, std::vector<Vector3f> &vertices, std::vector<Vector3f> &normals, std::vector<FaceVector> &faces, const ProgressCallback &progress) {
+		vertices.clear();
+		normals.clear();
+		faces.clear();
+		ChunkReader reader(path, progress, vertices, faces);
+
+		// 80 byte header, the triangle count and 50 bytes per triangle
+		char header[80];
+		uint32_t count;
+		if (!reader.isOpen() || !reader.read(header, sizeof(header)) || !reader.read(&count, sizeof(count)) || reader.size() != 84 + 50ull * count) {
+			return false;
+		}
+
+		// closed scans have about half as many vertices as triangles
+		faces.reserve(count);
+		vertices.reserve(count / 2 + 3);
+		VertexWelder welder(vertices);
+		unsigned char triangle[50];
+		for (uint32_t i = 0; i < count; i++) {
+			if (!reader.read(triangle, sizeof(triangle))) {
+				return false;
+			}
+			// the facet normal comes first, it is often left empty so normals are recomputed
+			int indices[3];
+			for (int j = 0; j < 3; j++) {
+				float position[3];
+				std::memcpy(position, triangle + 12 + j * 12, sizeof(position));
+				indices[j] = welder.add(Vector3f(position[0], position[1], position[2]));
+			}
+			faces.push_back(face(indices[0], indices[1], indices[2]));
+		}
+
+		finishNormals(vertices, faces, normals);
+		reader.report();
+		return true;
+	}
+
+	bool loadPly(const std::string &path, std::vector<Vector3f> &vertices, std::vector<Vector3f> &normals, std::vector<FaceVector> &faces, const ProgressCallback &progress) {
+		vertices.clear();
+		normals.clear();
+		faces.clear();
+		ChunkReader reader(path, progress, vertices, faces);
+
+		std::vector<PlyElement> elements;
+		bool bigEndian = false;
+		if (!reader.isOpen() || !readPlyHeader(reader, elements, bigEndian)) {
+			return false;
+		}
+
+		// welded index of every vertex of the file
+		std::vector<int> remap;
+		std::vector<Vector3f> fileNormals;
+		VertexWelder welder(vertices);
+		std::vector<int> polygon;
+		for (const PlyElement &element : elements) {
+			const bool vertexElement = element.name == "vertex";
+			const bool faceElement = element.name == "face";
+			// a count that can't fit in the file is corrupt, and would make the
+			// reservations below throw
+			if (element.count > reader.size() / std::max<uint64_t>(plyRecordSize(element), 1)) {
+				return false;
+			}
+			if (vertexElement) {
+				remap.reserve(static_cast<size_t>(element.count));
+			} else if (faceElement) {
+				faces.reserve(static_cast<size_t>(element.count));
+			}
+
+			// slots of the values of x, y, z, nx, ny and nz
+			static const char *const attributes[6] = { "x", "y", "z", "nx", "ny", "nz" };
+			int slots[6] = { -1, -1, -1, -1, -1, -1 };
+			for (size_t p = 0; p < element.properties.size(); p++) {
+				for (int a = 0; a < 6; a++) {
+					if (element.properties[p].name == attributes[a]) {
+						slots[a] = static_cast<int>(p);
+					}
+				}
+			}
+			const bool hasNormals = vertexElement && slots[3] >= 0 && slots[4] >= 0 && slots[5] >= 0;
+			if (vertexElement && (slots[0] < 0 || slots[1] < 0 || slots[2] < 0)) {
+				return false;
+			}
+			if (hasNormals) {
+				fileNormals.reserve(static_cast<size_t>(element.count));
+			}
+
+			double values[6] = {};
+			for (uint64_t i = 0; i < element.count; i++) {
+				for (size_t p = 0; p < element.properties.size(); p++) {
+					const PlyProperty &property = element.properties[p];
+					double value;
+					if (property.countType == PlyType::NONE) {
+						if (!readPlyValue(reader, property.type, bigEndian, value)) {
+							return false;
+						}
+						for (int a = 0; a < 6; a++) {
+							values[a] = slots[a] == static_cast<int>(p) ? value : values[a];
+						}
+						continue;
+					}
+
+					double count;
+					if (!readPlyValue(reader, property.countType, bigEndian, count)) {
+						return false;
+					}
+					const bool indices = faceElement && (property.name == "vertex_indices" || property.name == "vertex_index");
+					polygon.clear();
+					for (int j = 0; j < static_cast<int>(count); j++) {
+						if (!readPlyValue(reader, property.type, bigEndian, value)) {
+							return false;
+						}
+						if (indices) {
+							if (value < 0.0 || value >= remap.size()) {
+								return false;
+							}
+							polygon.push_back(remap[static_cast<size_t>(value)]);
+						}
+					}
+					// fan around the first corner
+					for (size_t j = 2; j < polygon.size(); j++) {
+						faces.push_back(face(polygon[0], polygon[j - 1], polygon[j]));
+					}
+				}
+
+				if (vertexElement) {
+					const int index = welder.add(Vector3f(static_cast<float>(values[0]), static_cast<float>(values[1]), static_cast<float>(values[2])));
+					remap.push_back(index);
+					if (hasNormals) {
+						fileNormals.resize(vertices.size(), Vector3f(0.0f, 0.0f, 0.0f));
+						fileNormals[index] = fileNormals[index] + Vector3f(static_cast<float>(values[3]), static_cast<float>(values[4]), static_cast<float>(values[5]));
+					}
+				}
+			}
+		}
+
+		normals.swap(fileNormals);
+		finishNormals(vertices, faces, normals);
+		reader.report();
+		return true;
+	}
+}
\ No newline at end of file
@@ -0,0 +1,31 @@
+#pragma once
+
+#include <cstdint>
+#include <functional>
+#include <string>
+#include <vector>
+#include "ObjFile.h"
+
+// Streaming readers of binary STL and PLY files, the formats of 3D scans. Files are
+// read in fixed size chunks and vertices with the same position are welded through a
+// hash table as they arrive, so memory stays close to the size of the welded mesh.
+// Faces use the same index for the position and the normal and texture coordinate 0.
+// Normals are the average of the ones in the file for the welded vertices, or
+// computed from the faces around every vertex when there are none.
+namespace ScanFile {
+
+	struct Progress {
+		uint64_t bytesRead;
+		uint64_t totalBytes;
+		size_t vertices;
+		size_t faces;
+		double seconds;
+	};
+
+	// called after every chunk and once the file is read
+	using ProgressCallback = std::function<void(const Progress&)>;
+
+	// false when the file can't be read or isn't a binary file of the format
+	bool loadStl(const std::string &path, std::vector<Vector3f> &vertices, std::vector<Vector3f> &normals, std::vector<FaceVector> &faces, const ProgressCallback &progress = nullptr);
+	bool loadPly(const std::string &path, std::vector<Vector3f> &vertices, std::vector<Vector3f> &normals, std::vector<FaceVector> &faces, const ProgressCallback &progress = nullptr);
+}
\ No newline at end of file
@@ -0,0 +1,224 @@
+#include "Texture.h"
+#include "BlockCompression.h"
+#include "JobSystem.h"
+
+#include <cmath>
+#include <atomic>
+#include <cassert>
+#include <algorithm>
+
+namespace {
+	// every level down to 1x1, each one a 2x2 box filter of the previous one
+	void buildMipChain(const byte *data, int width, int height, std::vector<byte> &texels, std::vector<MipLevel> &levels) {
+		size_t size = 0;
+		for (int w = width, h = height;; w = std::max(1, w / 2), h = std::max(1, h / 2)) {
+			levels.push_back({ w, h, w * 4, static_cast<int>(size), w * 256.0f, h * 256.0f });
+			size += w * h * 4;
+			if (w == 1 && h == 1) {
+				break;
+			}
+		}
+		texels.resize(size);
+		std::copy(data, data + width * height * 4, texels.begin());
+
+		for (size_t i = 1; i < levels.size(); i++) {
+			const MipLevel &source = levels[i - 1];
+			const MipLevel &level = levels[i];
+			const byte *sourceData = texels.data() + source.offset;
+			byte *levelData = texels.data() + level.offset;
+
+			for (int y = 0; y < level.height; y++) {
+				const byte *row0 = sourceData + (y * 2) * source.pitch;
+				const byte *row1 = sourceData + std::min(y * 2 + 1, source.height - 1) * source.pitch;
+				for (int x = 0; x < level.width; x++) {
+					const int x0 = (x * 2) * 4;
+					const int x1 = std::min(x * 2 + 1, source.width - 1) * 4;
+					for (int c = 0; c < 4; c++) {
+						levelData[y * level.pitch + x * 4 + c] = (row0[x0 + c] + row0[x1 + c] + row1[x0 + c] + row1[x1 + c] + 2) / 4;
+					}
+				}
+			}
+		}
+	}
+
+	// moves the texels of a linear texture into blocks of 4x4 texels,
+	// every level padded to whole blocks, the padding is never addressed
+	void tile(Texture &texture) {
+		std::vector<MipLevel> tiledLevels = texture.levels;
+		size_t size = 0;
+		for (MipLevel &level : tiledLevels) {
+			level.pitch = ((level.width + 3) / 4) * (16 << texture.texelShift);
+			level.offset = static_cast<int>(size);
+			size += ((level.height + 3) / 4) * level.pitch;
+		}
+
+		Texture tiled;
+		tiled.texels.resize(size);
+		tiled.levels.swap(tiledLevels);
+		tiled.layout = TextureLayout::TILED;
+		tiled.texelShift = texture.texelShift;
+		tiled.topDown = texture.topDown;
+		tiled.id = Texture::createId();
+		for (size_t i = 0; i < texture.levels.size(); i++) {
+			const MipLevel &source = texture.levels[i];
+			for (int y = 0; y < source.height; y++) {
+				for (int x = 0; x < source.width; x++) {
+					const byte *texel = texture.data() + texture.texelOffset(source, x, y);
+					std::copy(texel, texel + texture.texelSize(), tiled.texels.begin() + tiled.texelOffset(tiled.levels[i], x, y));
+				}
+			}
+		}
+		std::swap(texture, tiled);
+	}
+}
+
+void Texture::create(const byte *data, int width, int height, TextureLayout textureLayout) {
+	texels.clear();
+	mappedTexels = nullptr;
+	mapping.reset();
+	levels.clear();
+	layout = TextureLayout::LINEAR;
+	format = TextureFormat::RGBA8;
+	texelShift = 2;
+	topDown = false;
+	id = createId();
+	buildMipChain(data, width, height, texels, levels);
+
+	if (textureLayout == TextureLayout::TILED) {
+		tile(*this);
+	}
+}
+
+void Texture::createMaterial(const Texture &diffuse, const Texture &normalMap, const Texture &specularMap) {
+	assert(!diffuse.empty() && diffuse.format == TextureFormat::RGBA8 && diffuse.texelShift == 2);
+	assert(normalMap.format == TextureFormat::RGBA8 && specularMap.format == TextureFormat::RGBA8);
+	assert(diffuse.levels.size() == normalMap.levels.size() && diffuse.levels.size() == specularMap.levels.size());
+	assert(diffuse.levels[0].width == normalMap.levels[0].width && diffuse.levels[0].height == normalMap.levels[0].height);
+	assert(diffuse.levels[0].width == specularMap.levels[0].width && diffuse.levels[0].height == specularMap.levels[0].height);
+
+	texels.clear();
+	mappedTexels = nullptr;
+	mapping.reset();
+	levels.clear();
+	layout = TextureLayout::LINEAR;
+	format = TextureFormat::RGBA8;
+	texelShift = 3;
+	topDown = diffuse.topDown;
+	id = createId();
+
+	size_t size = 0;
+	for (const MipLevel &source : diffuse.levels) {
+		MipLevel level = source;
+		level.pitch = level.width * MATERIAL_CHANNELS;
+		level.offset = static_cast<int>(size);
+		size += level.height * level.pitch;
+		levels.push_back(level);
+	}
+	texels.resize(size);
+
+	for (size_t i = 0; i < levels.size(); i++) {
+		const MipLevel &level = levels[i];
+		for (int y = 0; y < level.height; y++) {
+			for (int x = 0; x < level.width; x++) {
+				const byte *colour = diffuse.data() + diffuse.texelOffset(diffuse.levels[i], x, y);
+				const byte *normal = normalMap.data() + normalMap.texelOffset(normalMap.levels[i], x, y);
+				const byte *specular = specularMap.data() + specularMap.texelOffset(specularMap.levels[i], x, y);
+
+				byte *texel = texels.data() + texelOffset(level, x, y);
+				std::copy(colour, colour + 4, texel + MATERIAL_RED);
+				texel[MATERIAL_SPECULAR] = specular[0];
+				Vector3f n;
+				for (int c = 0; c < 3; c++) {
+					n[c] = ((normal[c] / 255.f) * 2.0f) - 1.f;
+				}
+				encodeOctahedral(n, texel[MATERIAL_NORMAL_X], texel[MATERIAL_NORMAL_Y]);
+				texel[MATERIAL_CHANNELS - 1] = 0;
+			}
+		}
+	}
+
+	if (diffuse.layout == TextureLayout::TILED) {
+		tile(*this);
+	}
+}
+
+void Texture::compress(TextureFormat compressedFormat) {
+	assert(format == TextureFormat::RGBA8 && texelShift == 2 && compressedFormat != TextureFormat::RGBA8);
+
+	Texture compressed;
+	compressed.format = compressedFormat;
+	compressed.topDown = topDown;
+	compressed.id = createId();
+	size_t size = 0;
+	for (const MipLevel &source : levels) {
+		MipLevel level = source;
+		level.pitch = ((level.width + 3) / 4) * compressed.blockSize();
+		level.offset = static_cast<int>(size);
+		size += ((level.height + 3) / 4) * level.pitch;
+		compressed.levels.push_back(level);
+	}
+	compressed.texels.resize(size);
+
+	// Blocks past the edges of a level repeat its last row and column. Rows of blocks
+	// are encoded in parallel, each writes its own blocks.
+	for (size_t i = 0; i < levels.size(); i++) {
+		const MipLevel &source = levels[i];
+		const MipLevel &level = compressed.levels[i];
+		JobSystem::shared().parallelFor(0, (level.height + 3) / 4, 4, [&](size_t firstRow, size_t lastRow) {
+			byte block[64];
+			for (int y = static_cast<int>(firstRow) * 4; y < static_cast<int>(lastRow) * 4; y += 4) {
+				for (int x = 0; x < level.width; x += 4) {
+					for (int texel = 0; texel < 16; texel++) {
+						const int texelX = std::min(x + (texel & 3), source.width - 1);
+						const int texelY = std::min(y + (texel >> 2), source.height - 1);
+						const byte *rgba = data() + texelOffset(source, texelX, texelY);
+						std::copy(rgba, rgba + 4, block + texel * 4);
+					}
+					BlockCompression::encodeBlock(compressedFormat, block, compressed.texels.data() + compressed.blockOffset(level, x, y));
+				}
+			}
+		});
+	}
+	std::swap(*this, compressed);
+}
+
+void Texture::flipRows(byte *data, int width, int height) {
+	const size_t pitch = static_cast<size_t>(width) * 4;
+	for (int y = 0; y < height / 2; y++) {
+		byte *row = data + y * pitch;
+		std::swap_ranges(row, row + pitch, data + (height - 1 - y) * pitch);
+	}
+}
+
+unsigned int Texture::createId() {
+	static std::atomic<unsigned int> nextId(1);
+	return nextId++;
+}
+
+// The unit sphere is projected on the octahedron |x| + |y| + |z| = 1, and the lower
+// half of the octahedron is folded over the upper half into the [-1, 1] square.
+void Texture::encodeOctahedral(const Vector3f &normal, byte &x, byte &y) {
+	const float length = std::fabs(normal.x) + std::fabs(normal.y) + std::fabs(normal.z);
+	float u = 0.0f, v = 0.0f;
+	if (length > 0.0f) {
+		u = normal.x / length;
+		v = normal.y / length;
+		if (normal.z < 0.0f) {
+			const float foldedU = (1.0f - std::fabs(v)) * (u >= 0.0f ? 1.0f : -1.0f);
+			const float foldedV = (1.0f - std::fabs(u)) * (v >= 0.0f ? 1.0f : -1.0f);
+			u = foldedU;
+			v = foldedV;
+		}
+	}
+	x = static_cast<byte>(std::floor((u * 0.5f + 0.5f) * 255.0f + 0.5f));
+	y = static_cast<byte>(std::floor((v * 0.5f + 0.5f) * 255.0f + 0.5f));
+}
+
+Vector3f Texture::decodeOctahedral(byte x, byte y) {
+	Vector3f normal((x / 255.0f) * 2.0f - 1.0f, (y / 255.0f) * 2.0f - 1.0f, 0.0f);
+	normal.z = 1.0f - std::fabs(normal.x) - std::fabs(normal.y);
+	const float fold = std::max(-normal.z, 0.0f);
+	normal.x += normal.x >= 0.0f ? -fold : fold;
+	normal.y += normal.y >= 0.0f ? -fold : fold;
+	return normal.normalize();
+}
\ No newline at end of file
@@ -0,0 +1,112 @@
+#pragma once
+
+#include <memory>
+#include <vector>
+#include "../types/Types.h"
+#include "../types/Vector3.h"
+
+class MappedFile;
+
+// Memory layout of the texels of a texture. TILED stores them in blocks of 4x4
+// texels, 64 bytes or one cache line each, so texels close in uv space are also
+// close in memory whatever the direction a triangle walks the texture in.
+enum class TextureLayout : int {
+	LINEAR = 0,
+	TILED
+};
+
+// Storage of the texels. Block compressed formats store 4x4 texels per block and
+// decode to RGBA8 in the sampler.
+enum class TextureFormat : int {
+	RGBA8 = 0,
+	// 8 byte blocks, two RGB565 endpoints and 2 bit indices, 1 bit alpha
+	BC1,
+	// 16 byte blocks, a BC4 block for alpha followed by a BC1 block for colour
+	BC3,
+	// 8 byte blocks, one channel with two endpoints and 3 bit indices
+	BC4,
+	// 16 byte blocks, BC4 blocks for x and y of a normal, z is rebuilt when decoding
+	BC5
+};
+
+struct MipLevel {
+	int width;
+	int height;
+	// bytes per row of texels, or per row of blocks in the tiled layout and compressed formats
+	int pitch;
+	// bytes from the start of the texels of the texture, one base pointer addresses every level
+	int offset;
+	// texture coordinates to 24.8 fixed point texel coordinates
+	float scaleU;
+	float scaleV;
+};
+
+// Bytes of the 8 byte texels of a packed material
+enum MaterialChannel : int {
+	MATERIAL_RED = 0,
+	MATERIAL_GREEN,
+	MATERIAL_BLUE,
+	MATERIAL_ALPHA,
+	MATERIAL_SPECULAR,
+	// tangent space normal in octahedral encoding, [-1, 1] mapped to [0, 255]
+	MATERIAL_NORMAL_X,
+	MATERIAL_NORMAL_Y,
+	MATERIAL_CHANNELS = 8
+};
+
+// Texture with its full mip chain. Texels are RGBA8, 8 bytes for a packed material,
+// or compressed blocks.
+struct Texture {
+	std::vector<byte> texels;
+	// texels read in place from a mapped asset pack instead of texels, see AssetPack
+	const byte *mappedTexels = nullptr;
+	std::shared_ptr<const MappedFile> mapping;
+	std::vector<MipLevel> levels;
+	TextureLayout layout = TextureLayout::LINEAR;
+	TextureFormat format = TextureFormat::RGBA8;
+	// log2 of the bytes per texel of uncompressed formats
+	int texelShift = 2;
+	// rows stored from the top of the image down, as DDS files do, the sampler mirrors v
+	bool topDown = false;
+	// identifies the contents for the decoded block cache of the sampler
+	unsigned int id = 0;
+
+	// copies an RGBA8 image and builds its mip chain in the given layout
+	void create(const byte *data, int width, int height, TextureLayout layout);
+	// interleaves three RGBA8 textures of the same size into a packed material,
+	// every mip level is packed from the matching levels of the sources
+	void createMaterial(const Texture &diffuse, const Texture &normalMap, const Texture &specularMap);
+	// compresses every level of an RGBA8 texture into blocks of the given format
+	void compress(TextureFormat compressedFormat);
+	bool empty() const { return levels.empty(); }
+	const byte* data() const { return mappedTexels != nullptr ? mappedTexels : texels.data(); }
+	int texelSize() const { return 1 << texelShift; }
+	bool compressed() const { return format != TextureFormat::RGBA8; }
+	// bytes per 4x4 block of compressed formats
+	int blockSize() const { return format == TextureFormat::BC1 || format == TextureFormat::BC4 ? 8 : 16; }
+
+	// byte offset of the block holding texel (x, y) of a level of a compressed texture
+	int blockOffset(const MipLevel &level, int x, int y) const {
+		return level.offset + (y >> 2) * level.pitch + (x >> 2) * blockSize();
+	}
+
+	// byte offset of texel (x, y) of a level from the start of texels
+	int texelOffset(const MipLevel &level, int x, int y) const {
+		if (layout == TextureLayout::TILED) {
+			return level.offset + (y >> 2) * level.pitch + (((y & 3) * 4 + (x >> 2) * 16 + (x & 3)) << texelShift);
+		}
+		return level.offset + y * level.pitch + (x << texelShift);
+	}
+
+	// octahedral encoding of a unit vector, as stored in a packed material
+	static void encodeOctahedral(const Vector3f &normal, byte &x, byte &y);
+	static Vector3f decodeOctahedral(byte x, byte y);
+
+	// new value for id, every time the texels change
+	static unsigned int createId();
+
+	// Mirrors an RGBA8 image vertically. Images are decoded from the top row down and
+	// textures store the bottom row first. Unlike the global flag of stb_image it is
+	// safe to decode images on several threads.
+	static void flipRows(byte *data, int width, int height);
+};
\ No newline at end of file
@@ -0,0 +1,53 @@
+#include "VertexKernels.h"
+
+#include "CpuDispatch.h"
+#include "JobSystem.h"
+
+namespace {
+	// vertices per job, enough to hide the cost of queueing it
+	const size_t VERTICES_PER_JOB = 8192;
+
+	// runs kernel(begin, count) over [0, count) on the job system
+	template <typename Kernel>
+	void forEachRange(size_t count, const Kernel &kernel) {
+		JobSystem::shared().parallelFor(0, count, VERTICES_PER_JOB, [&kernel](size_t begin, size_t end) {
+			kernel(begin, end - begin);
+		});
+	}
+}
+
+void VertexKernels::transformPoints(const Matrix4f &matrix, const Vector3f *points, size_t count, float *outX, float *outY, float *outZ) {
+	forEachRange(count, [&](size_t begin, size_t size) {
+		CpuDispatch::kernels().transformPoints(matrix, points + begin, size, outX + begin, outY + begin, outZ + begin);
+	});
+}
+
+void VertexKernels::transformPoints(const Matrix4f &matrix, const QuantizedPosition *points, size_t count, float *outX, float *outY, float *outZ) {
+	forEachRange(count, [&](size_t begin, size_t size) {
+		CpuDispatch::kernels().transformQuantizedPoints(matrix, points + begin, size, outX + begin, outY + begin, outZ + begin);
+	});
+}
+
+void VertexKernels::transformPoints(const Matrix4f &matrix, const OctahedralNormal *points, size_t count, float *outX, float *outY, float *outZ) {
+	forEachRange(count, [&](size_t begin, size_t size) {
+		CpuDispatch::kernels().transformOctahedralPoints(matrix, points + begin, size, outX + begin, outY + begin, outZ + begin);
+	});
+}
+
+void VertexKernels::transformDirections(const Matrix4f &matrix, const Vector3f *directions, size_t count, float *outX, float *outY, float *outZ) {
+	forEachRange(count, [&](size_t begin, size_t size) {
+		CpuDispatch::kernels().transformDirections(matrix, directions + begin, size, outX + begin, outY + begin, outZ + begin);
+	});
+}
+
+void VertexKernels::lightIntensities(const Vector3f *normals, size_t count, const Vector3f &lightDirection, float *out) {
+	forEachRange(count, [&](size_t begin, size_t size) {
+		CpuDispatch::kernels().lightIntensities(normals + begin, size, lightDirection, out + begin);
+	});
+}
+
+void VertexKernels::lightIntensities(const OctahedralNormal *normals, size_t count, const Vector3f &lightDirection, float *out) {
+	forEachRange(count, [&](size_t begin, size_t size) {
+		CpuDispatch::kernels().octahedralLightIntensities(normals + begin, size, lightDirection, out + begin);
+	});
+}
\ No newline at end of file
@@ -0,0 +1,29 @@
+#pragma once
+
+#include <cstddef>
+
+#include "../types/Vector3.h"
+#include "../types/Matrix.h"
+#include "../types/VertexFormat.h"
+
+// Stream kernels used by the batch vertex stage. They walk contiguous streams of
+// vertices eight at a time and write their results as structure of arrays, with the
+// kernels of the instruction set picked by CpuDispatch. Long streams are split in
+// ranges run on the job system.
+namespace VertexKernels {
+
+	// transforms the points (x, y, z, 1) by matrix and applies the perspective divide
+	void transformPoints(const Matrix4f &matrix, const Vector3f *points, size_t count, float *outX, float *outY, float *outZ);
+	// Versions that decode the compact attributes of VertexFormat::QUANTIZED as they load
+	// them. Positions are in quantized units, matrix has to include the scale to the bounds
+	// (see Mesh::getDequantizationMatrix). Normals are unit length once decoded.
+	void transformPoints(const Matrix4f &matrix, const QuantizedPosition *points, size_t count, float *outX, float *outY, float *outZ);
+	void transformPoints(const Matrix4f &matrix, const OctahedralNormal *points, size_t count, float *outX, float *outY, float *outZ);
+
+	// transforms the directions (x, y, z, 0) by the upper 3x3 part of matrix
+	void transformDirections(const Matrix4f &matrix, const Vector3f *directions, size_t count, float *outX, float *outY, float *outZ);
+
+	// normalizes every normal and writes its dot product with the light direction
+	void lightIntensities(const Vector3f *normals, size_t count, const Vector3f &lightDirection, float *out);
+	void lightIntensities(const OctahedralNormal *normals, size_t count, const Vector3f &lightDirection, float *out);
+}
\ No newline at end of file
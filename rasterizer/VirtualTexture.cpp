@@ -0,0 +1,288 @@
+#include "VirtualTexture.h"
+#include "Texture.h"
+
+#include <cmath>
+#include <cassert>
+#include <cstring>
+#include <algorithm>
+#include <limits>
+
+#include "stb_image.h"
+
+namespace {
+	const char MAGIC[4] = { 'V', 'T', 'E', 'X' };
+	// magic, width, height, page size and level count
+	const int HEADER_SIZE = 20;
+
+	int pageShiftOf(int value) {
+		int shift = 0;
+		while ((1 << shift) < value) {
+			shift++;
+		}
+		return shift;
+	}
+}
+
+bool VirtualTexture::createTileFile(const std::string &imagePath, const std::string &tileFilePath, int pageSize) {
+	assert(pageSize > 0 && (pageSize & (pageSize - 1)) == 0);
+	int width, height, format;
+	byte *data = stbi_load(imagePath.c_str(), &width, &height, &format, STBI_rgb_alpha);
+	if (data == nullptr) {
+		return false;
+	}
+	Texture::flipRows(data, width, height);
+	Texture texture;
+	texture.create(data, width, height, TextureLayout::LINEAR);
+	stbi_image_free(data);
+
+	std::ofstream out(tileFilePath, std::ofstream::out | std::ofstream::binary);
+	if (!out.is_open()) {
+		return false;
+	}
+	const int header[4] = { width, height, pageSize, static_cast<int>(texture.levels.size()) };
+	out.write(MAGIC, sizeof(MAGIC));
+	out.write(reinterpret_cast<const char*>(header), sizeof(header));
+
+	// pages in level order, texels past the edges of a level repeat its last row and column
+	std::vector<byte> page(pageSize * pageSize * 4);
+	for (const MipLevel &level : texture.levels) {
+		for (int pageY = 0; pageY < level.height; pageY += pageSize) {
+			for (int pageX = 0; pageX < level.width; pageX += pageSize) {
+				for (int y = 0; y < pageSize; y++) {
+					for (int x = 0; x < pageSize; x++) {
+						const int texelX = std::min(pageX + x, level.width - 1);
+						const int texelY = std::min(pageY + y, level.height - 1);
+						const byte *texel = texture.texels.data() + texture.texelOffset(level, texelX, texelY);
+						std::copy(texel, texel + 4, page.begin() + (y * pageSize + x) * 4);
+					}
+				}
+				out.write(reinterpret_cast<const char*>(page.data()), page.size());
+			}
+		}
+	}
+	return out.good();
+}
+
+VirtualTexture::VirtualTexture(const std::string &path, int residentPages)
+	: pageSize(0), pageShift(0), pageBytes(0), file(path, std::ifstream::in | std::ifstream::binary), pagesOffset(HEADER_SIZE), frame(0), pinnedSlots(0) {
+	assert(residentPages > 0);
+	char magic[4];
+	int header[4];
+	file.read(magic, sizeof(magic));
+	file.read(reinterpret_cast<char*>(header), sizeof(header));
+	if (!file || std::memcmp(magic, MAGIC, sizeof(MAGIC)) != 0) {
+		return;
+	}
+
+	// the page size has to be a power of two for the shifts and masks of the lookups
+	const int width = header[0], height = header[1];
+	if (width <= 0 || height <= 0 || header[2] <= 0 || (header[2] & (header[2] - 1)) != 0) {
+		return;
+	}
+	file.seekg(0, std::ifstream::end);
+	const uint64_t pageFileBytes = static_cast<uint64_t>(file.tellg()) - HEADER_SIZE;
+	const int shift = pageShiftOf(header[2]);
+	const uint64_t bytesPerPage = static_cast<uint64_t>(header[2]) * header[2] * 4;
+
+	// same chain as Texture::create, every page has to be in the file
+	std::vector<Level> chain;
+	uint64_t pageCount = 0;
+	for (int levelWidth = width, levelHeight = height;; levelWidth = std::max(1, levelWidth / 2), levelHeight = std::max(1, levelHeight / 2)) {
+		const Level level = { levelWidth, levelHeight, ((levelWidth - 1) >> shift) + 1, ((levelHeight - 1) >> shift) + 1, static_cast<int>(pageCount) };
+		pageCount += static_cast<uint64_t>(level.pagesX) * level.pagesY;
+		if (pageCount > pageFileBytes / bytesPerPage || pageCount > static_cast<uint64_t>(std::numeric_limits<int>::max())) {
+			return;
+		}
+		chain.push_back(level);
+		if (levelWidth == 1 && levelHeight == 1) {
+			break;
+		}
+	}
+	if (static_cast<int>(chain.size()) != header[3]) {
+		return;
+	}
+	pageSize = header[2];
+	pageShift = shift;
+	pageBytes = static_cast<size_t>(bytesPerPage);
+	const int pages = static_cast<int>(pageCount);
+
+	pageTable.assign(pages, -1);
+	requested.reset(new std::atomic<unsigned char>[pages]);
+	for (int page = 0; page < pages; page++) {
+		requested[page].store(0);
+	}
+
+	// the mip tail stays resident, so every lookup finds a level to fall back to
+	int firstPinnedPage = pages;
+	for (const Level &level : chain) {
+		if (level.pagesX == 1 && level.pagesY == 1) {
+			firstPinnedPage = std::min(firstPinnedPage, level.firstPage);
+		}
+	}
+	pinnedSlots = pages - firstPinnedPage;
+
+	const int slotCount = pinnedSlots + residentPages;
+	slots.resize(slotCount * pageBytes);
+	slotPages.assign(slotCount, -1);
+	slotFrames.assign(slotCount, -1);
+	slotPositions.resize(slotCount, leastRecentlyUsed.end());
+	for (int slot = 0; slot < slotCount; slot++) {
+		if (slot < pinnedSlots) {
+			if (!loadPage(firstPinnedPage + slot, slot)) {
+				return;
+			}
+		} else {
+			slotPositions[slot] = leastRecentlyUsed.insert(leastRecentlyUsed.end(), slot);
+		}
+	}
+	// open only once the mip tail is in
+	levels.swap(chain);
+}
+
+int VirtualTexture::getResidentPageCount() const {
+	return static_cast<int>(std::count_if(slotPages.begin(), slotPages.end(), [](int page) { return page >= 0; }));
+}
+
+const byte* VirtualTexture::texel(int level, int x, int y) const {
+	for (;; level++, x >>= 1, y >>= 1) {
+		const Level &current = levels[level];
+		const int page = current.firstPage + (y >> pageShift) * current.pagesX + (x >> pageShift);
+		if (requested[page].load(std::memory_order_relaxed) == 0) {
+			requested[page].store(1, std::memory_order_relaxed);
+		}
+
+		const int slot = pageTable[page];
+		if (slot >= 0) {
+			const int mask = pageSize - 1;
+			return slots.data() + slot * pageBytes + ((y & mask) * pageSize + (x & mask)) * 4;
+		}
+	}
+}
+
+const byte* VirtualTexture::texel(const Sampler &sampler, const Vector3f &textureCoordinate) const {
+	assert(isOpen());
+	const Level &level = levels[0];
+	float u = textureCoordinate.x, v = textureCoordinate.y;
+	if (sampler.getWrap() == TextureWrap::REPEAT) {
+		u -= std::floor(u);
+		v -= std::floor(v);
+	}
+	int x = std::min(std::max(static_cast<int>(u * level.width), 0), level.width - 1);
+	int y = std::min(std::max(static_cast<int>(v * level.height), 0), level.height - 1);
+	return texel(0, x, y);
+}
+
+void VirtualTexture::sample(const Sampler &sampler, const Floatx8 &u, const Floatx8 &v, const Floatx8 &lod, const Floatx8 &mask, Floatx8 channels[4]) const {
+	assert(isOpen());
+	const int lastLevel = static_cast<int>(levels.size()) - 1;
+	const bool repeat = sampler.getWrap() == TextureWrap::REPEAT;
+	const bool bilinear = sampler.getFilter() != TextureFilter::NEAREST;
+
+	float us[Floatx8::LANES], vs[Floatx8::LANES], lods[Floatx8::LANES];
+	u.store(us);
+	v.store(vs);
+	(lod + Floatx8(std::log2(static_cast<float>(std::max(levels[0].width, levels[0].height))))).store(lods);
+
+	float values[4][Floatx8::LANES] = {};
+	const int bits = mask.movemask();
+	for (int i = 0; i < Floatx8::LANES; i++) {
+		if (!(bits & (1 << i))) {
+			continue;
+		}
+		const float levelOfDetail = lods[i] + 0.5f;
+		const int levelIndex = levelOfDetail > 0.0f ? std::min(static_cast<int>(levelOfDetail), lastLevel) : 0;
+		const Level &level = levels[levelIndex];
+
+		// same fixed point addressing as the sampler
+		float laneU = repeat ? us[i] - std::floor(us[i]) : std::min(std::max(us[i], 0.0f), 1.0f);
+		float laneV = repeat ? vs[i] - std::floor(vs[i]) : std::min(std::max(vs[i], 0.0f), 1.0f);
+		const int fixedU = static_cast<int>(laneU * level.width * 256.0f);
+		const int fixedV = static_cast<int>(laneV * level.height * 256.0f);
+
+		if (!bilinear) {
+			const byte *value = texel(levelIndex, std::min(fixedU >> 8, level.width - 1), std::min(fixedV >> 8, level.height - 1));
+			for (int c = 0; c < 4; c++) {
+				values[c][i] = value[c];
+			}
+			continue;
+		}
+
+		const int x = fixedU - 128, y = fixedV - 128;
+		int x0 = x >> 8, y0 = y >> 8, x1 = x0 + 1, y1 = y0 + 1;
+		const float fractionX = (x & 0xFF) / 256.0f, fractionY = (y & 0xFF) / 256.0f;
+		if (repeat) {
+			x0 = (x0 + level.width) % level.width;
+			x1 = x1 % level.width;
+			y0 = (y0 + level.height) % level.height;
+			y1 = y1 % level.height;
+		} else {
+			x0 = std::max(x0, 0);
+			x1 = std::min(x1, level.width - 1);
+			y0 = std::max(y0, 0);
+			y1 = std::min(y1, level.height - 1);
+		}
+
+		const byte *taps[4] = { texel(levelIndex, x0, y0), texel(levelIndex, x1, y0), texel(levelIndex, x0, y1), texel(levelIndex, x1, y1) };
+		for (int c = 0; c < 4; c++) {
+			const float upper = taps[0][c] + (taps[1][c] - taps[0][c]) * fractionX;
+			const float lower = taps[2][c] + (taps[3][c] - taps[2][c]) * fractionX;
+			values[c][i] = upper + (lower - upper) * fractionY;
+		}
+	}
+	for (int c = 0; c < 4; c++) {
+		channels[c] = Floatx8::load(values[c]);
+	}
+}
+
+void VirtualTexture::endFrame(int maxPageLoads) {
+	frame++;
+	std::vector<int> misses;
+	for (size_t page = 0; page < pageTable.size(); page++) {
+		if (requested[page].exchange(0, std::memory_order_relaxed) == 0) {
+			continue;
+		}
+		if (pageTable[page] >= 0) {
+			touch(pageTable[page]);
+		} else {
+			misses.push_back(static_cast<int>(page));
+		}
+	}
+
+	// pages are numbered from the base level down to the tail, load the coarser ones first
+	// so the fallbacks of the next frame get closer to the requested levels
+	std::sort(misses.begin(), misses.end(), [](int a, int b) { return a > b; });
+	for (int i = 0; i < static_cast<int>(misses.size()) && i < maxPageLoads; i++) {
+		const int slot = leastRecentlyUsed.back();
+		// every slot is in use by this frame, more loads would evict pages it needs
+		if (slotFrames[slot] == frame) {
+			break;
+		}
+		if (slotPages[slot] >= 0) {
+			pageTable[slotPages[slot]] = -1;
+		}
+		// a page that can't be read stays missing and is requested again
+		if (!loadPage(misses[i], slot)) {
+			slotPages[slot] = -1;
+		}
+		touch(slot);
+	}
+}
+
+bool VirtualTexture::loadPage(int page, int slot) {
+	file.clear();
+	file.seekg(pagesOffset + static_cast<std::streamoff>(page) * pageBytes);
+	file.read(reinterpret_cast<char*>(slots.data() + slot * pageBytes), pageBytes);
+	if (!file.good()) {
+		return false;
+	}
+	pageTable[page] = slot;
+	slotPages[slot] = page;
+	return true;
+}
+
+void VirtualTexture::touch(int slot) {
+	slotFrames[slot] = frame;
+	if (slot >= pinnedSlots) {
+		leastRecentlyUsed.splice(leastRecentlyUsed.begin(), leastRecentlyUsed, slotPositions[slot]);
+	}
+}
\ No newline at end of file
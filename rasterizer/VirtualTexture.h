@@ -0,0 +1,78 @@
+#pragma once
+
+#include <atomic>
+#include <fstream>
+#include <list>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "Sampler.h"
+#include "../types/Vector3.h"
+#include "../types/Floatx8.h"
+
+// RGBA8 texture paged in from a tile file on demand, for textures larger than the
+// memory budget. Every mip level is split into square pages. At most residentPages
+// pages are kept in memory besides the mip tail (the levels that fit in one page),
+// which is always resident. A lookup of a page that is not resident falls back to
+// the closest coarser resident level and requests the page. Requests are recorded
+// with atomics, so lookups stay const, and endFrame() loads the pages requested
+// during the frame, evicting the least recently used ones.
+class VirtualTexture {
+public:
+	// the texture isn't open when the header or the length of the file is wrong
+	VirtualTexture(const std::string &path, int residentPages);
+
+	// splits an image and its mip chain into the pages of a tile file
+	static bool createTileFile(const std::string &imagePath, const std::string &tileFilePath, int pageSize);
+
+	bool isOpen() const { return !levels.empty(); }
+	int getResidentPageCount() const;
+
+	// nearest texel of the base level, or of the closest resident level
+	const byte* texel(const Sampler &sampler, const Vector3f &textureCoordinate) const;
+
+	// eight lane lookup with the filter and wrap mode of the sampler, see Sampler::sample.
+	// Trilinear filtering is bilinear in the nearest level.
+	void sample(const Sampler &sampler, const Floatx8 &u, const Floatx8 &v, const Floatx8 &lod, const Floatx8 &mask, Floatx8 channels[4]) const;
+
+	// Loads the pages requested since the last call, coarser levels first and at most
+	// maxPageLoads of them, and refreshes the pages that were used
+	void endFrame(int maxPageLoads = 64);
+
+private:
+	struct Level {
+		int width;
+		int height;
+		int pagesX;
+		int pagesY;
+		// index of the first page of the level
+		int firstPage;
+	};
+
+	std::vector<Level> levels;
+	int pageSize;
+	int pageShift;
+	size_t pageBytes;
+	std::ifstream file;
+	std::streamoff pagesOffset;
+	int frame;
+
+	// slot holding every page, -1 when the page is not resident
+	std::vector<int> pageTable;
+	// pages used or missed since the last endFrame
+	std::unique_ptr<std::atomic<unsigned char>[]> requested;
+
+	// page memory, the mip tail first and then the slots managed by the LRU list
+	std::vector<byte> slots;
+	std::vector<int> slotPages;
+	std::vector<int> slotFrames;
+	int pinnedSlots;
+	std::list<int> leastRecentlyUsed;
+	std::vector<std::list<int>::iterator> slotPositions;
+
+	const byte* texel(int level, int x, int y) const;
+	// false when the page can't be read, it is left missing
+	bool loadPage(int page, int slot);
+	void touch(int slot);
+};
\ No newline at end of file
@@ -5,40 +5,40 @@
 
 class FaceIlluminationShader : public Shader {
 public:
-	// uniforms for the entire shader
-	Matrix4f transform;
-	Vector3f lightDirection;
-	Mesh *mesh;
 
-	Vector3f vertex(int faceIndex, int vertexIndex) override final {
+	Varyings vertex(const Uniforms &uniforms, int faceIndex, int vertexIndex) const override final {
 		// vertex position
-		const FaceVector &faces = mesh->getFace(faceIndex);
-		const Vector3f vertex = mesh->getVertex(faces[vertexIndex].x);
-		return MatrixVectorf::vectorFromHomogeneousMatrix(transform*Matrix4f::homogeneousMatrixfromVector(vertex));
+		const FaceVector &faces = uniforms.mesh->getFace(faceIndex);
+		const Vector3f vertex = uniforms.mesh->getVertex(faces[vertexIndex].x);
+		Varyings out;
+		out.position = uniforms.transform.transformPoint(vertex);
+		return out;
 	}
 
-	void geometry(int faceIndex, Vector3f vertices[3]) override final {
+	void geometry(const Uniforms &uniforms, int faceIndex, Triangle &triangle) const override final {
 		// face normal
-		Vector3f n = (vertices[1] - vertices[0]) ^ (vertices[2] - vertices[0]);
+		const Varyings *v = triangle.vertices;
+		Vector3f n = (v[1].position - v[0].position) ^ (v[2].position - v[0].position);
 		n.normalize();
-		faceIlumination = n.dot(lightDirection);
+		triangle.faceIllumination = n.dot(uniforms.lightDirection);
 
 		// diffuse texture coordinate (one per primitive)
-		const FaceVector &faces = mesh->getFace(faceIndex);
-		uv = mesh->getDiffuseTextureCoordinate(faces[0].y);
+		const FaceVector &faces = uniforms.mesh->getFace(faceIndex);
+		triangle.faceUv = uniforms.mesh->getDiffuseTextureCoordinate(faces[0].y);
 	}
 
-	RGBA fragment(const Vector3f &barycentric) override final {
-		RGBA colour = mesh->getDiffuseColor(uv);
-		colour.applyLightIntensity(faceIlumination);
+	RGBA fragment(const Uniforms &uniforms, const Triangle &triangle, const Vector3f &, const Vector2i &) const override final {
+		RGBA colour = uniforms.mesh->getDiffuseColor(triangle.faceUv);
+		colour.applyLightIntensity(triangle.faceIllumination);
 		return colour;
 	}
 
-	ShaderType getType() override final {
-		return ShaderType::FACE_ILLUMINATION;
+	// one colour for the whole face
+	void fragmentBatch(const Uniforms &uniforms, const Triangle &triangle, const FragmentBatch &, RGBA colours[FragmentBatch::SIZE]) const override final {
+		std::fill(colours, colours + FragmentBatch::SIZE, fragment(uniforms, triangle, Vector3f(), Vector2i()));
 	}
 
-private:
-	float faceIlumination;
-	Vector3f uv;
+	ShaderType getType() const override final {
+		return ShaderType::FACE_ILLUMINATION;
+	}
 };
\ No newline at end of file
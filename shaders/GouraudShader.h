@@ -4,43 +4,61 @@
 
 class GouraudShader : public Shader {
 public:
-	// uniforms for the entire shader
-	Matrix4f transform;
-	Vector3f lightDirection;
-	Mesh *mesh;
 
-	Vector3f vertex(int faceIndex, int vertexIndex) override final {
+	Varyings vertex(const Uniforms &uniforms, int faceIndex, int vertexIndex) const override final {
+		const Mesh *mesh = uniforms.mesh;
 		const FaceVector &faces = mesh->getFace(faceIndex);
+		Varyings out;
 
 		// diffuse texture coordinates
-		uvs[vertexIndex] = mesh->getDiffuseTextureCoordinate(faces[vertexIndex].y);
+		out.uv = mesh->getDiffuseTextureCoordinate(faces[vertexIndex].y);
 		
 		// calculate light intensity per vertex
 		Vector3f n = mesh->getNormal(faces[vertexIndex].z);
 		n.normalize();
-		light[vertexIndex] = n.dot(lightDirection);
+		out.light = n.dot(uniforms.lightDirection);
 
 		// vertex position
 		const Vector3f vertex = mesh->getVertex(faces[vertexIndex].x);
-		return MatrixVectorf::vectorFromHomogeneousMatrix(transform*Matrix4f::homogeneousMatrixfromVector(vertex));
+		out.position = uniforms.transform.transformPoint(vertex);
+		return out;
 	}
 
-	RGBA fragment(const Vector3f &barycentric) override final {
+	void vertexBatch(const Uniforms &uniforms, VertexStreams &streams) const override final {
+		streams.clear();
+		transformPositions(uniforms, streams);
+		streams.textureCoordinates = true;
+
+		// light intensity per normal
+		lightIntensities(uniforms, streams);
+	}
+
+	RGBA fragment(const Uniforms &uniforms, const Triangle &triangle, const Vector3f &barycentric, const Vector2i &) const override final {
+		const Varyings *v = triangle.vertices;
 		Vector3f uvInterpolated;
-		uvInterpolated.x = uvs[0].x *barycentric.x + uvs[1].x * barycentric.y + uvs[2].x * barycentric.z;
-		uvInterpolated.y = uvs[0].y *barycentric.x + uvs[1].y * barycentric.y + uvs[2].y * barycentric.z;
+		uvInterpolated.x = v[0].uv.x *barycentric.x + v[1].uv.x * barycentric.y + v[2].uv.x * barycentric.z;
+		uvInterpolated.y = v[0].uv.y *barycentric.x + v[1].uv.y * barycentric.y + v[2].uv.y * barycentric.z;
 
-		float lightIntensity = light[0] *barycentric.x + light[1] * barycentric.y + light[2] * barycentric.z;
-		RGBA colour = mesh->getDiffuseColor(uvInterpolated);
+		float lightIntensity = v[0].light *barycentric.x + v[1].light * barycentric.y + v[2].light * barycentric.z;
+		RGBA colour = uniforms.mesh->getDiffuseColor(uvInterpolated);
 		colour.applyLightIntensity(std::max(0.0f, lightIntensity));
 		return colour;
 	}
 
-	ShaderType getType() override final {
-		return ShaderType::GOURAUD;
+	void fragmentBatch(const Uniforms &uniforms, const Triangle &triangle, const FragmentBatch &batch, RGBA colours[FragmentBatch::SIZE]) const override final {
+		const Varyings *v = triangle.vertices;
+		const Barycentricx8 barycentric = Barycentricx8::load(batch.barycentricX, batch.barycentricY, batch.barycentricZ);
+
+		const Floatx8 uInterpolated = barycentric.interpolate(v[0].uv.x, v[1].uv.x, v[2].uv.x);
+		const Floatx8 vInterpolated = barycentric.interpolate(v[0].uv.y, v[1].uv.y, v[2].uv.y);
+
+		const Floatx8 lightIntensity = barycentric.interpolate(v[0].light, v[1].light, v[2].light);
+
+		uniforms.mesh->getDiffuseColors(uInterpolated, vInterpolated, textureLod(uInterpolated, vInterpolated), Floatx8::fromMask(batch.mask), colours);
+		applyLightIntensities(lightIntensity, colours);
 	}
 
-private:
-	Vector3f uvs[3];
-	float light[3];
+	ShaderType getType() const override final {
+		return ShaderType::GOURAUD;
+	}
 };
\ No newline at end of file
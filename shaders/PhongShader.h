@@ -5,67 +5,85 @@
 
 class PhongShader : public Shader {
 public:
-	// uniforms for the entire shader
-	Vector3f lightDirection;
-	Mesh *mesh;
 
-	Matrix4f MWP;
-	Matrix4f MWPInversedTransposed;
-	Matrix4f transform;
-
-	Vector3f vertex(int faceIndex, int vertexIndex) override final {
+	Varyings vertex(const Uniforms &uniforms, int faceIndex, int vertexIndex) const override final {
+		const Mesh *mesh = uniforms.mesh;
 		const FaceVector &faces = mesh->getFace(faceIndex);
+		Varyings out;
 
 		// diffuse texture coordinates
-		uvs[vertexIndex] = mesh->getDiffuseTextureCoordinate(faces[vertexIndex].y);
+		out.uv = mesh->getDiffuseTextureCoordinate(faces[vertexIndex].y);
 
 		// Transform normals and light
-		normals[vertexIndex] = MatrixVectorf::vectorFromHomogeneousMatrix(MWPInversedTransposed * Matrix4f::homogeneousMatrixfromVector(mesh->getNormal(faces[vertexIndex].z)));
+		out.normal = uniforms.MWPInversedTransposed.transformPoint(mesh->getNormal(faces[vertexIndex].z));
+
+		// tangent frame precomputed by the mesh, transformed as a direction
+		if (mesh->hasTangents()) {
+			const int tangentIndex = mesh->getFaceTangents(faceIndex)[vertexIndex];
+			const Vector3f &tangent = mesh->getTangent(tangentIndex);
+			const Matrix4f &MWP = uniforms.MWP;
+			out.tangent = Vector3f(MWP[0][0] * tangent.x + MWP[0][1] * tangent.y + MWP[0][2] * tangent.z,
+				MWP[1][0] * tangent.x + MWP[1][1] * tangent.y + MWP[1][2] * tangent.z,
+				MWP[2][0] * tangent.x + MWP[2][1] * tangent.y + MWP[2][2] * tangent.z);
+			out.bitangentSign = mesh->getBitangentSign(tangentIndex);
+		} else {
+			tangentFromNormal(out);
+		}
 
 		// vertex position
 		const Vector3f vertex = mesh->getVertex(faces[vertexIndex].x);
-		ndc[vertexIndex] = MatrixVectorf::vectorFromHomogeneousMatrix(MWP*Matrix4f::homogeneousMatrixfromVector(vertex));
-		return MatrixVectorf::vectorFromHomogeneousMatrix(transform*Matrix4f::homogeneousMatrixfromVector(vertex));
+		out.position = uniforms.transform.transformPoint(vertex);
+		return out;
+	}
+
+	void vertexBatch(const Uniforms &uniforms, VertexStreams &streams) const override final {
+		const Mesh *mesh = uniforms.mesh;
+		const ArrayView<Vector3f> tangents = mesh->getTangents();
+		streams.clear();
+		transformPositions(uniforms, streams);
+		streams.textureCoordinates = true;
+
+		// Transform normals and light
+		transformNormals(uniforms, uniforms.MWPInversedTransposed, streams);
+
+		// meshes without texture coordinates or normals have no tangents
+		if (!mesh->hasTangents()) {
+			streams.tangentsFromNormals = true;
+			return;
+		}
+		resize(tangents.size(), streams.tangentX, streams.tangentY, streams.tangentZ);
+		VertexKernels::transformDirections(uniforms.MWP, tangents.data(), tangents.size(), streams.tangentX.data(), streams.tangentY.data(), streams.tangentZ.data());
+		streams.bitangentSigns = mesh->getBitangentSigns().data();
 	}
 
-	RGBA fragment(const Vector3f &barycentric) override final {
+	RGBA fragment(const Uniforms &uniforms, const Triangle &triangle, const Vector3f &barycentric, const Vector2i &) const override final {
+		const Mesh *mesh = uniforms.mesh;
+		const Vector3f &lightDirection = uniforms.transformedLightDirection;
+		const Varyings *v = triangle.vertices;
+
 		Vector3f uvInterpolated;
-		uvInterpolated.x = uvs[0].x *barycentric.x + uvs[1].x * barycentric.y + uvs[2].x * barycentric.z;
-		uvInterpolated.y = uvs[0].y *barycentric.x + uvs[1].y * barycentric.y + uvs[2].y * barycentric.z;
+		uvInterpolated.x = v[0].uv.x *barycentric.x + v[1].uv.x * barycentric.y + v[2].uv.x * barycentric.z;
+		uvInterpolated.y = v[0].uv.y *barycentric.x + v[1].uv.y * barycentric.y + v[2].uv.y * barycentric.z;
 
 		Vector3f normalInterpolated;
-		normalInterpolated.x = normals[0].x *barycentric.x + normals[1].x * barycentric.y + normals[2].x * barycentric.z;
-		normalInterpolated.y = normals[0].y *barycentric.x + normals[1].y * barycentric.y + normals[2].y * barycentric.z;
-		normalInterpolated.z = normals[0].z *barycentric.x + normals[1].z * barycentric.y + normals[2].z * barycentric.z;
+		normalInterpolated.x = v[0].normal.x *barycentric.x + v[1].normal.x * barycentric.y + v[2].normal.x * barycentric.z;
+		normalInterpolated.y = v[0].normal.y *barycentric.x + v[1].normal.y * barycentric.y + v[2].normal.y * barycentric.z;
+		normalInterpolated.z = v[0].normal.z *barycentric.x + v[1].normal.z * barycentric.y + v[2].normal.z * barycentric.z;
 		normalInterpolated.normalize();
 
-		// convert object space to tangent space
-		Vector3f row0 = ndc[1] - ndc[0];
-		Vector3f row1 = ndc[2] - ndc[0];
-		Matrix3f A = {
-			{ row0.x, row0.y, row0.z },
-			{ row1.x, row1.y, row1.z },
-			{ normalInterpolated.x, normalInterpolated.y, normalInterpolated.z }
-		};
-		Matrix3f AI = A.invert();
-
-		Matrix<float, 3, 1> iM = AI * Matrix3f::matrixFromVector(Vector3f(uvs[1][0] - uvs[0][0], uvs[2][0] - uvs[0][0], 0));
-		Vector3f i(iM[0][0], iM[1][0], iM[2][0]);
-		i.normalize();
-
-		Matrix<float, 3, 1> jM = AI * Matrix3f::matrixFromVector(Vector3f(uvs[1][1] - uvs[0][1], uvs[2][1] - uvs[0][1], 0));
-		Vector3f j(jM[0][0], jM[1][0], jM[2][0]);
-		j.normalize();
+		Vector3f tangentInterpolated;
+		tangentInterpolated.x = v[0].tangent.x *barycentric.x + v[1].tangent.x * barycentric.y + v[2].tangent.x * barycentric.z;
+		tangentInterpolated.y = v[0].tangent.y *barycentric.x + v[1].tangent.y * barycentric.y + v[2].tangent.y * barycentric.z;
+		tangentInterpolated.z = v[0].tangent.z *barycentric.x + v[1].tangent.z * barycentric.y + v[2].tangent.z * barycentric.z;
+		float bitangentSign = v[0].bitangentSign *barycentric.x + v[1].bitangentSign * barycentric.y + v[2].bitangentSign * barycentric.z;
 
-		Matrix<float, 3, 3> B = {
-			{ i[0], j[0], normalInterpolated.x },
-			{ i[1], j[1], normalInterpolated.y },
-			{ i[2], j[2], normalInterpolated.z }
-		};
+		// convert tangent space to the space of the interpolated normal
+		Vector3f i = tangentInterpolated - normalInterpolated * normalInterpolated.dot(tangentInterpolated);
+		i.normalize();
+		Vector3f j = normalInterpolated.cross(i) * (bitangentSign < 0.0f ? -1.0f : 1.0f);
 
 		Vector3f normalMap = mesh->getNormalFromMap(uvInterpolated);
-		Matrix<float, 3, 1> n = B *Matrix4f::matrixFromVector(normalMap);
-		Vector3f normal(n[0][0], n[1][0], n[2][0]);
+		Vector3f normal = i * normalMap.x + j * normalMap.y + normalInterpolated * normalMap.z;
 		normal.normalize();
 
 		float diffuseLight = normal.dot(lightDirection);
@@ -78,10 +96,50 @@ public:
 		return colour;
 	}
 
-	ShaderType getType() override final { return ShaderType::PHONG; }
+	void fragmentBatch(const Uniforms &uniforms, const Triangle &triangle, const FragmentBatch &batch, RGBA colours[FragmentBatch::SIZE]) const override final {
+		const Mesh *mesh = uniforms.mesh;
+		const Vector3f &lightDirection = uniforms.transformedLightDirection;
+		const Varyings *v = triangle.vertices;
+		const Floatx8 mask = Floatx8::fromMask(batch.mask);
+		const Barycentricx8 barycentric = Barycentricx8::load(batch.barycentricX, batch.barycentricY, batch.barycentricZ);
+
+		const Floatx8 uInterpolated = barycentric.interpolate(v[0].uv.x, v[1].uv.x, v[2].uv.x);
+		const Floatx8 vInterpolated = barycentric.interpolate(v[0].uv.y, v[1].uv.y, v[2].uv.y);
+		const Floatx8 lod = textureLod(uInterpolated, vInterpolated);
+
+		const Vector3fx8 normalInterpolated = normalize(uniforms, barycentric.interpolate(v[0].normal, v[1].normal, v[2].normal));
+		const Vector3fx8 tangentInterpolated = barycentric.interpolate(v[0].tangent, v[1].tangent, v[2].tangent);
+		const Floatx8 bitangentSign = barycentric.interpolate(v[0].bitangentSign, v[1].bitangentSign, v[2].bitangentSign);
+
+		// convert tangent space to the space of the interpolated normal
+		const Vector3fx8 i = normalize(uniforms, tangentInterpolated - normalInterpolated * normalInterpolated.dot(tangentInterpolated));
+		const Vector3fx8 j = normalInterpolated.cross(i) * Floatx8::select(bitangentSign < Floatx8(0.0f), Floatx8(-1.0f), Floatx8(1.0f));
+
+		Floatx8 mapX, mapY, mapZ, specularExponent;
+		mesh->getMaterials(uInterpolated, vInterpolated, lod, mask, colours, mapX, mapY, mapZ, specularExponent);
+		const Vector3fx8 normal = normalize(uniforms, i * mapX + j * mapY + normalInterpolated * mapZ);
+
+		const Vector3fx8 light(lightDirection);
+		const Floatx8 diffuseLight = normal.dot(light);
+		const Vector3fx8 reflectedLight = normalize(uniforms, normal * (Floatx8(2.0f) * diffuseLight) - light);
+		const Floatx8 base = Floatx8::max(reflectedLight.z, Floatx8(0.0f));
+
+		Floatx8 specular;
+		if (uniforms.precision == ShadingPrecision::EXACT) {
+			float bases[FragmentBatch::SIZE], exponents[FragmentBatch::SIZE], speculars[FragmentBatch::SIZE];
+			base.store(bases);
+			specularExponent.store(exponents);
+			for (int i = 0; i < FragmentBatch::SIZE; i++) {
+				speculars[i] = batch.mask & (1 << i) ? pow(bases[i], exponents[i]) : 0.0f;
+			}
+			specular = Floatx8::load(speculars);
+		} else if (uniforms.precision == ShadingPrecision::FAST) {
+			specular = FastMath::pow(base, specularExponent);
+		} else {
+			specular = FastMath::powCoarse(base, specularExponent);
+		}
+		applyLightIntensities(diffuseLight + Floatx8(0.08f) * specular, colours);
+	}
 
-private:
-	Vector3f uvs[3];
-	Vector3f ndc[3];
-	Vector3f normals[3];
+	ShaderType getType() const override final { return ShaderType::PHONG; }
 };
\ No newline at end of file
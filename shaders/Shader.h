@@ -1,7 +1,18 @@
 #pragma once
 
+#include <vector>
+#include <cmath>
+#include <algorithm>
+
 #include "../types/Types.h"
+#include "../types/Matrix.h"
+#include "../types/Floatx8.h"
+#include "../types/Vector3fx8.h"
+#include "../types/FastMath.h"
+#include "../types/FragmentBatch.h"
 #include "../rasterizer/Mesh.h"
+#include "../rasterizer/VertexKernels.h"
+#include "../rasterizer/CpuDispatch.h"
 
 enum class ShaderType : int {
 	FACE_ILLUMINATION = 0,
@@ -12,12 +23,226 @@ enum class ShaderType : int {
 	TANGENT_NORMAL
 };
 
+// Accuracy the fragment stage trades for speed. The faster precisions stay within 1
+// of EXACT per colour channel on the bundled models (see tools/PrecisionReport). Every
+// precision lights colours through the same integer path, see RGBA::applyLightIntensity.
+enum class ShadingPrecision : int {
+	// std::pow and normalization through a square root and a divide
+	EXACT = 0,
+	// polynomial pow within 1.9e-3 and normalization through the reciprocal square root
+	// refined by one Newton step
+	FAST,
+	// coarse polynomial pow within 8e-2 and normalization through the unrefined
+	// reciprocal square root
+	FASTEST
+};
+
+// Uniforms for the entire frame. The rasterizer builds this block once per frame
+// and every shader invocation only gets read access to it.
+struct Uniforms {
+	const Mesh *mesh;
+	Matrix4f transform;
+	Matrix4f MWP;
+	Matrix4f MWPInversedTransposed;
+	Vector3f lightDirection;
+	// light direction transformed by MWP (phong)
+	Vector3f transformedLightDirection;
+	const float *zBuffer;
+	float depth;
+	int screenWidth;
+	ShadingPrecision precision;
+};
+
+// Outputs of the vertex stage for one vertex of a triangle
+struct Varyings {
+	Vector3f position;
+	Vector3f uv;
+	Vector3f normal;
+	Vector3f tangent;
+	float bitangentSign;
+	float light;
+};
+
+// Outputs of the batch vertex stage in structure of arrays form. Positions are
+// indexed like the mesh vertices and normals like the mesh normals, so triangle
+// setup only has to gather them with the face indices.
+struct VertexStreams {
+	// screen space positions
+	std::vector<float> positionX, positionY, positionZ;
+	std::vector<float> normalX, normalY, normalZ;
+	// indexed like the mesh tangents
+	std::vector<float> tangentX, tangentY, tangentZ;
+	const float *bitangentSigns;
+	// whether tangents are built from the normals when the tangent streams are empty
+	bool tangentsFromNormals;
+	std::vector<float> light;
+	bool textureCoordinates;
+
+	void clear() {
+		for (std::vector<float> *stream : { &positionX, &positionY, &positionZ, &normalX, &normalY, &normalZ, &tangentX, &tangentY, &tangentZ, &light }) {
+			stream->clear();
+		}
+		bitangentSigns = nullptr;
+		tangentsFromNormals = false;
+		textureCoordinates = false;
+	}
+};
+
+// Triangle in flight. It is owned by the triangle setup of the rasterizer and
+// handed to the fragment stage, so shaders keep no per-triangle state.
+struct Triangle {
+	Varyings vertices[3];
+
+	// flat values written by the geometry stage
+	Vector3f faceUv;
+	float faceIllumination;
+};
+
 class Shader {
 public:
-	Vector2i FRAGMENT_COORDINATES;
+	virtual ~Shader() {}
+
+	virtual Varyings vertex(const Uniforms &uniforms, int faceIndex, int vertexIndex) const = 0;
+
+	// Batch vertex stage. It transforms the vertex and normal streams of the mesh once
+	// per frame instead of once per face corner. The result must match vertex().
+	virtual void vertexBatch(const Uniforms &uniforms, VertexStreams &streams) const {
+		streams.clear();
+		transformPositions(uniforms, streams);
+	}
+
+	// Gathers the varyings of a face corner from the streams written by vertexBatch
+	Varyings assembleVertex(const Uniforms &uniforms, const VertexStreams &streams, int faceIndex, int vertexIndex) const {
+		const Vector3i indices = uniforms.mesh->getFaceCorner(faceIndex, vertexIndex);
+		Varyings out;
+		out.position = Vector3f(streams.positionX[indices.x], streams.positionY[indices.x], streams.positionZ[indices.x]);
+		if (!streams.normalX.empty()) {
+			out.normal = Vector3f(streams.normalX[indices.z], streams.normalY[indices.z], streams.normalZ[indices.z]);
+		}
+		if (!streams.tangentX.empty()) {
+			const int index = uniforms.mesh->getFaceTangents(faceIndex)[vertexIndex];
+			out.tangent = Vector3f(streams.tangentX[index], streams.tangentY[index], streams.tangentZ[index]);
+			out.bitangentSign = streams.bitangentSigns[index];
+		} else if (streams.tangentsFromNormals) {
+			tangentFromNormal(out);
+		}
+		if (!streams.light.empty()) {
+			out.light = streams.light[indices.z];
+		}
+		if (streams.textureCoordinates) {
+			out.uv = uniforms.mesh->getDiffuseTextureCoordinate(indices.y);
+		}
+		return out;
+	}
+	virtual void geometry(const Uniforms &, int, Triangle &) const {}
+	virtual RGBA fragment(const Uniforms &uniforms, const Triangle &triangle, const Vector3f &barycentric, const Vector2i &fragmentCoordinates) const = 0;
+
+	// Shades a whole batch. Only lanes set in the batch mask have to be written.
+	// Shaders without a vectorized path run the scalar fragment per lane.
+	virtual void fragmentBatch(const Uniforms &uniforms, const Triangle &triangle, const FragmentBatch &batch, RGBA colours[FragmentBatch::SIZE]) const {
+		for (int i = 0; i < FragmentBatch::SIZE; i++) {
+			if (batch.mask & (1 << i)) {
+				const Vector3f barycentric(batch.barycentricX[i], batch.barycentricY[i], batch.barycentricZ[i]);
+				const Vector2i coordinates(batch.x + FragmentBatch::laneOffsetX(i), batch.y + FragmentBatch::laneOffsetY(i));
+				colours[i] = fragment(uniforms, triangle, barycentric, coordinates);
+			}
+		}
+	}
+
+	virtual ShaderType getType() const = 0;
+
+protected:
+	// Level of detail of the two quads of a batch as the log2 of the largest uv step
+	// between neighbouring pixels. Uncovered lanes take part as helper lanes, their
+	// barycentrics are extrapolated from the triangle plane.
+	static Floatx8 textureLod(const Floatx8 &u, const Floatx8 &v) {
+		float us[FragmentBatch::SIZE], vs[FragmentBatch::SIZE], lods[FragmentBatch::SIZE];
+		u.store(us);
+		v.store(vs);
+		for (int quad = 0; quad < FragmentBatch::SIZE; quad += 4) {
+			const float dudx = us[quad + 1] - us[quad], dvdx = vs[quad + 1] - vs[quad];
+			const float dudy = us[quad + 2] - us[quad], dvdy = vs[quad + 2] - vs[quad];
+			const float lod = 0.5f * std::log2(std::max(dudx * dudx + dvdx * dvdx, dudy * dudy + dvdy * dvdy));
+			for (int i = 0; i < 4; i++) {
+				lods[quad + i] = lod;
+			}
+		}
+		return Floatx8::load(lods);
+	}
+
+	// RGBA::applyLightIntensity on every lane, through the integer colour path
+	static void applyLightIntensities(const Floatx8 &intensity, RGBA colours[FragmentBatch::SIZE]) {
+		// RGBA::fixedIntensity
+		int fixedIntensities[FragmentBatch::SIZE];
+		(Floatx8::min(Floatx8::max(intensity, Floatx8(0.0f)), Floatx8(127.99f)) * Floatx8(256.0f) + Floatx8(0.5f)).toInt().store(fixedIntensities);
+		CpuDispatch::kernels().lightColours(fixedIntensities, colours);
+	}
+
+	// Tangent frame of a vertex of a mesh without tangents, from its normal alone: any unit
+	// tangent perpendicular to the normal and a positive bitangent sign
+	static void tangentFromNormal(Varyings &varyings) {
+		const Vector3f &normal = varyings.normal;
+		const Vector3f axis = std::abs(normal.x) < 0.9f * normal.magnitude() ? Vector3f(1.0f, 0.0f, 0.0f) : Vector3f(0.0f, 1.0f, 0.0f);
+		const Vector3f tangent = normal.cross(axis);
+		const float length = tangent.magnitude();
+		varyings.tangent = length > 0.0f ? tangent / length : axis;
+		varyings.bitangentSign = 1.0f;
+	}
+
+	// unit vectors at the precision of the uniforms
+	static Vector3fx8 normalize(const Uniforms &uniforms, const Vector3fx8 &vector) {
+		switch (uniforms.precision) {
+			case ShadingPrecision::FAST: return vector.normalizedFast();
+			case ShadingPrecision::FASTEST: return vector.normalizedEstimate();
+			default: return vector.normalized();
+		}
+	}
+
+	static void transformPositions(const Uniforms &uniforms, VertexStreams &streams) {
+		const Mesh *mesh = uniforms.mesh;
+		if (mesh->isQuantized()) {
+			// the positions are scaled to the bounds by the same matrix
+			const ArrayView<QuantizedPosition> vertices = mesh->getQuantizedVertices();
+			resize(vertices.size(), streams.positionX, streams.positionY, streams.positionZ);
+			VertexKernels::transformPoints(uniforms.transform * mesh->getDequantizationMatrix(), vertices.data(), vertices.size(), streams.positionX.data(), streams.positionY.data(), streams.positionZ.data());
+			return;
+		}
+		const ArrayView<Vector3f> vertices = mesh->getVertices();
+		resize(vertices.size(), streams.positionX, streams.positionY, streams.positionZ);
+		VertexKernels::transformPoints(uniforms.transform, vertices.data(), vertices.size(), streams.positionX.data(), streams.positionY.data(), streams.positionZ.data());
+	}
+
+	// transforms the normals of the mesh as points (x, y, z, 1) by matrix into the normal streams
+	static void transformNormals(const Uniforms &uniforms, const Matrix4f &matrix, VertexStreams &streams) {
+		const Mesh *mesh = uniforms.mesh;
+		if (mesh->isQuantized()) {
+			const ArrayView<OctahedralNormal> normals = mesh->getQuantizedNormals();
+			resize(normals.size(), streams.normalX, streams.normalY, streams.normalZ);
+			VertexKernels::transformPoints(matrix, normals.data(), normals.size(), streams.normalX.data(), streams.normalY.data(), streams.normalZ.data());
+			return;
+		}
+		const ArrayView<Vector3f> normals = mesh->getNormals();
+		resize(normals.size(), streams.normalX, streams.normalY, streams.normalZ);
+		VertexKernels::transformPoints(matrix, normals.data(), normals.size(), streams.normalX.data(), streams.normalY.data(), streams.normalZ.data());
+	}
+
+	// light intensity of every normal of the mesh into the light stream
+	static void lightIntensities(const Uniforms &uniforms, VertexStreams &streams) {
+		const Mesh *mesh = uniforms.mesh;
+		if (mesh->isQuantized()) {
+			const ArrayView<OctahedralNormal> normals = mesh->getQuantizedNormals();
+			streams.light.resize(normals.size());
+			VertexKernels::lightIntensities(normals.data(), normals.size(), uniforms.lightDirection, streams.light.data());
+			return;
+		}
+		const ArrayView<Vector3f> normals = mesh->getNormals();
+		streams.light.resize(normals.size());
+		VertexKernels::lightIntensities(normals.data(), normals.size(), uniforms.lightDirection, streams.light.data());
+	}
 
-	virtual Vector3f vertex(int faceIndex, int vertexIndex) = 0;
-	virtual void geometry(int faceIndex, Vector3f vertices[3]) {};
-	virtual RGBA fragment(const Vector3f &barycentric) = 0;
-	virtual ShaderType getType() = 0;
+	static void resize(size_t size, std::vector<float> &x, std::vector<float> &y, std::vector<float> &z) {
+		x.resize(size);
+		y.resize(size);
+		z.resize(size);
+	}
 };
\ No newline at end of file
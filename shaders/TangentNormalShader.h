@@ -7,32 +7,35 @@
 
 class TangentNormalShader : public Shader {
 public:
-	// uniforms for the entire shader
 
-	Mesh *mesh;
-	Matrix4f transform;
-
-	Vector3f vertex(int faceIndex, int vertexIndex) override final {
+	Varyings vertex(const Uniforms &uniforms, int faceIndex, int vertexIndex) const override final {
+		const Mesh *mesh = uniforms.mesh;
 		const FaceVector &faces = mesh->getFace(faceIndex);
+		Varyings out;
 
 		// diffuse texture coordinates
-		uvs[vertexIndex] = mesh->getDiffuseTextureCoordinate(faces[vertexIndex].y);
+		out.uv = mesh->getDiffuseTextureCoordinate(faces[vertexIndex].y);
 
 		// vertex position
 		const Vector3f vertex = mesh->getVertex(faces[vertexIndex].x);
-		return MatrixVectorf::vectorFromHomogeneousMatrix(transform*Matrix4f::homogeneousMatrixfromVector(vertex));
+		out.position = uniforms.transform.transformPoint(vertex);
+		return out;
+	}
+
+	void vertexBatch(const Uniforms &uniforms, VertexStreams &streams) const override final {
+		streams.clear();
+		transformPositions(uniforms, streams);
+		streams.textureCoordinates = true;
 	}
 
-	RGBA fragment(const Vector3f &barycentric) override final {
+	RGBA fragment(const Uniforms &uniforms, const Triangle &triangle, const Vector3f &barycentric, const Vector2i &) const override final {
+		const Varyings *v = triangle.vertices;
 		Vector3f uvInterpolated;
-		uvInterpolated.x = uvs[0].x *barycentric.x + uvs[1].x * barycentric.y + uvs[2].x * barycentric.z;
-		uvInterpolated.y = uvs[0].y *barycentric.x + uvs[1].y * barycentric.y + uvs[2].y * barycentric.z;
+		uvInterpolated.x = v[0].uv.x *barycentric.x + v[1].uv.x * barycentric.y + v[2].uv.x * barycentric.z;
+		uvInterpolated.y = v[0].uv.y *barycentric.x + v[1].uv.y * barycentric.y + v[2].uv.y * barycentric.z;
 
-		return mesh->getNormalAsColour(uvInterpolated);
+		return uniforms.mesh->getNormalAsColour(uvInterpolated);
 	}
 
-	ShaderType getType() override final { return ShaderType::TANGENT_NORMAL; }
-
-private:
-	Vector3f uvs[3];
+	ShaderType getType() const override final { return ShaderType::TANGENT_NORMAL; }
 };
\ No newline at end of file
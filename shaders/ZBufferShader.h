@@ -4,27 +4,31 @@
 
 class ZBufferShader : public Shader {
 public:
-	// uniforms for the entire shader
-	Matrix4f transform;
-	Mesh *mesh;
-	float * zBuffer;
-	float depth;
-	int screenWidth;
 
-	Vector3f vertex(int faceIndex, int vertexIndex) override final {
+	Varyings vertex(const Uniforms &uniforms, int faceIndex, int vertexIndex) const override final {
 		// vertex position
-		const FaceVector &faces = mesh->getFace(faceIndex);
-		const Vector3f vertex = mesh->getVertex(faces[vertexIndex].x);
-		return MatrixVectorf::vectorFromHomogeneousMatrix(transform*Matrix4f::homogeneousMatrixfromVector(vertex));
+		const FaceVector &faces = uniforms.mesh->getFace(faceIndex);
+		const Vector3f vertex = uniforms.mesh->getVertex(faces[vertexIndex].x);
+		Varyings out;
+		out.position = uniforms.transform.transformPoint(vertex);
+		return out;
 	}
 
-	RGBA fragment(const Vector3f &barycentric) override final {
+	RGBA fragment(const Uniforms &uniforms, const Triangle &, const Vector3f &, const Vector2i &fragmentCoordinates) const override final {
 		RGBA colour = WHITE;
-		colour.applyLightIntensity(zBuffer[FRAGMENT_COORDINATES.x + FRAGMENT_COORDINATES.y * screenWidth] / depth);
+		colour.applyLightIntensity(uniforms.zBuffer[fragmentCoordinates.x + fragmentCoordinates.y * uniforms.screenWidth] / uniforms.depth);
 		return colour;
 	}
 
-	ShaderType getType() override final {
+	void fragmentBatch(const Uniforms &uniforms, const Triangle &, const FragmentBatch &batch, RGBA colours[FragmentBatch::SIZE]) const override final {
+		// the depth test already wrote the depths of the batch
+		const float *top = uniforms.zBuffer + batch.x + batch.y * uniforms.screenWidth;
+		const Floatx8 depth = Floatx8::loadQuads(top, top + uniforms.screenWidth);
+		std::fill(colours, colours + FragmentBatch::SIZE, WHITE);
+		applyLightIntensities(depth / Floatx8(uniforms.depth), colours);
+	}
+
+	ShaderType getType() const override final {
 		return ShaderType::ZBUFFER;
 	}
 };
\ No newline at end of file
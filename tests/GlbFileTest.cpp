@@ -0,0 +1,94 @@
+// Loads GLB files written on the fly and checks the positions and normals the mesh ends
+// up with, for every mix of attributes read in place and attributes converted.
+//
+// usage: GlbFileTest [directory for the temporary files]
+#include <cassert>
+#include <cmath>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <string>
+#include <vector>
+
+#include "../rasterizer/Mesh.h"
+
+namespace {
+	const Vector3f POSITIONS[3] = { Vector3f(0.0f, 0.0f, 0.0f), Vector3f(1.0f, 0.0f, 0.0f), Vector3f(0.0f, 1.0f, 0.0f) };
+	const Vector3f NORMALS[3] = { Vector3f(0.0f, 0.0f, 1.0f), Vector3f(0.0f, 0.6f, 0.8f), Vector3f(0.6f, 0.0f, 0.8f) };
+
+	void append(std::vector<char> &bytes, const void *data, size_t size) {
+		bytes.insert(bytes.end(), static_cast<const char*>(data), static_cast<const char*>(data) + size);
+	}
+
+	// one triangle, an attribute with a stride of 16 bytes is converted rather than read in place
+	void writeTriangle(const std::string &path, bool paddedPositions, bool paddedNormals) {
+		std::vector<char> binary;
+		for (int i = 0; i < 3; i++) {
+			append(binary, &POSITIONS[i], sizeof(Vector3f));
+			if (paddedPositions) {
+				binary.insert(binary.end(), 4, 0);
+			}
+		}
+		const size_t normalsOffset = binary.size();
+		for (int i = 0; i < 3; i++) {
+			append(binary, &NORMALS[i], sizeof(Vector3f));
+			if (paddedNormals) {
+				binary.insert(binary.end(), 4, 0);
+			}
+		}
+
+		char json[1024];
+		std::snprintf(json, sizeof(json),
+			"{\"asset\":{\"version\":\"2.0\"},\"scene\":0,\"scenes\":[{\"nodes\":[0]}],\"nodes\":[{\"mesh\":0}],"
+			"\"meshes\":[{\"primitives\":[{\"attributes\":{\"POSITION\":0,\"NORMAL\":1}}]}],"
+			"\"buffers\":[{\"byteLength\":%u}],"
+			"\"bufferViews\":[{\"buffer\":0,\"byteOffset\":0,\"byteLength\":%u,\"byteStride\":%u},{\"buffer\":0,\"byteOffset\":%u,\"byteLength\":%u,\"byteStride\":%u}],"
+			"\"accessors\":[{\"bufferView\":0,\"componentType\":5126,\"count\":3,\"type\":\"VEC3\"},{\"bufferView\":1,\"componentType\":5126,\"count\":3,\"type\":\"VEC3\"}]}",
+			static_cast<unsigned>(binary.size()),
+			static_cast<unsigned>(normalsOffset), paddedPositions ? 16u : 12u,
+			static_cast<unsigned>(normalsOffset), static_cast<unsigned>(binary.size() - normalsOffset), paddedNormals ? 16u : 12u);
+		std::string text = json;
+		text.append((4 - text.size() % 4) % 4, ' ');
+
+		std::vector<char> file;
+		const uint32_t header[3] = { 0x46546C67, 2, static_cast<uint32_t>(12 + 8 + text.size() + 8 + binary.size()) };
+		const uint32_t jsonChunk[2] = { static_cast<uint32_t>(text.size()), 0x4E4F534A };
+		const uint32_t binaryChunk[2] = { static_cast<uint32_t>(binary.size()), 0x004E4942 };
+		append(file, header, sizeof(header));
+		append(file, jsonChunk, sizeof(jsonChunk));
+		append(file, text.data(), text.size());
+		append(file, binaryChunk, sizeof(binaryChunk));
+		append(file, binary.data(), binary.size());
+
+		FILE *out = std::fopen(path.c_str(), "wb");
+		assert(out != nullptr);
+		std::fwrite(file.data(), 1, file.size(), out);
+		std::fclose(out);
+	}
+
+	bool equal(const Vector3f &a, const Vector3f &b) {
+		return std::fabs(a.x - b.x) < 1e-6f && std::fabs(a.y - b.y) < 1e-6f && std::fabs(a.z - b.z) < 1e-6f;
+	}
+}
+
+int main(int argc, char **argv) {
+	const std::string directory = argc > 1 ? std::string(argv[1]) + "/" : std::string();
+	int failures = 0;
+	for (int paddedPositions = 0; paddedPositions < 2; paddedPositions++) {
+		for (int paddedNormals = 0; paddedNormals < 2; paddedNormals++) {
+			const std::string path = directory + "GlbFileTest.glb";
+			writeTriangle(path, paddedPositions != 0, paddedNormals != 0);
+			Mesh mesh;
+			mesh.loadGlbFromFile(path);
+			std::remove(path.c_str());
+
+			bool passed = mesh.getFacesCount() == 1 && mesh.getVerticesCount() == 3 && mesh.getNormalsCount() == 3;
+			for (int i = 0; passed && i < 3; i++) {
+				passed = equal(mesh.getVertex(i), POSITIONS[i]) && equal(mesh.getNormal(i), NORMALS[i]);
+			}
+			std::printf("positions %s, normals %s: %s\n", paddedPositions ? "converted" : "in place", paddedNormals ? "converted" : "in place", passed ? "ok" : "FAILED");
+			failures += passed ? 0 : 1;
+		}
+	}
+	return failures == 0 ? 0 : 1;
+}
\ No newline at end of file
@@ -0,0 +1,182 @@
+// Compares every Vector3fx8 and Barycentricx8 operation with the Vector3f code it
+// stands for, lane by lane over random vectors, and fails when a lane is further from
+// it than the bound of the operation. The normalizes are compared with the exact unit
+// vector in double instead, which is what their doc comments bound. Errors are in ulps of the larger of the scalar
+// result and the magnitudes it is summed from, so cancellation isn't counted against
+// the lanes. Define FLOATX8_ISA to check another instruction set than the baseline,
+// the machine has to support it.
+//
+// usage: Vector3fx8Test [batches]
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <limits>
+#include <random>
+
+#include "../types/Vector3fx8.h"
+
+namespace {
+	const int LANES = Floatx8::LANES;
+
+	// lanes of the operations as plain arrays, Floatx8 only lives in the target code below
+	struct Lanes {
+		float a[3][LANES], b[3][LANES], t[LANES];
+		float barycentric[3][LANES];
+		// vertices of the triangle, the same for every lane
+		float vertices[3][3];
+
+		Vector3f vertex(int index) const { return Vector3f(vertices[index][0], vertices[index][1], vertices[index][2]); }
+
+		float sum[3][LANES], difference[3][LANES], scaled[3][LANES], cross[3][LANES];
+		float dot[LANES], magnitude[LANES];
+		float normalized[3][LANES], normalizedFast[3][LANES], normalizedEstimate[3][LANES];
+		float lerp[3][LANES], interpolated[LANES], interpolatedVector[3][LANES];
+	};
+}
+
+FLOATX8_BEGIN_TARGET
+namespace FLOATX8_NAMESPACE {
+namespace {
+
+	void store(const Vector3fx8 &vector, float out[3][LANES]) {
+		vector.store(out[0], out[1], out[2]);
+	}
+
+	void computeLanes(Lanes &lanes) {
+		const Vector3fx8 a = Vector3fx8::load(lanes.a[0], lanes.a[1], lanes.a[2]);
+		const Vector3fx8 b = Vector3fx8::load(lanes.b[0], lanes.b[1], lanes.b[2]);
+		const Floatx8 t = Floatx8::load(lanes.t);
+		const Barycentricx8 barycentric = Barycentricx8::load(lanes.barycentric[0], lanes.barycentric[1], lanes.barycentric[2]);
+
+		store(a + b, lanes.sum);
+		store(a - b, lanes.difference);
+		store(a * t, lanes.scaled);
+		store(a.cross(b), lanes.cross);
+		a.dot(b).store(lanes.dot);
+		a.magnitude().store(lanes.magnitude);
+		store(a.normalized(), lanes.normalized);
+		store(a.normalizedFast(), lanes.normalizedFast);
+		store(a.normalizedEstimate(), lanes.normalizedEstimate);
+		store(Vector3fx8::lerp(a, b, t), lanes.lerp);
+		barycentric.interpolate(lanes.vertices[0][0], lanes.vertices[1][0], lanes.vertices[2][0]).store(lanes.interpolated);
+		store(barycentric.interpolate(lanes.vertex(0), lanes.vertex(1), lanes.vertex(2)), lanes.interpolatedVector);
+	}
+}
+}
+FLOATX8_END_TARGET
+
+namespace {
+	struct Check {
+		const char *name;
+		// in ulps
+		double bound;
+		double worst;
+	};
+
+	double ulp(float value) {
+		const float magnitude = std::fabs(value);
+		return std::nextafter(magnitude, std::numeric_limits<float>::infinity()) - magnitude;
+	}
+
+	void compare(Check &check, float lane, double scalar, double scale) {
+		const double error = std::fabs(lane - scalar) / ulp(static_cast<float>(std::max(std::fabs(scalar), scale)));
+		// a NaN lane where the scalar result isn't one counts as unbounded
+		check.worst = std::max(check.worst, std::isnan(error) ? std::numeric_limits<double>::infinity() : error);
+	}
+
+	void compare(Check &check, const float lanes[3][LANES], int lane, const Vector3f &scalar, const Vector3f &scale) {
+		compare(check, lanes[0][lane], scalar.x, scale.x);
+		compare(check, lanes[1][lane], scalar.y, scale.y);
+		compare(check, lanes[2][lane], scalar.z, scale.z);
+	}
+
+	void compare(Check &check, const float lanes[3][LANES], int lane, const double exact[3], double scale) {
+		for (int i = 0; i < 3; i++) {
+			compare(check, lanes[i][lane], exact[i], scale);
+		}
+	}
+
+	Vector3f absolute(const Vector3f &v) {
+		return Vector3f(std::fabs(v.x), std::fabs(v.y), std::fabs(v.z));
+	}
+}
+
+int main(int argc, char **argv) {
+	const int batches = argc > 1 ? std::atoi(argv[1]) : 200000;
+	enum { ADD, SUBTRACT, SCALE, DOT, CROSS, MAGNITUDE, NORMALIZED, NORMALIZED_FAST, NORMALIZED_ESTIMATE, LERP, INTERPOLATE, INTERPOLATE_VECTOR, CHECK_COUNT };
+	// the normalize bounds are those of the doc comments, the rsqrt estimate is good to
+	// a relative 3.7e-4, 3104 ulps of a unit component
+	Check checks[CHECK_COUNT] = {
+		{ "operator+", 0.0, 0.0 },
+		{ "operator-", 0.0, 0.0 },
+		{ "operator*", 0.0, 0.0 },
+		{ "dot", 2.0, 0.0 },
+		{ "cross", 2.0, 0.0 },
+		{ "magnitude", 2.0, 0.0 },
+		{ "normalized", 3.0, 0.0 },
+		{ "normalizedFast", 6.0, 0.0 },
+		{ "normalizedEstimate", 3104.0, 0.0 },
+		{ "lerp", 2.0, 0.0 },
+		{ "interpolate", 2.0, 0.0 },
+		{ "interpolate vector", 2.0, 0.0 },
+	};
+
+	std::mt19937 random(45);
+	std::uniform_real_distribution<float> coordinate(-100.0f, 100.0f);
+	std::uniform_real_distribution<float> unit(0.0f, 1.0f);
+	Lanes lanes;
+	for (int batch = 0; batch < batches; batch++) {
+		for (int i = 0; i < LANES; i++) {
+			for (int j = 0; j < 3; j++) {
+				lanes.a[j][i] = coordinate(random);
+				lanes.b[j][i] = coordinate(random);
+			}
+			lanes.t[i] = unit(random);
+			// coordinates of a point in the triangle
+			lanes.barycentric[1][i] = unit(random);
+			lanes.barycentric[2][i] = unit(random) * (1.0f - lanes.barycentric[1][i]);
+			lanes.barycentric[0][i] = 1.0f - lanes.barycentric[1][i] - lanes.barycentric[2][i];
+		}
+		for (int i = 0; i < 3; i++) {
+			for (int j = 0; j < 3; j++) {
+				lanes.vertices[i][j] = coordinate(random);
+			}
+		}
+		FLOATX8_NAMESPACE::computeLanes(lanes);
+		const Vector3f v0 = lanes.vertex(0), v1 = lanes.vertex(1), v2 = lanes.vertex(2);
+
+		for (int i = 0; i < LANES; i++) {
+			const Vector3f a(lanes.a[0][i], lanes.a[1][i], lanes.a[2][i]), b(lanes.b[0][i], lanes.b[1][i], lanes.b[2][i]);
+			const float t = lanes.t[i], b0 = lanes.barycentric[0][i], b1 = lanes.barycentric[1][i], b2 = lanes.barycentric[2][i];
+			compare(checks[ADD], lanes.sum, i, a + b, Vector3f());
+			compare(checks[SUBTRACT], lanes.difference, i, a - b, Vector3f());
+			compare(checks[SCALE], lanes.scaled, i, a * t, Vector3f());
+
+			compare(checks[DOT], lanes.dot[i], a.dot(b), std::fabs(a.x * b.x) + std::fabs(a.y * b.y) + std::fabs(a.z * b.z));
+			const Vector3f crossScale(std::fabs(a.y * b.z) + std::fabs(a.z * b.y), std::fabs(a.z * b.x) + std::fabs(a.x * b.z), std::fabs(a.x * b.y) + std::fabs(a.y * b.x));
+			compare(checks[CROSS], lanes.cross, i, a.cross(b), crossScale);
+			compare(checks[MAGNITUDE], lanes.magnitude[i], a.magnitude(), 0.0f);
+
+			// far closer to the exact unit vector than a float ulp
+			const double length = std::sqrt(static_cast<double>(a.x) * a.x + static_cast<double>(a.y) * a.y + static_cast<double>(a.z) * a.z);
+			const double unitVector[3] = { a.x / length, a.y / length, a.z / length };
+			compare(checks[NORMALIZED], lanes.normalized, i, unitVector, 0.0);
+			compare(checks[NORMALIZED_FAST], lanes.normalizedFast, i, unitVector, 0.0);
+			compare(checks[NORMALIZED_ESTIMATE], lanes.normalizedEstimate, i, unitVector, 1.0);
+
+			compare(checks[LERP], lanes.lerp, i, a + (b - a) * t, absolute(a) + absolute(b - a) * t);
+			const Vector3f terms = absolute(v0) * b0 + absolute(v1) * b1 + absolute(v2) * b2;
+			compare(checks[INTERPOLATE], lanes.interpolated[i], v0.x * b0 + v1.x * b1 + v2.x * b2, terms.x);
+			compare(checks[INTERPOLATE_VECTOR], lanes.interpolatedVector, i, v0 * b0 + v1 * b1 + v2 * b2, terms);
+		}
+	}
+
+	int failures = 0;
+	for (const Check &check : checks) {
+		const bool passed = check.worst <= check.bound;
+		std::printf("%-20s %10.2f ulp, bound %7.1f: %s\n", check.name, check.worst, check.bound, passed ? "ok" : "FAILED");
+		failures += passed ? 0 : 1;
+	}
+	return failures == 0 ? 0 : 1;
+}
\ No newline at end of file
@@ -0,0 +1,64 @@
+// Converts a model and its textures into an asset pack that Mesh::loadAssetPack maps
+// in place, with the tangents, bounds and mip chains already computed.
+//
+// usage: AssetPacker model.obj diffuse normalmap specular output.pack [options]
+//   --tiled        tiled texture layout
+//   --compress     block compressed textures, see Mesh::setTextureCompression
+//   --material     packed material, see Mesh::packMaterial
+//   --no-mipmaps   only the base level of the textures
+#include <chrono>
+#include <cstdio>
+#include <cstring>
+#include <string>
+
+#include "../rasterizer/Mesh.h"
+
+int main(int argc, char **argv) {
+	if (argc < 6) {
+		std::printf("usage: %s model.obj diffuse normalmap specular output.pack [--tiled] [--compress] [--material] [--no-mipmaps]\n", argv[0]);
+		return 1;
+	}
+
+	bool material = false, mipmaps = true;
+	Mesh mesh;
+	for (int i = 6; i < argc; i++) {
+		if (std::strcmp(argv[i], "--tiled") == 0) {
+			mesh.setTextureLayout(TextureLayout::TILED);
+		} else if (std::strcmp(argv[i], "--compress") == 0) {
+			mesh.setTextureCompression(true);
+		} else if (std::strcmp(argv[i], "--material") == 0) {
+			material = true;
+		} else if (std::strcmp(argv[i], "--no-mipmaps") == 0) {
+			mipmaps = false;
+		} else {
+			std::printf("unknown option %s\n", argv[i]);
+			return 1;
+		}
+	}
+
+	auto start = std::chrono::high_resolution_clock::now();
+	mesh.loadObjFromFile(argv[1]);
+	mesh.loadDiffuseTexture(argv[2]);
+	mesh.loadNormalMap(argv[3]);
+	mesh.loadSpecularMap(argv[4]);
+	if (material) {
+		mesh.packMaterial();
+	}
+	const std::chrono::duration<double, std::milli> loadTime = std::chrono::high_resolution_clock::now() - start;
+
+	if (!mesh.saveAssetPack(argv[5], mipmaps)) {
+		std::printf("couldn't write %s\n", argv[5]);
+		return 1;
+	}
+
+	start = std::chrono::high_resolution_clock::now();
+	Mesh packed;
+	if (!packed.loadAssetPack(argv[5])) {
+		std::printf("couldn't read back %s\n", argv[5]);
+		return 1;
+	}
+	const std::chrono::duration<double, std::milli> packTime = std::chrono::high_resolution_clock::now() - start;
+
+	std::printf("%s: %d faces, loading the sources took %.1f ms and mapping the pack %.3f ms\n", argv[5], packed.getFacesCount(), loadTime.count(), packTime.count());
+	return 0;
+}
\ No newline at end of file
@@ -0,0 +1,69 @@
+// Converts a model into a chunk file that Mesh::loadChunkFile maps and the rasterizer
+// draws chunk by chunk, then walks every chunk of it under a small budget to check the
+// resident bytes stay bounded.
+//
+// usage: ChunkFileBuilder model.(obj|glb|stl|ply|pack) output.chunks [faces per chunk]
+#include <algorithm>
+#include <cctype>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <string>
+
+#include "../rasterizer/Mesh.h"
+
+int main(int argc, char **argv) {
+	if (argc < 3) {
+		std::printf("usage: %s model.(obj|glb|stl|ply|pack) output.chunks [faces per chunk]\n", argv[0]);
+		return 1;
+	}
+	const int facesPerChunk = argc > 3 ? std::atoi(argv[3]) : 16384;
+	if (facesPerChunk <= 0) {
+		std::printf("invalid faces per chunk %s\n", argv[3]);
+		return 1;
+	}
+
+	const std::string path = argv[1];
+	std::string extension = path.substr(path.find_last_of('.') + 1);
+	std::transform(extension.begin(), extension.end(), extension.begin(), ::tolower);
+
+	auto start = std::chrono::high_resolution_clock::now();
+	Mesh mesh;
+	if (extension == "glb") {
+		mesh.loadGlbFromFile(path);
+	} else if (extension == "stl" || extension == "ply") {
+		mesh.loadScanFromFile(path);
+	} else if (extension == "pack") {
+		if (!mesh.loadAssetPack(path)) {
+			std::printf("couldn't read %s\n", argv[1]);
+			return 1;
+		}
+	} else {
+		mesh.loadObjFromFile(path);
+	}
+	const std::chrono::duration<double, std::milli> loadTime = std::chrono::high_resolution_clock::now() - start;
+
+	start = std::chrono::high_resolution_clock::now();
+	if (!mesh.saveChunkFile(argv[2], facesPerChunk)) {
+		std::printf("couldn't write %s\n", argv[2]);
+		return 1;
+	}
+	const std::chrono::duration<double, std::milli> writeTime = std::chrono::high_resolution_clock::now() - start;
+
+	// every chunk in turn with room for about four of them
+	const size_t budget = static_cast<size_t>(facesPerChunk) * 4 * 128;
+	ChunkedGeometry chunks(argv[2], budget);
+	if (!chunks.isOpen()) {
+		std::printf("couldn't read back %s\n", argv[2]);
+		return 1;
+	}
+	size_t faces = 0, peakBytes = 0;
+	for (size_t i = 0; i < chunks.getChunkCount(); i++) {
+		faces += chunks.acquire(i).faces.size();
+		peakBytes = std::max(peakBytes, chunks.getResidentBytes());
+	}
+
+	std::printf("%d faces loaded in %.1f ms, written in %.1f ms\n", mesh.getFacesCount(), loadTime.count(), writeTime.count());
+	std::printf("%zu chunks, %zu faces read back, at most %.1f MB resident of a %.1f MB budget\n", chunks.getChunkCount(), faces, peakBytes / 1e6, budget / 1e6);
+	return faces == static_cast<size_t>(mesh.getFacesCount()) ? 0 : 1;
+}
\ No newline at end of file
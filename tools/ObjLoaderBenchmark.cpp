@@ -0,0 +1,160 @@
+// Compares the throughput of ObjFile with the stream based loader Mesh used before
+// it, on the bundled models and on a synthetic grid, and checks that both read the
+// same vertices and faces.
+//
+// usage: ObjLoaderBenchmark [grid size] [runs]
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <sstream>
+#include <string>
+#include <vector>
+
+#include "../rasterizer/ObjFile.h"
+
+namespace {
+	struct Model {
+		std::vector<Vector3f> vertices;
+		std::vector<Vector3f> textureCoordinates;
+		std::vector<Vector3f> normals;
+		std::vector<FaceVector> faces;
+	};
+
+	// the loader of Mesh before ObjFile, with polygons split in triangle fans as ObjFile
+	// does, so the results can be compared
+	void loadLegacy(const std::string &path, Model &model) {
+		std::ifstream file(path, std::ifstream::in);
+		float x, y, z;
+		std::string line;
+		std::string faceLine;
+		std::string indexValues;
+		int faceComponentIndex;
+		std::istringstream faceStream;
+		std::istringstream in;
+		Vector3i face;
+
+		while (std::getline(file, line)) {
+			in.clear();
+			in.str(line);
+
+			if (line[0] != '#') {
+				x = 0, y = 0, z = 0;
+
+				std::string type;
+				in >> type;
+
+				if (type == "v") {
+					in >> x >> y >> z;
+					model.vertices.emplace_back(x, y, z);
+				} else if (type == "vt") {
+					in >> x >> y;
+					model.textureCoordinates.emplace_back(x, y, 0);
+				} else if (type == "vn") {
+					in >> x >> y >> z;
+					model.normals.emplace_back(x, y, z);
+				} else if (type == "f") {
+					std::vector<Vector3i> vector;
+					while (std::getline(in, faceLine, ' ')) {
+						if (!faceLine.empty()) {
+							faceStream.clear();
+							faceStream.str(faceLine);
+
+							face = { 0,0,0 };
+							faceComponentIndex = 0;
+							while (std::getline(faceStream, indexValues, '/')) {
+								face[faceComponentIndex] = atoi(indexValues.c_str()) - 1;
+								++faceComponentIndex;
+							}
+							vector.push_back(face);
+						}
+					}
+					for (size_t i = 2; i < vector.size(); i++) {
+						FaceVector triangle = { { vector[0], vector[i - 1], vector[i] } };
+						model.faces.push_back(triangle);
+					}
+				}
+			}
+		}
+	}
+
+	// size x size quads split in two triangles, with every attribute
+	void writeGrid(const std::string &path, int size) {
+		FILE *file = std::fopen(path.c_str(), "w");
+		for (int y = 0; y <= size; y++) {
+			for (int x = 0; x <= size; x++) {
+				const float u = x / static_cast<float>(size), v = y / static_cast<float>(size);
+				std::fprintf(file, "v %f %f %f\nvt %f %f 0.0\nvn 0.0 0.0 1.0\n", u * 2.0f - 1.0f, v * 2.0f - 1.0f, 0.25f * u * v, u, v);
+			}
+		}
+		for (int y = 0; y < size; y++) {
+			for (int x = 0; x < size; x++) {
+				const int a = y * (size + 1) + x + 1, b = a + 1, c = a + size + 1, d = c + 1;
+				std::fprintf(file, "f %d/%d/%d %d/%d/%d %d/%d/%d\n", a, a, a, b, b, b, d, d, d);
+				std::fprintf(file, "f %d/%d/%d %d/%d/%d %d/%d/%d\n", a, a, a, d, d, d, c, c, c);
+			}
+		}
+		std::fclose(file);
+	}
+
+	bool sameVectors(const std::vector<Vector3f> &a, const std::vector<Vector3f> &b) {
+		return a.size() == b.size() && (a.empty() || std::memcmp(a.data(), b.data(), a.size() * sizeof(Vector3f)) == 0);
+	}
+
+	bool sameModels(const Model &a, const Model &b) {
+		if (!sameVectors(a.vertices, b.vertices) || !sameVectors(a.textureCoordinates, b.textureCoordinates) || !sameVectors(a.normals, b.normals) || a.faces.size() != b.faces.size()) {
+			return false;
+		}
+		for (size_t i = 0; i < a.faces.size(); i++) {
+			for (int j = 0; j < 3; j++) {
+				if (a.faces[i][j].x != b.faces[i][j].x || a.faces[i][j].y != b.faces[i][j].y || a.faces[i][j].z != b.faces[i][j].z) {
+					return false;
+				}
+			}
+		}
+		return true;
+	}
+
+	template <typename Load>
+	double megabytesPerSecond(const std::string &path, size_t bytes, int runs, Load load, Model &model) {
+		double best = 0.0;
+		for (int run = 0; run < runs; run++) {
+			model = Model();
+			const auto start = std::chrono::high_resolution_clock::now();
+			load(path, model);
+			const std::chrono::duration<double> seconds = std::chrono::high_resolution_clock::now() - start;
+			best = std::max(best, bytes / 1e6 / seconds.count());
+		}
+		return best;
+	}
+}
+
+int main(int argc, char **argv) {
+	const int gridSize = argc > 1 ? std::atoi(argv[1]) : 1000;
+	const int runs = argc > 2 ? std::atoi(argv[2]) : 3;
+
+	const std::string grid = "grid.obj";
+	writeGrid(grid, gridSize);
+	const std::string paths[] = { "assets/head.obj", "assets/diablo3.obj", "assets/shotgun.obj", grid };
+
+	std::printf("%-22s %10s %14s %14s %8s\n", "model", "MB", "legacy MB/s", "ObjFile MB/s", "same");
+	for (const std::string &path : paths) {
+		std::ifstream file(path, std::ifstream::binary | std::ifstream::ate);
+		if (!file.is_open()) {
+			std::printf("%-22s not found\n", path.c_str());
+			continue;
+		}
+		const size_t bytes = static_cast<size_t>(file.tellg());
+
+		Model legacy, parsed;
+		const double legacySpeed = megabytesPerSecond(path, bytes, runs, loadLegacy, legacy);
+		const double speed = megabytesPerSecond(path, bytes, runs, [](const std::string &path, Model &model) {
+			ObjFile::load(path, model.vertices, model.textureCoordinates, model.normals, model.faces);
+		}, parsed);
+		std::printf("%-22s %10.1f %14.1f %14.1f %8s\n", path.c_str(), bytes / 1e6, legacySpeed, speed, sameModels(legacy, parsed) ? "yes" : "no");
+	}
+	std::remove(grid.c_str());
+	return 0;
+}
\ No newline at end of file
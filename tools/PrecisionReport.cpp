@@ -0,0 +1,144 @@
+// Draws a model with every lit shader at every shading precision, without a window,
+// and compares the frames of the fast precisions with the exact ones: the largest and
+// the mean difference per colour channel, the share of pixels that differ by more than
+// the bound documented in ShadingPrecision, and the time per frame.
+//
+// usage: PrecisionReport [model] [frames]
+// model is the path of the obj file without extension, its textures are found next to
+// it as model_diffuse.png, model_nm.png and model_specular.png
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <limits>
+#include <string>
+#include <vector>
+
+#define SDL_MAIN_HANDLED
+
+#include "../rasterizer/Rasterizer.h"
+#include "../shaders/PhongShader.h"
+#include "../shaders/GouraudShader.h"
+#include "../shaders/ClampIlluminationShader.h"
+
+namespace {
+	struct Precision {
+		const char *name;
+		ShadingPrecision precision;
+	};
+
+	const Precision precisions[] = {
+		{ "exact", ShadingPrecision::EXACT },
+		{ "fast", ShadingPrecision::FAST },
+		{ "fastest", ShadingPrecision::FASTEST }
+	};
+
+	// largest difference per channel from EXACT documented in ShadingPrecision
+	const int bound = 1;
+
+	// camera positions the frames are drawn from, around the model
+	const float eyes[] = { -2.0f, -1.0f, 0.0f, 1.0f, 2.0f };
+
+	std::unique_ptr<Shader> createShader(int index) {
+		switch (index) {
+			case 0: return std::unique_ptr<Shader>(new PhongShader());
+			case 1: return std::unique_ptr<Shader>(new GouraudShader());
+			default: return std::unique_ptr<Shader>(new ClampIlluminationShader());
+		}
+	}
+
+	// Draws the frame of every camera position, frames times each, into images and
+	// returns the milliseconds per frame. The fastest of the frames of a position is
+	// kept, it is the least disturbed by the rest of the machine.
+	double draw(Rasterizer &rasterizer, Camera &camera, int frames, std::vector<std::vector<RGBA>> &images) {
+		const size_t pixels = Rasterizer::getScreenWidth() * Rasterizer::getScreenHeight();
+		double elapsed = 0.0;
+		images.clear();
+		for (float eye : eyes) {
+			camera.eye = Vector3f(eye, 0.5f, 3.0f);
+			rasterizer.setCamera(&camera);
+			double fastest = std::numeric_limits<double>::max();
+			for (int i = 0; i < frames; i++) {
+				rasterizer.clearBuffers();
+				const std::chrono::high_resolution_clock::time_point start = std::chrono::high_resolution_clock::now();
+				rasterizer.draw();
+				fastest = std::min(fastest, std::chrono::duration<double, std::milli>(std::chrono::high_resolution_clock::now() - start).count());
+			}
+			elapsed += fastest;
+			images.emplace_back(rasterizer.getFrameBuffer(), rasterizer.getFrameBuffer() + pixels);
+		}
+		return elapsed / (sizeof(eyes) / sizeof(eyes[0]));
+	}
+
+	struct Difference {
+		int max;
+		double mean;
+		// percentage of the pixels that differ by more than the bound
+		double aboveBound;
+	};
+
+	Difference compare(const std::vector<std::vector<RGBA>> &exact, const std::vector<std::vector<RGBA>> &images) {
+		Difference difference = { 0, 0.0, 0.0 };
+		size_t channels = 0, aboveBound = 0, pixels = 0;
+		for (size_t i = 0; i < exact.size(); i++) {
+			for (size_t p = 0; p < exact[i].size(); p++) {
+				const RGBA &a = exact[i][p], &b = images[i][p];
+				const int largest = std::max({ std::abs(a.red - b.red), std::abs(a.green - b.green), std::abs(a.blue - b.blue) });
+				difference.max = std::max(difference.max, largest);
+				difference.mean += std::abs(a.red - b.red) + std::abs(a.green - b.green) + std::abs(a.blue - b.blue);
+				channels += 3;
+				aboveBound += largest > bound;
+				pixels++;
+			}
+		}
+		difference.mean /= channels;
+		difference.aboveBound = 100.0 * aboveBound / pixels;
+		return difference;
+	}
+}
+
+int main(int argc, char **argv) {
+	const std::string model = argc > 1 ? argv[1] : "assets/diablo3";
+	const int frames = argc > 2 ? std::atoi(argv[2]) : 10;
+
+	Mesh mesh;
+	mesh.loadObjFromFile(model + ".obj");
+	mesh.loadDiffuseTexture(model + "_diffuse.png");
+	mesh.loadNormalMap(model + "_nm.png");
+	mesh.loadSpecularMap(model + "_specular.png");
+
+	Camera camera;
+	camera.eye = Vector3f(0.0f, 0.5f, 3.0f);
+	camera.center = Vector3f(0.0f, 0.0f, 0.0f);
+	camera.up = Vector3f(0.0f, 1.0f, 0.0f);
+
+	// no window, the frames stay in the frame buffer
+	Rasterizer rasterizer(&mesh, &camera);
+	rasterizer.createProjectionMatrix();
+	rasterizer.createViewportMatrix();
+	rasterizer.setLightPosition(Vector3f(0.0f, 0.0f, 1.0f));
+
+	const char *shaderNames[] = { "phong", "gouraud", "clamp" };
+	std::printf("%-8s %-8s %9s %8s %4s %8s %9s\n", "shader", "tier", "ms/frame", "speedup", "max", "mean", "% > bound");
+	for (int s = 0; s < 3; s++) {
+		std::unique_ptr<Shader> shader = createShader(s);
+		rasterizer.loadShader(shader);
+
+		std::vector<std::vector<RGBA>> exact, images;
+		double exactTime = 0.0;
+		for (const Precision &precision : precisions) {
+			rasterizer.setShadingPrecision(precision.precision);
+			const double time = draw(rasterizer, camera, frames, precision.precision == ShadingPrecision::EXACT ? exact : images);
+			if (precision.precision == ShadingPrecision::EXACT) {
+				exactTime = time;
+				std::printf("%-8s %-8s %9.2f %7.2fx\n", shaderNames[s], precision.name, time, 1.0);
+				continue;
+			}
+			const Difference difference = compare(exact, images);
+			std::printf("%-8s %-8s %9.2f %7.2fx %4d %8.4f %9.4f\n", shaderNames[s], precision.name, time, exactTime / time,
+				difference.max, difference.mean, difference.aboveBound);
+		}
+	}
+	return 0;
+}
\ No newline at end of file
@@ -0,0 +1,106 @@
+// Writes a tessellated sphere as a binary STL file, three unshared vertices per
+// triangle, and as a binary PLY file with shared vertices and normals, then streams
+// both back through ScanFile printing the progress and throughput.
+//
+// usage: ScanLoaderBenchmark [segments]
+#include <cmath>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <string>
+#include <vector>
+
+#include "../rasterizer/ScanFile.h"
+
+namespace {
+	const float PI = 3.14159265f;
+
+	Vector3f spherePoint(int ring, int segment, int segments) {
+		const float theta = PI * ring / segments, phi = 2.0f * PI * (segment % segments) / segments;
+		return Vector3f(std::sin(theta) * std::cos(phi), std::cos(theta), std::sin(theta) * std::sin(phi));
+	}
+
+	// two triangles per quad of the grid, the ones collapsed at the poles included
+	void sphereTriangles(int segments, std::vector<int> &indices) {
+		const int columns = segments + 1;
+		for (int ring = 0; ring < segments; ring++) {
+			for (int segment = 0; segment < segments; segment++) {
+				const int a = ring * columns + segment, b = a + 1, c = a + columns, d = c + 1;
+				const int corners[6] = { a, c, b, b, c, d };
+				indices.insert(indices.end(), corners, corners + 6);
+			}
+		}
+	}
+
+	void writeStl(const std::string &path, int segments) {
+		std::vector<int> indices;
+		sphereTriangles(segments, indices);
+		FILE *file = std::fopen(path.c_str(), "wb");
+		const char header[80] = "ScanLoaderBenchmark sphere";
+		const uint32_t count = static_cast<uint32_t>(indices.size() / 3);
+		std::fwrite(header, 1, sizeof(header), file);
+		std::fwrite(&count, sizeof(count), 1, file);
+		const int columns = segments + 1;
+		for (size_t i = 0; i < indices.size(); i += 3) {
+			float triangle[12] = {};
+			for (int j = 0; j < 3; j++) {
+				const Vector3f p = spherePoint(indices[i + j] / columns, indices[i + j] % columns, segments);
+				triangle[3 + j * 3] = p.x;
+				triangle[4 + j * 3] = p.y;
+				triangle[5 + j * 3] = p.z;
+			}
+			const uint16_t attributes = 0;
+			std::fwrite(triangle, sizeof(triangle), 1, file);
+			std::fwrite(&attributes, sizeof(attributes), 1, file);
+		}
+		std::fclose(file);
+	}
+
+	void writePly(const std::string &path, int segments) {
+		std::vector<int> indices;
+		sphereTriangles(segments, indices);
+		const int columns = segments + 1;
+		FILE *file = std::fopen(path.c_str(), "wb");
+		std::fprintf(file, "ply\nformat binary_little_endian 1.0\nelement vertex %d\nproperty float x\nproperty float y\nproperty float z\n", columns * columns);
+		std::fprintf(file, "property float nx\nproperty float ny\nproperty float nz\nelement face %d\nproperty list uchar int vertex_indices\nend_header\n", static_cast<int>(indices.size() / 3));
+		for (int i = 0; i < columns * columns; i++) {
+			const Vector3f p = spherePoint(i / columns, i % columns, segments);
+			const float vertex[6] = { p.x, p.y, p.z, p.x, p.y, p.z };
+			std::fwrite(vertex, sizeof(vertex), 1, file);
+		}
+		for (size_t i = 0; i < indices.size(); i += 3) {
+			const unsigned char count = 3;
+			std::fwrite(&count, 1, 1, file);
+			std::fwrite(&indices[i], sizeof(int), 3, file);
+		}
+		std::fclose(file);
+	}
+
+	template <typename Load>
+	void run(const char *name, const std::string &path, Load load) {
+		std::vector<Vector3f> vertices, normals;
+		std::vector<FaceVector> faces;
+		ScanFile::Progress last = {};
+		const bool loaded = load(path, vertices, normals, faces, [&last](const ScanFile::Progress &progress) {
+			if (progress.bytesRead * 4 / progress.totalBytes != last.bytesRead * 4 / progress.totalBytes) {
+				std::printf("  %3d%%  %8.1f MB/s  %zu vertices  %zu faces\n", static_cast<int>(progress.bytesRead * 100 / progress.totalBytes), progress.bytesRead / 1e6 / progress.seconds, progress.vertices, progress.faces);
+			}
+			last = progress;
+		});
+		const double meshBytes = static_cast<double>(vertices.capacity() + normals.capacity()) * sizeof(Vector3f) + faces.capacity() * sizeof(FaceVector);
+		std::printf("%s: %s, %.1f MB in %.2f s, %.1f MB/s, %zu vertices, %zu faces, %.1f MB of mesh\n", name, loaded ? "loaded" : "failed", last.totalBytes / 1e6, last.seconds, last.totalBytes / 1e6 / last.seconds, vertices.size(), faces.size(), meshBytes / 1e6);
+	}
+}
+
+int main(int argc, char **argv) {
+	const int segments = argc > 1 ? std::atoi(argv[1]) : 2000;
+	const std::string stl = "sphere.stl", ply = "sphere.ply";
+	writeStl(stl, segments);
+	writePly(ply, segments);
+
+	run("STL", stl, ScanFile::loadStl);
+	run("PLY", ply, ScanFile::loadPly);
+	std::remove(stl.c_str());
+	std::remove(ply.c_str());
+	return 0;
+}
\ No newline at end of file
@@ -0,0 +1,90 @@
+// Times diffuse lookups on a texture stored in the linear and in the tiled layout.
+// Every walk moves a 4x2 block of lanes one texel spacing per step, like a triangle
+// rasterized in that direction, so the differences come from the memory layout.
+//
+// usage: TextureLayoutBenchmark [texture] [steps]
+#include <cmath>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <string>
+
+#include "../rasterizer/Mesh.h"
+
+namespace {
+	struct Walk {
+		const char *name;
+		float dx, dy;
+	};
+
+	const Walk walks[] = {
+		{ "horizontal", 1.0f, 0.0f },
+		{ "vertical", 0.0f, 1.0f },
+		{ "diagonal", 1.0f, 1.0f },
+		{ "random", 0.0f, 0.0f }
+	};
+
+	// size of diablo3_diffuse.png, pass a texture of the same size
+	const int textureSize = 2844;
+
+	// nanoseconds per batch of the walk at a mip level
+	double run(const Mesh &mesh, const Walk &walk, int level, int steps, unsigned int &checksum) {
+		// one texel of the level in uv units, as Shader::textureLod would compute it
+		const float texel = std::ldexp(1.0f, level) / textureSize;
+		const Floatx8 lod(std::log2(texel));
+		const Floatx8 mask = Floatx8::fromMask(0xFF);
+
+		float laneU[Floatx8::LANES], laneV[Floatx8::LANES];
+		for (int i = 0; i < Floatx8::LANES; i++) {
+			laneU[i] = (i & 1) + ((i >> 2) << 1);
+			laneV[i] = (i >> 1) & 1;
+		}
+		const Floatx8 offsetU = Floatx8::load(laneU) * Floatx8(texel);
+		const Floatx8 offsetV = Floatx8::load(laneV) * Floatx8(texel);
+
+		unsigned int seed = 12345;
+		float u = 0.0f, v = 0.0f;
+		RGBA colours[Floatx8::LANES];
+		const std::chrono::high_resolution_clock::time_point start = std::chrono::high_resolution_clock::now();
+		for (int step = 0; step < steps; step++) {
+			if (walk.dx == 0.0f && walk.dy == 0.0f) {
+				seed = seed * 1664525u + 1013904223u;
+				u = (seed >> 8) * (1.0f / 16777216.0f);
+				seed = seed * 1664525u + 1013904223u;
+				v = (seed >> 8) * (1.0f / 16777216.0f);
+			} else {
+				// the block covers 4x2 texels, move to the next one and wrap around
+				u += walk.dx * 4.0f * texel;
+				v += walk.dy * 2.0f * texel;
+				u -= std::floor(u);
+				v -= std::floor(v);
+			}
+			mesh.getDiffuseColors(Floatx8(u) + offsetU, Floatx8(v) + offsetV, lod, mask, colours);
+			checksum += colours[0].red + colours[7].blue;
+		}
+		const std::chrono::duration<double, std::nano> elapsed = std::chrono::high_resolution_clock::now() - start;
+		return elapsed.count() / steps;
+	}
+}
+
+int main(int argc, char **argv) {
+	const std::string texture = argc > 1 ? argv[1] : "assets/diablo3_diffuse.png";
+	const int steps = argc > 2 ? std::atoi(argv[2]) : 4000000;
+
+	Mesh linear, tiled;
+	linear.loadDiffuseTexture(texture);
+	tiled.setTextureLayout(TextureLayout::TILED);
+	tiled.loadDiffuseTexture(texture);
+
+	unsigned int checksum = 0;
+	std::printf("%-12s %5s %12s %12s %8s\n", "walk", "level", "linear ns", "tiled ns", "speedup");
+	for (const Walk &walk : walks) {
+		for (int level = 0; level <= 2; level++) {
+			const double linearTime = run(linear, walk, level, steps, checksum);
+			const double tiledTime = run(tiled, walk, level, steps, checksum);
+			std::printf("%-12s %5d %12.2f %12.2f %7.2fx\n", walk.name, level, linearTime, tiledTime, linearTime / tiledTime);
+		}
+	}
+	std::printf("checksum %u\n", checksum);
+	return 0;
+}
\ No newline at end of file
@@ -0,0 +1,31 @@
+// Converts an image into a tile file for VirtualTexture, which Mesh loads for
+// textures with the .vt extension. The whole image is decoded here, only the
+// renderer keeps its memory bounded.
+//
+// usage: TileFileBuilder image tilefile [pagesize]
+#include <cstdio>
+#include <cstdlib>
+
+#include "../rasterizer/VirtualTexture.h"
+
+int main(int argc, char **argv) {
+	if (argc < 3) {
+		std::printf("usage: %s image tilefile [pagesize]\n", argv[0]);
+		return 1;
+	}
+
+	const int pageSize = argc > 3 ? std::atoi(argv[3]) : 128;
+	if (pageSize <= 0 || (pageSize & (pageSize - 1)) != 0) {
+		std::printf("page size must be a power of two\n");
+		return 1;
+	}
+
+	if (!VirtualTexture::createTileFile(argv[1], argv[2], pageSize)) {
+		std::printf("couldn't convert %s\n", argv[1]);
+		return 1;
+	}
+
+	VirtualTexture texture(argv[2], 1);
+	std::printf("%s: %d resident mip tail pages of %d x %d texels\n", argv[2], texture.getResidentPageCount(), pageSize, pageSize);
+	return 0;
+}
\ No newline at end of file
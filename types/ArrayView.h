@@ -0,0 +1,29 @@
+#pragma once
+
+#include <cassert>
+#include <cstddef>
+#include <vector>
+
+// Read only view of an array owned somewhere else, a vector or a memory mapping
+template <typename T>
+class ArrayView {
+public:
+	ArrayView() : first(nullptr), count(0) {}
+	ArrayView(const T *data, size_t size) : first(data), count(size) {}
+	ArrayView(const std::vector<T> &vector) : first(vector.data()), count(vector.size()) {}
+
+	const T* data() const { return first; }
+	size_t size() const { return count; }
+	bool empty() const { return count == 0; }
+	const T* begin() const { return first; }
+	const T* end() const { return first + count; }
+
+	const T& operator[](size_t index) const {
+		assert(index < count);
+		return first[index];
+	}
+
+private:
+	const T *first;
+	size_t count;
+};
\ No newline at end of file
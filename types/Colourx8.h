@@ -0,0 +1,133 @@
+#pragma once
+
+#include "Floatx8.h"
+#include "Types.h"
+
+FLOATX8_BEGIN_TARGET
+namespace FLOATX8_NAMESPACE {
+
+// Eight RGBA colours with every channel widened to 16 bits, the integer colour path of
+// the fragment stage. Bytes are widened once, scaled by light intensities in 8.8 fixed
+// point with 16 bit multiplies, 16 channels per instruction with AVX2, and packed back
+// to bytes with saturation. Every version gives the same bytes as RGBA::applyLightIntensity.
+//
+// scale multiplies red, green and blue by intensities in 8.8 fixed point below 2^15 (see
+// RGBA::fixedIntensity) and truncates, alpha is kept. Channels above 255 stay in their 16
+// bits until store saturates them.
+class Colourx8 {
+public:
+	static const int LANES = 8;
+
+#if defined(FLOATX8_AVX2)
+	// colours 0, 1, 4 and 5 in lo and 2, 3, 6 and 7 in hi, the order of the byte unpacks
+	__m256i lo, hi;
+
+	static Colourx8 load(const RGBA colours[LANES]) {
+		const __m256i packed = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(colours));
+		return Colourx8(_mm256_unpacklo_epi8(packed, _mm256_setzero_si256()), _mm256_unpackhi_epi8(packed, _mm256_setzero_si256()));
+	}
+
+	void store(RGBA colours[LANES]) const {
+		_mm256_storeu_si256(reinterpret_cast<__m256i*>(colours), _mm256_packus_epi16(lo, hi));
+	}
+
+	Colourx8 scale(const Intx8 &intensities) const {
+		const __m256i keepAlpha = _mm256_set1_epi64x(0x0000FFFFFFFFFFFFll);
+		const __m256i alpha = _mm256_set1_epi64x(0x0100000000000000ll);
+		const __m256i low = _mm256_permutevar8x32_epi32(intensities.v, _mm256_setr_epi32(0, 0, 1, 1, 4, 4, 5, 5));
+		const __m256i high = _mm256_permutevar8x32_epi32(intensities.v, _mm256_setr_epi32(2, 2, 3, 3, 6, 6, 7, 7));
+		return Colourx8(multiply(lo, channelFactors(low, keepAlpha, alpha)), multiply(hi, channelFactors(high, keepAlpha, alpha)));
+	}
+
+private:
+	Colourx8(__m256i lo, __m256i hi) : lo(lo), hi(hi) {}
+
+	// the intensity of every colour in its red, green and blue, 256 in its alpha
+	static __m256i channelFactors(__m256i intensities, __m256i keepAlpha, __m256i alpha) {
+		return _mm256_or_si256(_mm256_and_si256(_mm256_or_si256(intensities, _mm256_slli_epi32(intensities, 16)), keepAlpha), alpha);
+	}
+
+	// (channel << 8) * factor >> 16 is channel * factor >> 8
+	static __m256i multiply(__m256i channels, __m256i factors) {
+		return _mm256_mulhi_epu16(_mm256_slli_epi16(channels, 8), factors);
+	}
+#elif defined(FLOATX8_SSE2)
+	// two colours per register, in order
+	__m128i v[4];
+
+	static Colourx8 load(const RGBA colours[LANES]) {
+		const __m128i first = _mm_loadu_si128(reinterpret_cast<const __m128i*>(colours));
+		const __m128i second = _mm_loadu_si128(reinterpret_cast<const __m128i*>(colours + 4));
+		Colourx8 r;
+		r.v[0] = _mm_unpacklo_epi8(first, _mm_setzero_si128());
+		r.v[1] = _mm_unpackhi_epi8(first, _mm_setzero_si128());
+		r.v[2] = _mm_unpacklo_epi8(second, _mm_setzero_si128());
+		r.v[3] = _mm_unpackhi_epi8(second, _mm_setzero_si128());
+		return r;
+	}
+
+	void store(RGBA colours[LANES]) const {
+		_mm_storeu_si128(reinterpret_cast<__m128i*>(colours), _mm_packus_epi16(v[0], v[1]));
+		_mm_storeu_si128(reinterpret_cast<__m128i*>(colours + 4), _mm_packus_epi16(v[2], v[3]));
+	}
+
+	Colourx8 scale(const Intx8 &intensities) const {
+		const __m128i keepAlpha = _mm_set_epi16(0, -1, -1, -1, 0, -1, -1, -1);
+		const __m128i alpha = _mm_set_epi16(256, 0, 0, 0, 256, 0, 0, 0);
+		const __m128i factors[4] = {
+			_mm_shuffle_epi32(intensities.lo, _MM_SHUFFLE(1, 1, 0, 0)),
+			_mm_shuffle_epi32(intensities.lo, _MM_SHUFFLE(3, 3, 2, 2)),
+			_mm_shuffle_epi32(intensities.hi, _MM_SHUFFLE(1, 1, 0, 0)),
+			_mm_shuffle_epi32(intensities.hi, _MM_SHUFFLE(3, 3, 2, 2))
+		};
+		Colourx8 r;
+		for (int i = 0; i < 4; i++) {
+			// the intensity of every colour in its red, green and blue, 256 in its alpha
+			const __m128i factor = _mm_or_si128(_mm_and_si128(_mm_or_si128(factors[i], _mm_slli_epi32(factors[i], 16)), keepAlpha), alpha);
+			// (channel << 8) * factor >> 16 is channel * factor >> 8
+			r.v[i] = _mm_mulhi_epu16(_mm_slli_epi16(v[i], 8), factor);
+		}
+		return r;
+	}
+#else
+	unsigned short channels[LANES][4];
+
+	static Colourx8 load(const RGBA colours[LANES]) {
+		Colourx8 r;
+		for (int i = 0; i < LANES; i++) {
+			r.channels[i][0] = colours[i].red;
+			r.channels[i][1] = colours[i].green;
+			r.channels[i][2] = colours[i].blue;
+			r.channels[i][3] = colours[i].alpha;
+		}
+		return r;
+	}
+
+	void store(RGBA colours[LANES]) const {
+		for (int i = 0; i < LANES; i++) {
+			colours[i].red = saturate(channels[i][0]);
+			colours[i].green = saturate(channels[i][1]);
+			colours[i].blue = saturate(channels[i][2]);
+			colours[i].alpha = saturate(channels[i][3]);
+		}
+	}
+
+	Colourx8 scale(const Intx8 &intensities) const {
+		Colourx8 r;
+		for (int i = 0; i < LANES; i++) {
+			for (int c = 0; c < 3; c++) {
+				r.channels[i][c] = static_cast<unsigned short>((channels[i][c] * intensities.lanes[i]) >> 8);
+			}
+			r.channels[i][3] = channels[i][3];
+		}
+		return r;
+	}
+
+private:
+	static byte saturate(unsigned short channel) { return channel > 255 ? 255 : static_cast<byte>(channel); }
+#endif
+};
+}
+FLOATX8_END_TARGET
+
+using FLOATX8_NAMESPACE::Colourx8;
\ No newline at end of file
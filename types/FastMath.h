@@ -0,0 +1,97 @@
+#pragma once
+
+#include <cfloat>
+
+#include "Floatx8.h"
+
+FLOATX8_BEGIN_TARGET
+namespace FLOATX8_NAMESPACE {
+
+// Polynomial approximations of the transcendental functions of the fragment stage.
+// The float is split in its exponent, which is exact, and its mantissa, which goes
+// through a minimax polynomial. The coarse versions use lower degrees.
+namespace FastMath {
+
+	namespace detail {
+		// exponent and mantissa in [1, 2) of positive normal floats
+		inline void split(const Floatx8 &x, Floatx8 &exponent, Floatx8 &mantissa) {
+			const Intx8 bits = x.asBits();
+			exponent = (((bits >> 23) & Intx8(0xFF)) - Intx8(127)).toFloat();
+			mantissa = ((bits & Intx8(0x007FFFFF)) | Intx8(0x3F800000)).asFloat();
+		}
+
+		// 2^exponent times mantissa, for integer exponents in [-125, 127] and mantissas near [1, 2)
+		inline Floatx8 scale(const Floatx8 &mantissa, const Floatx8 &exponent) {
+			return (mantissa.asBits() + (exponent.toInt() << 23)).asFloat();
+		}
+
+		// Zero bases are raised like the smallest normal float, which is far from zero for
+		// exponents below one. pow(0, exponent) is 0, or 1 for a zero exponent.
+		inline Floatx8 powOfZero(const Floatx8 &base, const Floatx8 &exponent, const Floatx8 &result) {
+			return Floatx8::select(base > Floatx8(0.0f), result, Floatx8::select(exponent > Floatx8(0.0f), Floatx8(0.0f), Floatx8(1.0f)));
+		}
+	}
+
+	// log2 of positive normal floats, within 1.2e-5 of the exact result
+	inline Floatx8 log2(const Floatx8 &x) {
+		Floatx8 exponent, m;
+		detail::split(x, exponent, m);
+		// log2(m) / (m - 1) on [1, 2], exact at m = 1
+		Floatx8 p = Floatx8(-0.0353869676f) * m + Floatx8(0.325348293f);
+		p = p * m + Floatx8(-1.25264604f);
+		p = p * m + Floatx8(2.62963888f);
+		p = p * m + Floatx8(-3.34631777f);
+		p = p * m + Floatx8(3.12204841f);
+		return exponent + (m - Floatx8(1.0f)) * p;
+	}
+
+	// 2^x within a relative error of 2.7e-6, clamped to [2^-125, 2^127] so that results stay normal
+	inline Floatx8 exp2(const Floatx8 &x) {
+		const Floatx8 clamped = Floatx8::min(Floatx8::max(x, Floatx8(-125.0f)), Floatx8(127.0f));
+		const Floatx8 whole = Floatx8::floor(clamped);
+		const Floatx8 f = clamped - whole;
+		// 2^f on [0, 1]
+		Floatx8 p = Floatx8(0.0135341681f) * f + Floatx8(0.0520114603f);
+		p = p * f + Floatx8(0.241442757f);
+		p = p * f + Floatx8(0.693003834f);
+		p = p * f + Floatx8(1.00000259f);
+		return detail::scale(p, whole);
+	}
+
+	// base^exponent for bases in [0, 1] and non negative exponents, pow(0, 0) is 1 like
+	// std::pow. Within 1.9e-3 of the exact result for exponents up to 255.
+	inline Floatx8 pow(const Floatx8 &base, const Floatx8 &exponent) {
+		return detail::powOfZero(base, exponent, exp2(exponent * log2(Floatx8::max(base, Floatx8(FLT_MIN)))));
+	}
+
+	// log2 within 4.8e-4 of the exact result
+	inline Floatx8 log2Coarse(const Floatx8 &x) {
+		Floatx8 exponent, m;
+		detail::split(x, exponent, m);
+		Floatx8 p = Floatx8(-0.11003217f) * m + Floatx8(0.700756876f);
+		p = p * m + Floatx8(-1.77474048f);
+		p = p * m + Floatx8(2.62623252f);
+		return exponent + (m - Floatx8(1.0f)) * p;
+	}
+
+	// 2^x within a relative error of 7.5e-5
+	inline Floatx8 exp2Coarse(const Floatx8 &x) {
+		const Floatx8 clamped = Floatx8::min(Floatx8::max(x, Floatx8(-125.0f)), Floatx8(127.0f));
+		const Floatx8 whole = Floatx8::floor(clamped);
+		const Floatx8 f = clamped - whole;
+		Floatx8 p = Floatx8(0.0780245227f) * f + Floatx8(0.226067155f);
+		p = p * f + Floatx8(0.69583354f);
+		p = p * f + Floatx8(0.999925219f);
+		return detail::scale(p, whole);
+	}
+
+	// pow through the coarse versions, within 8e-2 of the exact result for exponents up to 255
+	inline Floatx8 powCoarse(const Floatx8 &base, const Floatx8 &exponent) {
+		return detail::powOfZero(base, exponent, exp2Coarse(exponent * log2Coarse(Floatx8::max(base, Floatx8(FLT_MIN)))));
+	}
+}
+
+}
+FLOATX8_END_TARGET
+
+namespace FastMath = FLOATX8_NAMESPACE::FastMath;
\ No newline at end of file
@@ -0,0 +1,483 @@
+#pragma once
+
+#include <cmath>
+#include <cstddef>
+#include <cstring>
+
+// Instruction sets Floatx8 can be built for. A translation unit builds it for
+// FLOATX8_ISA when that is defined before the first include, and for the baseline of
+// the compiler flags otherwise. Each one lives in its own namespace, so translation
+// units built for different instruction sets never share a definition (see CpuDispatch).
+#define FLOATX8_ISA_SCALAR 0
+#define FLOATX8_ISA_SSE2 1
+#define FLOATX8_ISA_SSE42 2
+#define FLOATX8_ISA_AVX2 3
+#define FLOATX8_ISA_AVX512 4
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define FLOATX8_X86
+#endif
+
+#ifndef FLOATX8_ISA
+#ifdef FLOATX8_X86
+#define FLOATX8_ISA FLOATX8_ISA_SSE2
+#else
+#define FLOATX8_ISA FLOATX8_ISA_SCALAR
+#endif
+#endif
+
+#define FLOATX8_STRING(text) #text
+#if defined(__clang__)
+#define FLOATX8_TARGET(features) _Pragma(FLOATX8_STRING(clang attribute push(__attribute__((target(features))), apply_to = function))) _Pragma("clang fp contract(off)")
+#define FLOATX8_END_TARGET _Pragma("clang attribute pop")
+#elif defined(__GNUC__)
+#define FLOATX8_TARGET(features) _Pragma("GCC push_options") _Pragma(FLOATX8_STRING(GCC target(features))) _Pragma("GCC optimize(\"fp-contract=off\")")
+#define FLOATX8_END_TARGET _Pragma("GCC pop_options")
+#else
+// MSVC accepts the intrinsics of every instruction set without flags
+#define FLOATX8_TARGET(features)
+#define FLOATX8_END_TARGET
+#endif
+
+// Code between FLOATX8_BEGIN_TARGET and FLOATX8_END_TARGET is compiled for the
+// instruction set of the translation unit, with contraction to fused multiply adds
+// turned off: they round differently and every instruction set has to draw the same image.
+#if FLOATX8_ISA == FLOATX8_ISA_AVX512
+#define FLOATX8_NAMESPACE simd_avx512
+#define FLOATX8_BEGIN_TARGET FLOATX8_TARGET("avx2,avx512f,avx512vl,avx512bw,avx512dq")
+#elif FLOATX8_ISA == FLOATX8_ISA_AVX2
+#define FLOATX8_NAMESPACE simd_avx2
+#define FLOATX8_BEGIN_TARGET FLOATX8_TARGET("avx2")
+#elif FLOATX8_ISA == FLOATX8_ISA_SSE42
+#define FLOATX8_NAMESPACE simd_sse42
+#define FLOATX8_BEGIN_TARGET FLOATX8_TARGET("sse4.2,popcnt")
+#elif FLOATX8_ISA == FLOATX8_ISA_SSE2
+#define FLOATX8_NAMESPACE simd_sse2
+#define FLOATX8_BEGIN_TARGET
+#undef FLOATX8_END_TARGET
+#define FLOATX8_END_TARGET
+#else
+#define FLOATX8_NAMESPACE simd_scalar
+#define FLOATX8_BEGIN_TARGET
+#undef FLOATX8_END_TARGET
+#define FLOATX8_END_TARGET
+#endif
+
+// layout of the lanes: one 256 bit register, two 128 bit registers or plain arrays
+#ifdef FLOATX8_X86
+#if FLOATX8_ISA >= FLOATX8_ISA_AVX2
+#define FLOATX8_AVX2
+#include <immintrin.h>
+#elif FLOATX8_ISA >= FLOATX8_ISA_SSE2
+#define FLOATX8_SSE2
+#include <emmintrin.h>
+#if FLOATX8_ISA >= FLOATX8_ISA_SSE42
+#define FLOATX8_SSE41
+#include <smmintrin.h>
+#endif
+#endif
+#endif
+
+FLOATX8_BEGIN_TARGET
+namespace FLOATX8_NAMESPACE {
+
+class Intx8;
+
+// Eight float lanes processed together. With AVX2 every operation runs on a 256 bit
+// register, with SSE2 on two 128 bit registers, otherwise it falls back to plain loops
+// over the lanes. Every version rounds the same, only rsqrt is approximate.
+class Floatx8 {
+public:
+	static const int LANES = 8;
+
+#if defined(FLOATX8_AVX2)
+	__m256 v;
+
+	Floatx8() : v(_mm256_setzero_ps()) {}
+	Floatx8(float scalar) : v(_mm256_set1_ps(scalar)) {}
+	explicit Floatx8(__m256 v) : v(v) {}
+
+	static Floatx8 load(const float *data) { return Floatx8(_mm256_loadu_ps(data)); }
+	void store(float *data) const { _mm256_storeu_ps(data, v); }
+
+	// two 2x2 quads from the rows top and bottom, in the lane order of FragmentBatch
+	static Floatx8 loadQuads(const float *top, const float *bottom) {
+		const __m256 rows = _mm256_insertf128_ps(_mm256_castps128_ps256(_mm_loadu_ps(top)), _mm_loadu_ps(bottom), 1);
+		return Floatx8(_mm256_castpd_ps(_mm256_permute4x64_pd(_mm256_castps_pd(rows), _MM_SHUFFLE(3, 1, 2, 0))));
+	}
+	void storeQuads(float *top, float *bottom) const {
+		const __m256 rows = _mm256_castpd_ps(_mm256_permute4x64_pd(_mm256_castps_pd(v), _MM_SHUFFLE(3, 1, 2, 0)));
+		_mm_storeu_ps(top, _mm256_castps256_ps128(rows));
+		_mm_storeu_ps(bottom, _mm256_extractf128_ps(rows, 1));
+	}
+
+	Floatx8 operator+(const Floatx8 &other) const { return Floatx8(_mm256_add_ps(v, other.v)); }
+	Floatx8 operator-(const Floatx8 &other) const { return Floatx8(_mm256_sub_ps(v, other.v)); }
+	Floatx8 operator*(const Floatx8 &other) const { return Floatx8(_mm256_mul_ps(v, other.v)); }
+	Floatx8 operator/(const Floatx8 &other) const { return Floatx8(_mm256_div_ps(v, other.v)); }
+
+	// comparisons return a lane mask with all bits set where the test passed
+	Floatx8 operator<(const Floatx8 &other) const { return Floatx8(_mm256_cmp_ps(v, other.v, _CMP_LT_OQ)); }
+	Floatx8 operator>(const Floatx8 &other) const { return Floatx8(_mm256_cmp_ps(v, other.v, _CMP_GT_OQ)); }
+	Floatx8 operator>=(const Floatx8 &other) const { return Floatx8(_mm256_cmp_ps(v, other.v, _CMP_GE_OQ)); }
+	Floatx8 operator&(const Floatx8 &other) const { return Floatx8(_mm256_and_ps(v, other.v)); }
+
+	static Floatx8 min(const Floatx8 &a, const Floatx8 &b) { return Floatx8(_mm256_min_ps(a.v, b.v)); }
+	static Floatx8 max(const Floatx8 &a, const Floatx8 &b) { return Floatx8(_mm256_max_ps(a.v, b.v)); }
+	static Floatx8 sqrt(const Floatx8 &a) { return Floatx8(_mm256_sqrt_ps(a.v)); }
+#if FLOATX8_ISA >= FLOATX8_ISA_AVX512
+	// approximate 1 / sqrt(a), relative error at most 2^-14
+	static Floatx8 rsqrt(const Floatx8 &a) { return Floatx8(_mm256_rsqrt14_ps(a.v)); }
+#else
+	// approximate 1 / sqrt(a), relative error at most 1.5 * 2^-12
+	static Floatx8 rsqrt(const Floatx8 &a) { return Floatx8(_mm256_rsqrt_ps(a.v)); }
+#endif
+	static Floatx8 floor(const Floatx8 &a) { return Floatx8(_mm256_floor_ps(a.v)); }
+
+	// picks lanes of a where mask is set and lanes of b elsewhere
+	static Floatx8 select(const Floatx8 &mask, const Floatx8 &a, const Floatx8 &b) { return Floatx8(_mm256_blendv_ps(b.v, a.v, mask.v)); }
+
+	// one bit per lane, lane 0 in the lowest bit
+	int movemask() const { return _mm256_movemask_ps(v); }
+
+	// lane mask from the bits of movemask()
+	static Floatx8 fromMask(int bits) {
+		const __m256i laneBits = _mm256_setr_epi32(1, 2, 4, 8, 16, 32, 64, 128);
+		return Floatx8(_mm256_castsi256_ps(_mm256_cmpeq_epi32(_mm256_and_si256(_mm256_set1_epi32(bits), laneBits), laneBits)));
+	}
+
+	// writes value to count floats of data
+	static void fill(float *data, size_t count, float value) {
+		size_t i = 0;
+#if FLOATX8_ISA >= FLOATX8_ISA_AVX512
+		const __m512 wide = _mm512_set1_ps(value);
+		for (; i + 16 <= count; i += 16) {
+			_mm512_storeu_ps(data + i, wide);
+		}
+#endif
+		const __m256 lanes = _mm256_set1_ps(value);
+		for (; i + LANES <= count; i += LANES) {
+			_mm256_storeu_ps(data + i, lanes);
+		}
+		for (; i < count; i++) {
+			data[i] = value;
+		}
+	}
+
+	float operator[](int lane) const {
+		float lanes[LANES];
+		store(lanes);
+		return lanes[lane];
+	}
+#elif defined(FLOATX8_SSE2)
+	__m128 lo, hi;
+
+	Floatx8() : lo(_mm_setzero_ps()), hi(_mm_setzero_ps()) {}
+	Floatx8(float scalar) : lo(_mm_set1_ps(scalar)), hi(_mm_set1_ps(scalar)) {}
+	Floatx8(__m128 lo, __m128 hi) : lo(lo), hi(hi) {}
+
+	static Floatx8 load(const float *data) { return Floatx8(_mm_loadu_ps(data), _mm_loadu_ps(data + 4)); }
+	void store(float *data) const { _mm_storeu_ps(data, lo); _mm_storeu_ps(data + 4, hi); }
+
+	// two 2x2 quads from the rows top and bottom, in the lane order of FragmentBatch
+	static Floatx8 loadQuads(const float *top, const float *bottom) {
+		const __m128 upper = _mm_loadu_ps(top), lower = _mm_loadu_ps(bottom);
+		return Floatx8(_mm_movelh_ps(upper, lower), _mm_movehl_ps(lower, upper));
+	}
+	void storeQuads(float *top, float *bottom) const {
+		_mm_storeu_ps(top, _mm_movelh_ps(lo, hi));
+		_mm_storeu_ps(bottom, _mm_movehl_ps(hi, lo));
+	}
+
+	Floatx8 operator+(const Floatx8 &other) const { return Floatx8(_mm_add_ps(lo, other.lo), _mm_add_ps(hi, other.hi)); }
+	Floatx8 operator-(const Floatx8 &other) const { return Floatx8(_mm_sub_ps(lo, other.lo), _mm_sub_ps(hi, other.hi)); }
+	Floatx8 operator*(const Floatx8 &other) const { return Floatx8(_mm_mul_ps(lo, other.lo), _mm_mul_ps(hi, other.hi)); }
+	Floatx8 operator/(const Floatx8 &other) const { return Floatx8(_mm_div_ps(lo, other.lo), _mm_div_ps(hi, other.hi)); }
+
+	// comparisons return a lane mask with all bits set where the test passed
+	Floatx8 operator<(const Floatx8 &other) const { return Floatx8(_mm_cmplt_ps(lo, other.lo), _mm_cmplt_ps(hi, other.hi)); }
+	Floatx8 operator>(const Floatx8 &other) const { return Floatx8(_mm_cmpgt_ps(lo, other.lo), _mm_cmpgt_ps(hi, other.hi)); }
+	Floatx8 operator>=(const Floatx8 &other) const { return Floatx8(_mm_cmpge_ps(lo, other.lo), _mm_cmpge_ps(hi, other.hi)); }
+	Floatx8 operator&(const Floatx8 &other) const { return Floatx8(_mm_and_ps(lo, other.lo), _mm_and_ps(hi, other.hi)); }
+
+	static Floatx8 min(const Floatx8 &a, const Floatx8 &b) { return Floatx8(_mm_min_ps(a.lo, b.lo), _mm_min_ps(a.hi, b.hi)); }
+	static Floatx8 max(const Floatx8 &a, const Floatx8 &b) { return Floatx8(_mm_max_ps(a.lo, b.lo), _mm_max_ps(a.hi, b.hi)); }
+	static Floatx8 sqrt(const Floatx8 &a) { return Floatx8(_mm_sqrt_ps(a.lo), _mm_sqrt_ps(a.hi)); }
+	// approximate 1 / sqrt(a), relative error at most 1.5 * 2^-12
+	static Floatx8 rsqrt(const Floatx8 &a) { return Floatx8(_mm_rsqrt_ps(a.lo), _mm_rsqrt_ps(a.hi)); }
+
+#ifdef FLOATX8_SSE41
+	static Floatx8 floor(const Floatx8 &a) { return Floatx8(_mm_floor_ps(a.lo), _mm_floor_ps(a.hi)); }
+
+	// picks lanes of a where mask is set and lanes of b elsewhere
+	static Floatx8 select(const Floatx8 &mask, const Floatx8 &a, const Floatx8 &b) {
+		return Floatx8(_mm_blendv_ps(b.lo, a.lo, mask.lo), _mm_blendv_ps(b.hi, a.hi, mask.hi));
+	}
+#else
+	// SSE2 has no rounding instruction, truncate and step down the negative lanes
+	static Floatx8 floor(const Floatx8 &a) {
+		const Floatx8 truncated(_mm_cvtepi32_ps(_mm_cvttps_epi32(a.lo)), _mm_cvtepi32_ps(_mm_cvttps_epi32(a.hi)));
+		return truncated - ((truncated > a) & Floatx8(1.0f));
+	}
+
+	// picks lanes of a where mask is set and lanes of b elsewhere
+	static Floatx8 select(const Floatx8 &mask, const Floatx8 &a, const Floatx8 &b) {
+		return Floatx8(_mm_or_ps(_mm_and_ps(mask.lo, a.lo), _mm_andnot_ps(mask.lo, b.lo)),
+			_mm_or_ps(_mm_and_ps(mask.hi, a.hi), _mm_andnot_ps(mask.hi, b.hi)));
+	}
+#endif
+
+	// one bit per lane, lane 0 in the lowest bit
+	int movemask() const { return _mm_movemask_ps(lo) | (_mm_movemask_ps(hi) << 4); }
+
+	// lane mask from the bits of movemask()
+	static Floatx8 fromMask(int bits) {
+		const __m128i laneBits = _mm_setr_epi32(1, 2, 4, 8);
+		const __m128i loBits = _mm_and_si128(_mm_set1_epi32(bits), laneBits);
+		const __m128i hiBits = _mm_and_si128(_mm_set1_epi32(bits >> 4), laneBits);
+		return Floatx8(_mm_castsi128_ps(_mm_cmpeq_epi32(loBits, laneBits)), _mm_castsi128_ps(_mm_cmpeq_epi32(hiBits, laneBits)));
+	}
+
+	// writes value to count floats of data
+	static void fill(float *data, size_t count, float value) {
+		const __m128 lanes = _mm_set1_ps(value);
+		size_t i = 0;
+		for (; i + 4 <= count; i += 4) {
+			_mm_storeu_ps(data + i, lanes);
+		}
+		for (; i < count; i++) {
+			data[i] = value;
+		}
+	}
+
+	float operator[](int lane) const {
+		float lanes[LANES];
+		store(lanes);
+		return lanes[lane];
+	}
+#else
+	float lanes[LANES];
+
+	Floatx8() { for (int i = 0; i < LANES; i++) lanes[i] = 0.0f; }
+	Floatx8(float scalar) { for (int i = 0; i < LANES; i++) lanes[i] = scalar; }
+
+	static Floatx8 load(const float *data) { Floatx8 r; for (int i = 0; i < LANES; i++) r.lanes[i] = data[i]; return r; }
+	void store(float *data) const { for (int i = 0; i < LANES; i++) data[i] = lanes[i]; }
+
+	static Floatx8 loadQuads(const float *top, const float *bottom) { Floatx8 r; for (int i = 0; i < LANES; i++) r.lanes[i] = quadRow(top, bottom, i)[quadColumn(i)]; return r; }
+	void storeQuads(float *top, float *bottom) const { for (int i = 0; i < LANES; i++) quadRow(top, bottom, i)[quadColumn(i)] = lanes[i]; }
+
+	Floatx8 operator+(const Floatx8 &other) const { Floatx8 r; for (int i = 0; i < LANES; i++) r.lanes[i] = lanes[i] + other.lanes[i]; return r; }
+	Floatx8 operator-(const Floatx8 &other) const { Floatx8 r; for (int i = 0; i < LANES; i++) r.lanes[i] = lanes[i] - other.lanes[i]; return r; }
+	Floatx8 operator*(const Floatx8 &other) const { Floatx8 r; for (int i = 0; i < LANES; i++) r.lanes[i] = lanes[i] * other.lanes[i]; return r; }
+	Floatx8 operator/(const Floatx8 &other) const { Floatx8 r; for (int i = 0; i < LANES; i++) r.lanes[i] = lanes[i] / other.lanes[i]; return r; }
+
+	Floatx8 operator<(const Floatx8 &other) const { Floatx8 r; for (int i = 0; i < LANES; i++) r.lanes[i] = lanes[i] < other.lanes[i] ? allBits() : 0.0f; return r; }
+	Floatx8 operator>(const Floatx8 &other) const { Floatx8 r; for (int i = 0; i < LANES; i++) r.lanes[i] = lanes[i] > other.lanes[i] ? allBits() : 0.0f; return r; }
+	Floatx8 operator>=(const Floatx8 &other) const { Floatx8 r; for (int i = 0; i < LANES; i++) r.lanes[i] = lanes[i] >= other.lanes[i] ? allBits() : 0.0f; return r; }
+	Floatx8 operator&(const Floatx8 &other) const { Floatx8 r; for (int i = 0; i < LANES; i++) r.lanes[i] = fromBits(bits(i) & other.bits(i)); return r; }
+
+	static Floatx8 min(const Floatx8 &a, const Floatx8 &b) { Floatx8 r; for (int i = 0; i < LANES; i++) r.lanes[i] = b.lanes[i] < a.lanes[i] ? b.lanes[i] : a.lanes[i]; return r; }
+	static Floatx8 max(const Floatx8 &a, const Floatx8 &b) { Floatx8 r; for (int i = 0; i < LANES; i++) r.lanes[i] = b.lanes[i] > a.lanes[i] ? b.lanes[i] : a.lanes[i]; return r; }
+	static Floatx8 sqrt(const Floatx8 &a) { Floatx8 r; for (int i = 0; i < LANES; i++) r.lanes[i] = std::sqrt(a.lanes[i]); return r; }
+	static Floatx8 rsqrt(const Floatx8 &a) { Floatx8 r; for (int i = 0; i < LANES; i++) r.lanes[i] = 1.0f / std::sqrt(a.lanes[i]); return r; }
+	static Floatx8 floor(const Floatx8 &a) { Floatx8 r; for (int i = 0; i < LANES; i++) r.lanes[i] = std::floor(a.lanes[i]); return r; }
+
+	static Floatx8 select(const Floatx8 &mask, const Floatx8 &a, const Floatx8 &b) { Floatx8 r; for (int i = 0; i < LANES; i++) r.lanes[i] = mask.isSet(i) ? a.lanes[i] : b.lanes[i]; return r; }
+
+	int movemask() const { int mask = 0; for (int i = 0; i < LANES; i++) mask |= (isSet(i) ? 1 : 0) << i; return mask; }
+	static Floatx8 fromMask(int bits) { Floatx8 r; for (int i = 0; i < LANES; i++) r.lanes[i] = (bits >> i) & 1 ? allBits() : 0.0f; return r; }
+
+	static void fill(float *data, size_t count, float value) { for (size_t i = 0; i < count; i++) data[i] = value; }
+
+	float operator[](int lane) const { return lanes[lane]; }
+
+private:
+	// mask lanes are stored as NaN payloads with every bit set, as the SSE path does
+	static float fromBits(unsigned int value) { union { unsigned int u; float f; } bits; bits.u = value; return bits.f; }
+	static float allBits() { return fromBits(0xFFFFFFFFu); }
+	unsigned int bits(int lane) const { union { float f; unsigned int u; } bits; bits.f = lanes[lane]; return bits.u; }
+	bool isSet(int lane) const { return bits(lane) != 0; }
+	static float* quadRow(const float *top, const float *bottom, int lane) { return const_cast<float*>((lane >> 1) & 1 ? bottom : top); }
+	static int quadColumn(int lane) { return (lane & 1) + ((lane >> 2) << 1); }
+#endif
+
+public:
+	Intx8 toInt() const;
+	// the bits of every lane as an int, see Intx8::asFloat
+	Intx8 asBits() const;
+};
+
+// Eight int lanes, used for texel addressing
+class Intx8 {
+public:
+	static const int LANES = 8;
+
+#if defined(FLOATX8_AVX2)
+	__m256i v;
+
+	Intx8() : v(_mm256_setzero_si256()) {}
+	Intx8(int scalar) : v(_mm256_set1_epi32(scalar)) {}
+	explicit Intx8(__m256i v) : v(v) {}
+
+	static Intx8 load(const int *data) { return Intx8(_mm256_loadu_si256(reinterpret_cast<const __m256i*>(data))); }
+	void store(int *data) const { _mm256_storeu_si256(reinterpret_cast<__m256i*>(data), v); }
+
+	// four bytes at base + offsets for the lanes in mask, zero elsewhere
+	static Intx8 gather(const void *base, const Intx8 &offsets, const Floatx8 &mask) {
+		return Intx8(_mm256_mask_i32gather_epi32(_mm256_setzero_si256(), static_cast<const int*>(base), offsets.v, _mm256_castps_si256(mask.v), 1));
+	}
+
+	Intx8 operator+(const Intx8 &other) const { return Intx8(_mm256_add_epi32(v, other.v)); }
+	Intx8 operator-(const Intx8 &other) const { return Intx8(_mm256_sub_epi32(v, other.v)); }
+	Intx8 operator*(const Intx8 &other) const { return Intx8(_mm256_mullo_epi32(v, other.v)); }
+	Intx8 operator&(const Intx8 &other) const { return Intx8(_mm256_and_si256(v, other.v)); }
+	Intx8 operator|(const Intx8 &other) const { return Intx8(_mm256_or_si256(v, other.v)); }
+	Intx8 operator>>(int count) const { return Intx8(_mm256_sra_epi32(v, _mm_cvtsi32_si128(count))); }
+	Intx8 operator<<(int count) const { return Intx8(_mm256_sll_epi32(v, _mm_cvtsi32_si128(count))); }
+
+	// comparisons return a lane mask with all bits set where the test passed
+	Intx8 operator<(const Intx8 &other) const { return Intx8(_mm256_cmpgt_epi32(other.v, v)); }
+	Intx8 operator>(const Intx8 &other) const { return Intx8(_mm256_cmpgt_epi32(v, other.v)); }
+
+	// keeps lanes where mask is set, zero elsewhere
+	Intx8 operator&(const Floatx8 &mask) const { return Intx8(_mm256_and_si256(v, _mm256_castps_si256(mask.v))); }
+
+	static Intx8 select(const Intx8 &mask, const Intx8 &a, const Intx8 &b) { return Intx8(_mm256_blendv_epi8(b.v, a.v, mask.v)); }
+	static Intx8 min(const Intx8 &a, const Intx8 &b) { return Intx8(_mm256_min_epi32(a.v, b.v)); }
+	static Intx8 max(const Intx8 &a, const Intx8 &b) { return Intx8(_mm256_max_epi32(a.v, b.v)); }
+
+	Floatx8 toFloat() const { return Floatx8(_mm256_cvtepi32_ps(v)); }
+	// the bits of every lane as a float
+	Floatx8 asFloat() const { return Floatx8(_mm256_castsi256_ps(v)); }
+#elif defined(FLOATX8_SSE2)
+	__m128i lo, hi;
+
+	Intx8() : lo(_mm_setzero_si128()), hi(_mm_setzero_si128()) {}
+	Intx8(int scalar) : lo(_mm_set1_epi32(scalar)), hi(_mm_set1_epi32(scalar)) {}
+	Intx8(__m128i lo, __m128i hi) : lo(lo), hi(hi) {}
+
+	static Intx8 load(const int *data) {
+		return Intx8(_mm_loadu_si128(reinterpret_cast<const __m128i*>(data)), _mm_loadu_si128(reinterpret_cast<const __m128i*>(data + 4)));
+	}
+
+	void store(int *data) const {
+		_mm_storeu_si128(reinterpret_cast<__m128i*>(data), lo);
+		_mm_storeu_si128(reinterpret_cast<__m128i*>(data + 4), hi);
+	}
+
+	// four bytes at base + offsets for the lanes in mask, zero elsewhere
+	static Intx8 gather(const void *base, const Intx8 &offsets, const Floatx8 &mask) {
+		int offset[LANES], values[LANES];
+		offsets.store(offset);
+		const int bits = mask.movemask();
+		for (int i = 0; i < LANES; i++) {
+			values[i] = 0;
+			if (bits & (1 << i)) {
+				std::memcpy(&values[i], static_cast<const char*>(base) + offset[i], 4);
+			}
+		}
+		return load(values);
+	}
+
+	Intx8 operator+(const Intx8 &other) const { return Intx8(_mm_add_epi32(lo, other.lo), _mm_add_epi32(hi, other.hi)); }
+	Intx8 operator-(const Intx8 &other) const { return Intx8(_mm_sub_epi32(lo, other.lo), _mm_sub_epi32(hi, other.hi)); }
+	Intx8 operator*(const Intx8 &other) const { return Intx8(mul(lo, other.lo), mul(hi, other.hi)); }
+	Intx8 operator&(const Intx8 &other) const { return Intx8(_mm_and_si128(lo, other.lo), _mm_and_si128(hi, other.hi)); }
+	Intx8 operator|(const Intx8 &other) const { return Intx8(_mm_or_si128(lo, other.lo), _mm_or_si128(hi, other.hi)); }
+	Intx8 operator>>(int count) const { return Intx8(_mm_sra_epi32(lo, _mm_cvtsi32_si128(count)), _mm_sra_epi32(hi, _mm_cvtsi32_si128(count))); }
+	Intx8 operator<<(int count) const { return Intx8(_mm_sll_epi32(lo, _mm_cvtsi32_si128(count)), _mm_sll_epi32(hi, _mm_cvtsi32_si128(count))); }
+
+	// comparisons return a lane mask with all bits set where the test passed
+	Intx8 operator<(const Intx8 &other) const { return Intx8(_mm_cmplt_epi32(lo, other.lo), _mm_cmplt_epi32(hi, other.hi)); }
+	Intx8 operator>(const Intx8 &other) const { return Intx8(_mm_cmpgt_epi32(lo, other.lo), _mm_cmpgt_epi32(hi, other.hi)); }
+
+	// keeps lanes where mask is set, zero elsewhere
+	Intx8 operator&(const Floatx8 &mask) const {
+		return Intx8(_mm_and_si128(lo, _mm_castps_si128(mask.lo)), _mm_and_si128(hi, _mm_castps_si128(mask.hi)));
+	}
+
+#ifdef FLOATX8_SSE41
+	static Intx8 select(const Intx8 &mask, const Intx8 &a, const Intx8 &b) {
+		return Intx8(_mm_blendv_epi8(b.lo, a.lo, mask.lo), _mm_blendv_epi8(b.hi, a.hi, mask.hi));
+	}
+	static Intx8 min(const Intx8 &a, const Intx8 &b) { return Intx8(_mm_min_epi32(a.lo, b.lo), _mm_min_epi32(a.hi, b.hi)); }
+	static Intx8 max(const Intx8 &a, const Intx8 &b) { return Intx8(_mm_max_epi32(a.lo, b.lo), _mm_max_epi32(a.hi, b.hi)); }
+#else
+	static Intx8 select(const Intx8 &mask, const Intx8 &a, const Intx8 &b) {
+		return Intx8(_mm_or_si128(_mm_and_si128(mask.lo, a.lo), _mm_andnot_si128(mask.lo, b.lo)),
+			_mm_or_si128(_mm_and_si128(mask.hi, a.hi), _mm_andnot_si128(mask.hi, b.hi)));
+	}
+
+	// SSE2 has no 32 bit min and max, select on a comparison instead
+	static Intx8 min(const Intx8 &a, const Intx8 &b) { return select(b < a, b, a); }
+	static Intx8 max(const Intx8 &a, const Intx8 &b) { return select(b > a, b, a); }
+#endif
+
+	Floatx8 toFloat() const { return Floatx8(_mm_cvtepi32_ps(lo), _mm_cvtepi32_ps(hi)); }
+	// the bits of every lane as a float
+	Floatx8 asFloat() const { return Floatx8(_mm_castsi128_ps(lo), _mm_castsi128_ps(hi)); }
+
+private:
+#ifdef FLOATX8_SSE41
+	static __m128i mul(__m128i a, __m128i b) { return _mm_mullo_epi32(a, b); }
+#else
+	// SSE2 has no 32 bit low multiply, build it from two 32x32->64 multiplies
+	static __m128i mul(__m128i a, __m128i b) {
+		__m128i even = _mm_mul_epu32(a, b);
+		__m128i odd = _mm_mul_epu32(_mm_srli_epi64(a, 32), _mm_srli_epi64(b, 32));
+		return _mm_unpacklo_epi32(_mm_shuffle_epi32(even, _MM_SHUFFLE(0, 0, 2, 0)), _mm_shuffle_epi32(odd, _MM_SHUFFLE(0, 0, 2, 0)));
+	}
+#endif
+#else
+	int lanes[LANES];
+
+	Intx8() { for (int i = 0; i < LANES; i++) lanes[i] = 0; }
+	Intx8(int scalar) { for (int i = 0; i < LANES; i++) lanes[i] = scalar; }
+
+	static Intx8 load(const int *data) { Intx8 r; for (int i = 0; i < LANES; i++) r.lanes[i] = data[i]; return r; }
+	void store(int *data) const { for (int i = 0; i < LANES; i++) data[i] = lanes[i]; }
+
+	static Intx8 gather(const void *base, const Intx8 &offsets, const Floatx8 &mask) {
+		Intx8 r; int bits = mask.movemask();
+		for (int i = 0; i < LANES; i++) if ((bits >> i) & 1) std::memcpy(&r.lanes[i], static_cast<const char*>(base) + offsets.lanes[i], 4);
+		return r;
+	}
+
+	Intx8 operator+(const Intx8 &other) const { Intx8 r; for (int i = 0; i < LANES; i++) r.lanes[i] = lanes[i] + other.lanes[i]; return r; }
+	Intx8 operator-(const Intx8 &other) const { Intx8 r; for (int i = 0; i < LANES; i++) r.lanes[i] = lanes[i] - other.lanes[i]; return r; }
+	// low 32 bits of the products, which wrap around like the SIMD versions
+	Intx8 operator*(const Intx8 &other) const { Intx8 r; for (int i = 0; i < LANES; i++) r.lanes[i] = static_cast<int>(static_cast<unsigned int>(lanes[i]) * static_cast<unsigned int>(other.lanes[i])); return r; }
+	Intx8 operator&(const Intx8 &other) const { Intx8 r; for (int i = 0; i < LANES; i++) r.lanes[i] = lanes[i] & other.lanes[i]; return r; }
+	Intx8 operator|(const Intx8 &other) const { Intx8 r; for (int i = 0; i < LANES; i++) r.lanes[i] = lanes[i] | other.lanes[i]; return r; }
+	Intx8 operator>>(int count) const { Intx8 r; for (int i = 0; i < LANES; i++) r.lanes[i] = lanes[i] >> count; return r; }
+	Intx8 operator<<(int count) const { Intx8 r; for (int i = 0; i < LANES; i++) r.lanes[i] = lanes[i] << count; return r; }
+	Intx8 operator<(const Intx8 &other) const { Intx8 r; for (int i = 0; i < LANES; i++) r.lanes[i] = lanes[i] < other.lanes[i] ? -1 : 0; return r; }
+	Intx8 operator>(const Intx8 &other) const { Intx8 r; for (int i = 0; i < LANES; i++) r.lanes[i] = lanes[i] > other.lanes[i] ? -1 : 0; return r; }
+	Intx8 operator&(const Floatx8 &mask) const { Intx8 r; int bits = mask.movemask(); for (int i = 0; i < LANES; i++) r.lanes[i] = (bits >> i) & 1 ? lanes[i] : 0; return r; }
+
+	static Intx8 select(const Intx8 &mask, const Intx8 &a, const Intx8 &b) { Intx8 r; for (int i = 0; i < LANES; i++) r.lanes[i] = mask.lanes[i] ? a.lanes[i] : b.lanes[i]; return r; }
+	static Intx8 min(const Intx8 &a, const Intx8 &b) { Intx8 r; for (int i = 0; i < LANES; i++) r.lanes[i] = b.lanes[i] < a.lanes[i] ? b.lanes[i] : a.lanes[i]; return r; }
+	static Intx8 max(const Intx8 &a, const Intx8 &b) { Intx8 r; for (int i = 0; i < LANES; i++) r.lanes[i] = b.lanes[i] > a.lanes[i] ? b.lanes[i] : a.lanes[i]; return r; }
+
+	Floatx8 toFloat() const { Floatx8 r; for (int i = 0; i < LANES; i++) r.lanes[i] = static_cast<float>(lanes[i]); return r; }
+	Floatx8 asFloat() const { Floatx8 r; std::memcpy(r.lanes, lanes, sizeof(lanes)); return r; }
+#endif
+};
+
+// conversion with truncation towards zero, like a float to int cast
+#if defined(FLOATX8_AVX2)
+inline Intx8 Floatx8::toInt() const { return Intx8(_mm256_cvttps_epi32(v)); }
+inline Intx8 Floatx8::asBits() const { return Intx8(_mm256_castps_si256(v)); }
+#elif defined(FLOATX8_SSE2)
+inline Intx8 Floatx8::toInt() const { return Intx8(_mm_cvttps_epi32(lo), _mm_cvttps_epi32(hi)); }
+inline Intx8 Floatx8::asBits() const { return Intx8(_mm_castps_si128(lo), _mm_castps_si128(hi)); }
+#else
+inline Intx8 Floatx8::toInt() const { Intx8 r; for (int i = 0; i < LANES; i++) r.lanes[i] = static_cast<int>(lanes[i]); return r; }
+inline Intx8 Floatx8::asBits() const { Intx8 r; std::memcpy(r.lanes, lanes, sizeof(lanes)); return r; }
+#endif
+}
+FLOATX8_END_TARGET
+
+using FLOATX8_NAMESPACE::Floatx8;
+using FLOATX8_NAMESPACE::Intx8;
\ No newline at end of file
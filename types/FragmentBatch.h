@@ -0,0 +1,19 @@
+#pragma once
+
+// Block of 4x2 fragments laid out as two 2x2 quads, in structure of arrays form.
+// Lanes 0-3 are the quad at (x, y) and lanes 4-7 the quad at (x + 2, y), each
+// quad ordered top left, top right, bottom left, bottom right.
+struct FragmentBatch {
+	// one Floatx8 per attribute
+	static const int SIZE = 8;
+
+	float barycentricX[SIZE];
+	float barycentricY[SIZE];
+	float barycentricZ[SIZE];
+	int x, y;
+	// bit i is set when lane i is inside the triangle and passed the depth test
+	int mask;
+
+	static int laneOffsetX(int lane) { return (lane & 1) + ((lane >> 2) << 1); }
+	static int laneOffsetY(int lane) { return (lane >> 1) & 1; }
+};
\ No newline at end of file
@@ -4,6 +4,18 @@
 #include <iostream>
 #include "Vector3.h"
 
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define MATRIX_SSE2
+#include <emmintrin.h>
+#endif
+
+template <typename T, size_t rowDimension, size_t colDimension> class Matrix;
+// determinant, product and inverse transpose of generic matrices, with closed forms
+// for the 4x4 and 3x3 float matrices of the pipeline below
+template<typename T, size_t dimensions> struct dt;
+template <typename T, size_t rowsLeft, size_t colLeft, size_t colRight> struct mp;
+template<typename T, size_t dimensions> struct inv;
+
 template <typename T, size_t rowDimension, size_t colDimension>
 class Matrix {
 public:
@@ -37,9 +49,7 @@ public:
 		return Vector3f(m[0][0] / m[3][0], m[1][0] / m[3][0], m[2][0] / m[3][0]);
 	}
 
-	Matrix() {
-		memset(matrix, static_cast<T>(0), sizeof(T) * rowDimension * colDimension);
-	}
+	Matrix() : matrix() {}
 
 	Matrix(std::initializer_list<std::initializer_list<T>> set) {
 		memset(matrix, static_cast<T>(0), sizeof(T) * rowDimension * colDimension);
@@ -53,7 +63,7 @@ public:
 		}
 	}
 
-	Matrix<T, colDimension, rowDimension> getTransposed() {
+	Matrix<T, colDimension, rowDimension> getTransposed() const {
 		Matrix<T, colDimension, rowDimension> transposed;
 		for (int i = 0; i < rowDimension; ++i) {
 			for (int j = 0; j < colDimension; j++) {
@@ -91,19 +101,26 @@ public:
 		return ret;
 	}
 
-	Matrix<T, rowDimension, colDimension> invertTranspose() {
-		Matrix<T, rowDimension, colDimension> ret = adjugate();
-		T ac = 0;
-		for (int i = 0; i < rowDimension; ++i) {
-			ac += ret[0][i] * matrix[0][i];
-		}
-		return ret;
+	// Transpose of the inverse, which transforms normals. A singular matrix has no
+	// inverse and gets its adjugate, the inverse up to scale where there is one.
+	Matrix<T, rowDimension, colDimension> invertTranspose() const {
+		return inv<T, rowDimension>::invertTranspose(*this);
 	}
 
-	Matrix<T, rowDimension, colDimension> invert() {
+	Matrix<T, rowDimension, colDimension> invert() const {
 		return invertTranspose().getTransposed();
 	}
 
+	// (x, y, z, 1) transformed by a 4x4 matrix, divided by the resulting w
+	Vector3f transformPoint(const Vector3f &point) const {
+		static_assert(rowDimension == 4 && colDimension == 4, "only 4x4 matrices transform points");
+		const float x = matrix[0][0] * point.x + matrix[0][1] * point.y + matrix[0][2] * point.z + matrix[0][3];
+		const float y = matrix[1][0] * point.x + matrix[1][1] * point.y + matrix[1][2] * point.z + matrix[1][3];
+		const float z = matrix[2][0] * point.x + matrix[2][1] * point.y + matrix[2][2] * point.z + matrix[2][3];
+		const float w = matrix[3][0] * point.x + matrix[3][1] * point.y + matrix[3][2] * point.z + matrix[3][3];
+		return Vector3f(x / w, y / w, z / w);
+	}
+
 	void print() {
 		for (int i = 0; i < rowDimension; i++) {
 			for (int j = 0; j < colDimension; j++) {
@@ -177,19 +194,126 @@ template<typename T> struct dt<T, 1> {
 	}
 };
 
+template<typename T, size_t dimensions> struct inv {
+	static Matrix<T, dimensions, dimensions> invertTranspose(const Matrix<T, dimensions, dimensions>& src) {
+		Matrix<T, dimensions, dimensions> ret = src.adjugate();
+		T determinant = 0;
+		for (int i = 0; i < dimensions; ++i) {
+			determinant += ret[0][i] * src[0][i];
+		}
+		if (determinant != 0) {
+			for (int i = 0; i < dimensions; i++) {
+				for (int j = 0; j < dimensions; j++) {
+					ret[i][j] /= determinant;
+				}
+			}
+		}
+		return ret;
+	}
+};
+
+// cofactors from the 2x2 determinants of the top two and bottom two rows
+template<> struct inv<float, 4> {
+	static Matrix<float, 4, 4> invertTranspose(const Matrix<float, 4, 4>& m) {
+		const float s0 = m[0][0] * m[1][1] - m[1][0] * m[0][1];
+		const float s1 = m[0][0] * m[1][2] - m[1][0] * m[0][2];
+		const float s2 = m[0][0] * m[1][3] - m[1][0] * m[0][3];
+		const float s3 = m[0][1] * m[1][2] - m[1][1] * m[0][2];
+		const float s4 = m[0][1] * m[1][3] - m[1][1] * m[0][3];
+		const float s5 = m[0][2] * m[1][3] - m[1][2] * m[0][3];
+		const float c0 = m[2][0] * m[3][1] - m[3][0] * m[2][1];
+		const float c1 = m[2][0] * m[3][2] - m[3][0] * m[2][2];
+		const float c2 = m[2][0] * m[3][3] - m[3][0] * m[2][3];
+		const float c3 = m[2][1] * m[3][2] - m[3][1] * m[2][2];
+		const float c4 = m[2][1] * m[3][3] - m[3][1] * m[2][3];
+		const float c5 = m[2][2] * m[3][3] - m[3][2] * m[2][3];
+		const float determinant = s0 * c5 - s1 * c4 + s2 * c3 + s3 * c2 - s4 * c1 + s5 * c0;
+		const float scale = determinant != 0.0f ? 1.0f / determinant : 1.0f;
 
-template <typename T, size_t rowsLeft, size_t colLeft, size_t colRight>
-Matrix<T, rowsLeft, colRight> operator*(const Matrix<T, rowsLeft, colLeft> &lhs, const Matrix<T, colLeft, colRight> &rhs) {
-	Matrix<T, rowsLeft, colRight> result;
-	for (int r1 = 0; r1 < rowsLeft; r1++) {
-		for (int c2 = 0; c2 < colRight; c2++) {
-			T ac = 0;
-			for (int c1 = 0; c1 < colLeft; c1++) {
-				ac += lhs[r1][c1] * rhs[c1][c2];
+		// element (i, j) of the inverse goes to (j, i)
+		return Matrix<float, 4, 4>{
+			{ (m[1][1] * c5 - m[1][2] * c4 + m[1][3] * c3) * scale, (-m[1][0] * c5 + m[1][2] * c2 - m[1][3] * c1) * scale, (m[1][0] * c4 - m[1][1] * c2 + m[1][3] * c0) * scale, (-m[1][0] * c3 + m[1][1] * c1 - m[1][2] * c0) * scale },
+			{ (-m[0][1] * c5 + m[0][2] * c4 - m[0][3] * c3) * scale, (m[0][0] * c5 - m[0][2] * c2 + m[0][3] * c1) * scale, (-m[0][0] * c4 + m[0][1] * c2 - m[0][3] * c0) * scale, (m[0][0] * c3 - m[0][1] * c1 + m[0][2] * c0) * scale },
+			{ (m[3][1] * s5 - m[3][2] * s4 + m[3][3] * s3) * scale, (-m[3][0] * s5 + m[3][2] * s2 - m[3][3] * s1) * scale, (m[3][0] * s4 - m[3][1] * s2 + m[3][3] * s0) * scale, (-m[3][0] * s3 + m[3][1] * s1 - m[3][2] * s0) * scale },
+			{ (-m[2][1] * s5 + m[2][2] * s4 - m[2][3] * s3) * scale, (m[2][0] * s5 - m[2][2] * s2 + m[2][3] * s1) * scale, (-m[2][0] * s4 + m[2][1] * s2 - m[2][3] * s0) * scale, (m[2][0] * s3 - m[2][1] * s1 + m[2][2] * s0) * scale }
+		};
+	}
+};
+
+// the rows of the cofactor matrix are the cross products of the other two rows
+template<> struct inv<float, 3> {
+	static Matrix<float, 3, 3> invertTranspose(const Matrix<float, 3, 3>& m) {
+		Vector3f r0(m[0][0], m[0][1], m[0][2]), r1(m[1][0], m[1][1], m[1][2]), r2(m[2][0], m[2][1], m[2][2]);
+		const Vector3f c0 = r1 ^ r2, c1 = r2 ^ r0, c2 = r0 ^ r1;
+		const float determinant = r0.dot(c0);
+		const float scale = determinant != 0.0f ? 1.0f / determinant : 1.0f;
+		return Matrix<float, 3, 3>{
+			{ c0.x * scale, c0.y * scale, c0.z * scale },
+			{ c1.x * scale, c1.y * scale, c1.z * scale },
+			{ c2.x * scale, c2.y * scale, c2.z * scale }
+		};
+	}
+};
+
+template <typename T, size_t rowsLeft, size_t colLeft, size_t colRight> struct mp {
+	static void multiply(const Matrix<T, rowsLeft, colLeft> &lhs, const Matrix<T, colLeft, colRight> &rhs, Matrix<T, rowsLeft, colRight> &result) {
+		for (int r1 = 0; r1 < rowsLeft; r1++) {
+			for (int c2 = 0; c2 < colRight; c2++) {
+				T ac = 0;
+				for (int c1 = 0; c1 < colLeft; c1++) {
+					ac += lhs[r1][c1] * rhs[c1][c2];
+				}
+				result[r1][c2] = ac;
+			}
+		}
+	}
+};
+
+// every row of the result is a weighted sum of the rows of rhs, in the order of the loops above
+template <> struct mp<float, 4, 4, 4> {
+	static void multiply(const Matrix<float, 4, 4> &lhs, const Matrix<float, 4, 4> &rhs, Matrix<float, 4, 4> &result) {
+#ifdef MATRIX_SSE2
+		const __m128 rows[4] = { _mm_loadu_ps(rhs[0]), _mm_loadu_ps(rhs[1]), _mm_loadu_ps(rhs[2]), _mm_loadu_ps(rhs[3]) };
+		for (int r = 0; r < 4; r++) {
+			__m128 row = _mm_mul_ps(_mm_set1_ps(lhs[r][0]), rows[0]);
+			row = _mm_add_ps(row, _mm_mul_ps(_mm_set1_ps(lhs[r][1]), rows[1]));
+			row = _mm_add_ps(row, _mm_mul_ps(_mm_set1_ps(lhs[r][2]), rows[2]));
+			row = _mm_add_ps(row, _mm_mul_ps(_mm_set1_ps(lhs[r][3]), rows[3]));
+			_mm_storeu_ps(result[r], row);
+		}
+#else
+		for (int r = 0; r < 4; r++) {
+			for (int c = 0; c < 4; c++) {
+				result[r][c] = lhs[r][0] * rhs[0][c] + lhs[r][1] * rhs[1][c] + lhs[r][2] * rhs[2][c] + lhs[r][3] * rhs[3][c];
+			}
+		}
+#endif
+	}
+};
+
+template <> struct mp<float, 4, 4, 1> {
+	static void multiply(const Matrix<float, 4, 4> &lhs, const Matrix<float, 4, 1> &rhs, Matrix<float, 4, 1> &result) {
+		for (int r = 0; r < 4; r++) {
+			result[r][0] = lhs[r][0] * rhs[0][0] + lhs[r][1] * rhs[1][0] + lhs[r][2] * rhs[2][0] + lhs[r][3] * rhs[3][0];
+		}
+	}
+};
+
+template <> struct mp<float, 3, 3, 3> {
+	static void multiply(const Matrix<float, 3, 3> &lhs, const Matrix<float, 3, 3> &rhs, Matrix<float, 3, 3> &result) {
+		for (int r = 0; r < 3; r++) {
+			for (int c = 0; c < 3; c++) {
+				result[r][c] = lhs[r][0] * rhs[0][c] + lhs[r][1] * rhs[1][c] + lhs[r][2] * rhs[2][c];
 			}
-			result[r1][c2] = ac;
 		}
 	}
+};
+
+
+template <typename T, size_t rowsLeft, size_t colLeft, size_t colRight>
+Matrix<T, rowsLeft, colRight> operator*(const Matrix<T, rowsLeft, colLeft> &lhs, const Matrix<T, colLeft, colRight> &rhs) {
+	Matrix<T, rowsLeft, colRight> result;
+	mp<T, rowsLeft, colLeft, colRight>::multiply(lhs, rhs, result);
 	return result;
 }
 
@@ -1,5 +1,7 @@
 #pragma once
 
+#include <algorithm>
+
 #include "Vector2.h"
 
 using byte = unsigned char;
@@ -15,10 +17,19 @@ struct RGBA {
 			&& blue == other.blue && alpha == other.alpha;
 	}
 
+	// Light intensity in 8.8 fixed point, the precision colours are lit with. Negative
+	// intensities are 0 and the largest is just below 128, so lit channels fit in 15 bits.
+	static int fixedIntensity(float intensity) {
+		return static_cast<int>(std::min(std::max(intensity, 0.0f), 127.99f) * 256.0f + 0.5f);
+	}
+
+	// channels times the intensity in 8.8 fixed point, truncated and saturated at 255,
+	// the same bytes as Colourx8 gives eight colours at a time
 	void applyLightIntensity(float intensity) {
-		red = red * intensity;
-		green = green * intensity;
-		blue = blue * intensity;
+		const int fixed = fixedIntensity(intensity);
+		red = static_cast<byte>(std::min((red * fixed) >> 8, 255));
+		green = static_cast<byte>(std::min((green * fixed) >> 8, 255));
+		blue = static_cast<byte>(std::min((blue * fixed) >> 8, 255));
 	}
 };
 
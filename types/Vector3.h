@@ -22,6 +22,15 @@ public:
 		}
 	}
 
+	const T& operator[](size_t index) const {
+		assert(index < 3);
+		switch (index) {
+			case 0: return x;
+			case 1: return y;
+			default: return z;
+		}
+	}
+
 	Vector3 operator /(T scalar) const {
 		assert(scalar != 0);
 		T inversedScalar = 1.0f / scalar;
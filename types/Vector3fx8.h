@@ -0,0 +1,101 @@
+#pragma once
+
+#include "Floatx8.h"
+#include "Vector3.h"
+
+FLOATX8_BEGIN_TARGET
+namespace FLOATX8_NAMESPACE {
+
+// Eight Vector3f in structure of arrays form, one Floatx8 per component, so every
+// operation works on eight vectors at once. Without SSE2 the lanes fall back to the
+// scalar loops of Floatx8, which are the reference the error bounds below are measured
+// against: every operation rounds like the matching Vector3f code, lane by lane.
+class Vector3fx8 {
+public:
+	Floatx8 x, y, z;
+
+	Vector3fx8() {}
+	Vector3fx8(const Floatx8 &x, const Floatx8 &y, const Floatx8 &z) : x(x), y(y), z(z) {}
+	// the same vector in every lane
+	explicit Vector3fx8(const Vector3f &vector) : x(vector.x), y(vector.y), z(vector.z) {}
+
+	static Vector3fx8 load(const float *x, const float *y, const float *z) {
+		return Vector3fx8(Floatx8::load(x), Floatx8::load(y), Floatx8::load(z));
+	}
+
+	void store(float *outX, float *outY, float *outZ) const {
+		x.store(outX);
+		y.store(outY);
+		z.store(outZ);
+	}
+
+	Vector3f operator[](int lane) const { return Vector3f(x[lane], y[lane], z[lane]); }
+
+	Vector3fx8 operator+(const Vector3fx8 &other) const { return Vector3fx8(x + other.x, y + other.y, z + other.z); }
+	Vector3fx8 operator-(const Vector3fx8 &other) const { return Vector3fx8(x - other.x, y - other.y, z - other.z); }
+	Vector3fx8 operator*(const Floatx8 &scalar) const { return Vector3fx8(x * scalar, y * scalar, z * scalar); }
+
+	// within 1.5 * 2^-23 of the sum of the magnitudes of the products
+	Floatx8 dot(const Vector3fx8 &other) const { return x * other.x + y * other.y + z * other.z; }
+
+	Vector3fx8 cross(const Vector3fx8 &other) const {
+		return Vector3fx8(y * other.z - z * other.y, z * other.x - x * other.z, x * other.y - y * other.x);
+	}
+
+	Floatx8 magnitude() const { return Floatx8::sqrt(dot(*this)); }
+
+	// Unit vectors through a divide and a square root, within 3 ulp of the exact result
+	// per component. Zero vectors become NaN like Vector3f::normalize.
+	Vector3fx8 normalized() const {
+		return *this * (Floatx8(1.0f) / magnitude());
+	}
+
+	// Unit vectors through the reciprocal square root estimate refined by one Newton
+	// step, within 6 ulp of the exact result per component. Without SSE2 the estimate is
+	// exact, the Newton step still rounds. Zero vectors become infinite or NaN.
+	Vector3fx8 normalizedFast() const {
+		const Floatx8 squared = dot(*this);
+		const Floatx8 estimate = Floatx8::rsqrt(squared);
+		// y' = y * (1.5 - 0.5 * a * y * y)
+		const Floatx8 refined = estimate * (Floatx8(1.5f) - Floatx8(0.5f) * squared * estimate * estimate);
+		return *this * refined;
+	}
+
+	// Unit vectors through the reciprocal square root estimate alone, within a relative
+	// error of 3.7e-4 per component with SSE2 and the same as normalized() without it
+	Vector3fx8 normalizedEstimate() const {
+		return *this * Floatx8::rsqrt(dot(*this));
+	}
+
+	// a + (b - a) * t
+	static Vector3fx8 lerp(const Vector3fx8 &a, const Vector3fx8 &b, const Floatx8 &t) {
+		return a + (b - a) * t;
+	}
+};
+
+// Barycentric coordinates of eight fragments in a triangle, which interpolate the
+// attributes of its vertices as v0 * b0 + v1 * b1 + v2 * b2, in that order
+struct Barycentricx8 {
+	Floatx8 b0, b1, b2;
+
+	static Barycentricx8 load(const float *b0, const float *b1, const float *b2) {
+		Barycentricx8 barycentric;
+		barycentric.b0 = Floatx8::load(b0);
+		barycentric.b1 = Floatx8::load(b1);
+		barycentric.b2 = Floatx8::load(b2);
+		return barycentric;
+	}
+
+	Floatx8 interpolate(float v0, float v1, float v2) const {
+		return Floatx8(v0) * b0 + Floatx8(v1) * b1 + Floatx8(v2) * b2;
+	}
+
+	Vector3fx8 interpolate(const Vector3f &v0, const Vector3f &v1, const Vector3f &v2) const {
+		return Vector3fx8(interpolate(v0.x, v1.x, v2.x), interpolate(v0.y, v1.y, v2.y), interpolate(v0.z, v1.z, v2.z));
+	}
+};
+}
+FLOATX8_END_TARGET
+
+using FLOATX8_NAMESPACE::Vector3fx8;
+using FLOATX8_NAMESPACE::Barycentricx8;
\ No newline at end of file
@@ -0,0 +1,137 @@
+#pragma once
+
+#include <algorithm>
+#include <array>
+#include <cmath>
+#include <cstdint>
+#include <cstring>
+
+#include "Vector3.h"
+
+// Storage of the vertex attributes of a mesh. QUANTIZED keeps positions as 16 bit
+// fractions of the bounding box, normals octahedral encoded in two 16 bit values,
+// texture coordinates as half floats and face indices as 16 bit offsets from the
+// first index of their cluster of faces, about a third of the FLOAT size.
+enum class VertexFormat : int {
+	FLOAT = 0,
+	QUANTIZED
+};
+
+struct QuantizedPosition {
+	uint16_t x, y, z;
+};
+
+// normal projected onto the octahedron |x| + |y| + |z| = 1, with the lower half folded
+// over the upper one, as signed 16 bit fractions
+struct OctahedralNormal {
+	int16_t x, y;
+};
+
+struct HalfTextureCoordinate {
+	uint16_t u, v;
+};
+
+// vertex, texture coordinate and normal indices of a corner relative to the bases of
+// the cluster of its face
+struct QuantizedCorner {
+	uint16_t vertex, textureCoordinate, normal;
+};
+using QuantizedFace = std::array<QuantizedCorner, 3>;
+
+namespace VertexEncoding {
+
+	// faces are grouped in clusters of this many faces that share index bases
+	static const int FACES_PER_CLUSTER = 256;
+	static const float OCTAHEDRAL_SCALE = 32767.0f;
+
+	inline OctahedralNormal encodeOctahedral(const Vector3f &normal) {
+		const float sum = std::fabs(normal.x) + std::fabs(normal.y) + std::fabs(normal.z);
+		float x = sum > 0.0f ? normal.x / sum : 0.0f;
+		float y = sum > 0.0f ? normal.y / sum : 0.0f;
+		if (normal.z < 0.0f) {
+			const float foldedX = (1.0f - std::fabs(y)) * (x >= 0.0f ? 1.0f : -1.0f);
+			const float foldedY = (1.0f - std::fabs(x)) * (y >= 0.0f ? 1.0f : -1.0f);
+			x = foldedX;
+			y = foldedY;
+		}
+		OctahedralNormal encoded;
+		encoded.x = static_cast<int16_t>(std::lround(x * OCTAHEDRAL_SCALE));
+		encoded.y = static_cast<int16_t>(std::lround(y * OCTAHEDRAL_SCALE));
+		return encoded;
+	}
+
+	// unit normal of an encoded one
+	inline Vector3f decodeOctahedral(const OctahedralNormal &encoded) {
+		float x = encoded.x / OCTAHEDRAL_SCALE;
+		float y = encoded.y / OCTAHEDRAL_SCALE;
+		const float z = 1.0f - std::fabs(x) - std::fabs(y);
+		const float fold = std::max(-z, 0.0f);
+		x += x >= 0.0f ? -fold : fold;
+		y += y >= 0.0f ? -fold : fold;
+		const float inversedMagnitude = 1.0f / std::sqrt(x * x + y * y + z * z);
+		return Vector3f(x * inversedMagnitude, y * inversedMagnitude, z * inversedMagnitude);
+	}
+
+	// IEEE 754 half float, rounded to nearest even
+	inline uint16_t floatToHalf(float value) {
+		uint32_t bits;
+		std::memcpy(&bits, &value, sizeof(bits));
+		const uint16_t sign = static_cast<uint16_t>((bits >> 16) & 0x8000);
+		const uint32_t magnitude = bits & 0x7FFFFFFF;
+		if (magnitude >= 0x7F800000) {
+			// infinity stays infinity and every NaN becomes a quiet one
+			return sign | (magnitude > 0x7F800000 ? 0x7E00 : 0x7C00);
+		}
+		if (magnitude >= 0x477FF000) {
+			// rounds past the largest half
+			return sign | 0x7C00;
+		}
+		if (magnitude < 0x38800000) {
+			// subnormal half, the implicit bit is shifted into the mantissa
+			if (magnitude < 0x33000000) {
+				return sign;
+			}
+			const uint32_t exponent = magnitude >> 23;
+			const uint32_t mantissa = (magnitude & 0x7FFFFF) | 0x800000;
+			const uint32_t shift = 126 - exponent;
+			uint32_t half = mantissa >> shift;
+			const uint32_t remainder = mantissa & ((1u << shift) - 1);
+			const uint32_t halfway = 1u << (shift - 1);
+			if (remainder > halfway || (remainder == halfway && (half & 1))) {
+				half++;
+			}
+			return sign | static_cast<uint16_t>(half);
+		}
+		uint32_t half = ((magnitude - 0x38000000) >> 13);
+		const uint32_t remainder = magnitude & 0x1FFF;
+		if (remainder > 0x1000 || (remainder == 0x1000 && (half & 1))) {
+			half++;
+		}
+		return sign | static_cast<uint16_t>(half);
+	}
+
+	inline float halfToFloat(uint16_t half) {
+		const uint32_t sign = static_cast<uint32_t>(half & 0x8000) << 16;
+		const uint32_t exponent = (half >> 10) & 0x1F;
+		uint32_t mantissa = half & 0x3FF;
+		uint32_t bits;
+		if (exponent == 0x1F) {
+			bits = sign | 0x7F800000 | (mantissa << 13);
+		} else if (exponent != 0) {
+			bits = sign | ((exponent + 112) << 23) | (mantissa << 13);
+		} else if (mantissa == 0) {
+			bits = sign;
+		} else {
+			// normalizes the subnormal half
+			uint32_t shift = 0;
+			while ((mantissa & 0x400) == 0) {
+				mantissa <<= 1;
+				shift++;
+			}
+			bits = sign | ((113 - shift) << 23) | ((mantissa & 0x3FF) << 13);
+		}
+		float value;
+		std::memcpy(&value, &bits, sizeof(value));
+		return value;
+	}
+}
\ No newline at end of file